@@ -0,0 +1,194 @@
+#include <unistd.h>
+
+/**
+ * @file apps/rt_latency/main.cc
+ * @brief Wakeup latency test
+ * @details
+ * Starts NUM_THREADS CPU-bound threads and lets the main thread sleep
+ * NUM_SAMPLES times for PERIOD_MS. After each wakeup, the time from the
+ * requested wakeup time until running (taken by the kernel from the system
+ * counter) is recorded. It includes the delay until the timer tick expiring
+ * the sleep, which is reported separately from the time from becoming runnable
+ * until running. The test is performed as SCHED_OTHER and as SCHED_FIFO
+ * thread, each reporting the worst case and the percentiles of the latency.
+ */
+
+/* System calls (see inc/sys/syscall.h) */
+#define SYS_WRITE                1
+#define SYS_SCHED_YIELD          24
+#define SYS_NANOSLEEP            35
+#define SYS_CLONE                56
+#define SYS_EXIT                 60
+#define SYS_SCHED_SETSCHEDULER   144
+#define SYS_SCHED_STATS          512
+#define SYS_SCHED_WAKEUP_LATENCY 513
+
+/* Wakeup latencies (see SYS_SCHED_WAKEUP_LATENCY) */
+#define WAKEUP_LATENCY_DEADLINE 0
+#define WAKEUP_LATENCY_READY    1
+
+/* Scheduling policies */
+#define SCHED_OTHER 0
+#define SCHED_FIFO  1
+
+/* Priority of measuring thread */
+#define RT_PRIORITY 50
+
+/* Number of CPU-bound threads */
+#define NUM_THREADS 8
+
+/* Number of wakeups per policy */
+#define NUM_SAMPLES 50
+
+/* Sleep period (rounded up to timer tick by kernel) */
+#define PERIOD_MS 10
+
+/* Statistics of a single CPU (see thread::Scheduler::Statistics) */
+struct sched_stats {
+	unsigned long now;
+	unsigned long frequency;
+	unsigned long idleTime;
+	unsigned long length;
+	unsigned long switches;
+	unsigned long steals;
+	unsigned long migrations;
+	unsigned long ticksAvoided;
+};
+
+struct timespec {
+	long tv_sec;
+	long tv_nsec;
+};
+
+struct sched_param {
+	int sched_priority;
+};
+
+/* Threads stop as soon as flag is set */
+static volatile int stop;
+
+/* Latencies of a single run (in system counter ticks) */
+static unsigned long samples[NUM_SAMPLES];
+static unsigned long readySamples[NUM_SAMPLES];
+
+static void print(const char* str) {
+	size_t len = 0;
+	while (str[len] != '\0')
+		len++;
+
+	syscall(SYS_WRITE, 1, str, len);
+}
+
+static void printNumber(unsigned long value) {
+	char buf[21];
+	size_t pos = sizeof(buf) - 1;
+	buf[pos] = '\0';
+
+	do {
+		buf[--pos] = '0' + (value % 10);
+		value /= 10;
+	} while (value != 0);
+
+	print(&buf[pos]);
+}
+
+static void worker() {
+	volatile unsigned long iterations = 0;
+
+	while (!stop)
+		iterations = iterations + 1;
+
+	syscall(SYS_EXIT);
+}
+
+static void sort(unsigned long* values, size_t num) {
+	for (size_t i = 1; i < num; i++) {
+		auto value = values[i];
+		size_t j = i;
+		for (; j > 0 && values[j - 1] > value; j--)
+			values[j] = values[j - 1];
+		values[j] = value;
+	}
+}
+
+static void printLatency(const char* name, unsigned long ticks, unsigned long frequency) {
+	print(name);
+	printNumber((ticks * 1000000) / frequency);
+	print("us");
+}
+
+static void report(const char* name, unsigned long* values, unsigned long frequency) {
+	sort(values, NUM_SAMPLES);
+
+	unsigned long sum = 0;
+	for (size_t i = 0; i < NUM_SAMPLES; i++)
+		sum += values[i];
+
+	print(name);
+	printLatency(": min ", values[0], frequency);
+	printLatency(", avg ", sum / NUM_SAMPLES, frequency);
+	printLatency(", p50 ", values[(NUM_SAMPLES * 50) / 100], frequency);
+	printLatency(", p90 ", values[(NUM_SAMPLES * 90) / 100], frequency);
+	printLatency(", p99 ", values[(NUM_SAMPLES * 99) / 100], frequency);
+	printLatency(", max ", values[NUM_SAMPLES - 1], frequency);
+	print("\n\r");
+}
+
+static int measure(const char* name, int policy, int priority, unsigned long frequency) {
+	struct sched_param param;
+	param.sched_priority = priority;
+	if (syscall(SYS_SCHED_SETSCHEDULER, 0, policy, &param) != 0) {
+		print("rt_latency: Unable to set policy\n\r");
+		return -1;
+	}
+
+	struct timespec period;
+	period.tv_sec = 0;
+	period.tv_nsec = PERIOD_MS * 1000000L;
+
+	for (size_t i = 0; i < NUM_SAMPLES; i++) {
+		syscall(SYS_NANOSLEEP, &period, 0);
+		samples[i] = syscall(SYS_SCHED_WAKEUP_LATENCY, WAKEUP_LATENCY_DEADLINE);
+		readySamples[i] = syscall(SYS_SCHED_WAKEUP_LATENCY, WAKEUP_LATENCY_READY);
+	}
+
+	print(name);
+	report(" wakeup", samples, frequency);
+	print(name);
+	report(" ready ", readySamples, frequency);
+
+	return 0;
+}
+
+extern "C" int main(void) {
+	struct sched_stats stats;
+	if (syscall(SYS_SCHED_STATS, 0, &stats) != 0 || stats.frequency == 0) {
+		print("rt_latency: Unable to get statistics\n\r");
+		syscall(SYS_EXIT);
+	}
+
+	/* Start CPU-bound threads */
+	for (size_t i = 0; i < NUM_THREADS; i++) {
+		if (syscall(SYS_CLONE, worker) < 0) {
+			print("rt_latency: Unable to start thread\n\r");
+			syscall(SYS_EXIT);
+		}
+	}
+
+	/* Let threads spread across all CPUs */
+	syscall(SYS_SCHED_YIELD);
+
+	print("rt_latency: ");
+	printNumber(NUM_SAMPLES);
+	print(" wakeups with ");
+	printNumber(NUM_THREADS);
+	print(" CPU-bound threads\n\r");
+
+	if (measure("SCHED_OTHER", SCHED_OTHER, 0, stats.frequency) == 0)
+		measure("SCHED_FIFO ", SCHED_FIFO, RT_PRIORITY, stats.frequency);
+
+	stop = 1;
+
+	syscall(SYS_EXIT);
+	return 0;
+}
@@ -0,0 +1,150 @@
+#include <unistd.h>
+
+/**
+ * @file apps/sched_bench/main.cc
+ * @brief Scheduler benchmark
+ * @details
+ * Starts NUM_THREADS CPU-bound threads, lets them run for DURATION_S seconds
+ * and reports the utilization and the steal/migrate counters of each CPU as
+ * well as the progress of each thread.
+ */
+
+/* System calls (see inc/sys/syscall.h) */
+#define SYS_WRITE       1
+#define SYS_SCHED_YIELD 24
+#define SYS_CLONE       56
+#define SYS_EXIT        60
+#define SYS_SCHED_STATS 512
+
+/* Number of CPU-bound threads */
+#define NUM_THREADS 8
+
+/* Maximum number of CPUs */
+#define MAX_CPUS 4
+
+/* Duration of measurement */
+#define DURATION_S 10
+
+/* Statistics of a single CPU (see thread::Scheduler::Statistics) */
+struct sched_stats {
+	unsigned long now;
+	unsigned long frequency;
+	unsigned long idleTime;
+	unsigned long length;
+	unsigned long switches;
+	unsigned long steals;
+	unsigned long migrations;
+	unsigned long ticksAvoided;
+};
+
+/* Threads stop as soon as flag is set */
+static volatile int stop;
+
+/* Number of started threads */
+static unsigned long started;
+
+/* Progress of each thread */
+static volatile unsigned long iterations[NUM_THREADS];
+
+static void print(const char* str) {
+	size_t len = 0;
+	while (str[len] != '\0')
+		len++;
+
+	syscall(SYS_WRITE, 1, str, len);
+}
+
+static void printNumber(unsigned long value) {
+	char buf[21];
+	size_t pos = sizeof(buf) - 1;
+	buf[pos] = '\0';
+
+	do {
+		buf[--pos] = '0' + (value % 10);
+		value /= 10;
+	} while (value != 0);
+
+	print(&buf[pos]);
+}
+
+static void worker() {
+	auto idx = __atomic_fetch_add(&started, 1, __ATOMIC_RELAXED);
+
+	while (!stop)
+		iterations[idx] = iterations[idx] + 1;
+
+	syscall(SYS_EXIT);
+}
+
+extern "C" int main(void) {
+	struct sched_stats begin[MAX_CPUS];
+	struct sched_stats end[MAX_CPUS];
+
+	/* Take initial statistics (and detect number of CPUs) */
+	size_t numCPUs = 0;
+	while (numCPUs < MAX_CPUS && syscall(SYS_SCHED_STATS, numCPUs, &begin[numCPUs]) == 0)
+		numCPUs++;
+
+	if (numCPUs == 0) {
+		print("sched_bench: Unable to get statistics\n\r");
+		syscall(SYS_EXIT);
+	}
+
+	/* Start CPU-bound threads */
+	for (size_t i = 0; i < NUM_THREADS; i++) {
+		if (syscall(SYS_CLONE, worker) < 0) {
+			print("sched_bench: Unable to start thread\n\r");
+			syscall(SYS_EXIT);
+		}
+	}
+
+	/* Wait (without competing for a CPU) */
+	struct sched_stats now;
+	do {
+		syscall(SYS_SCHED_YIELD);
+		syscall(SYS_SCHED_STATS, 0, &now);
+	} while (now.now - begin[0].now < DURATION_S * begin[0].frequency);
+
+	for (size_t i = 0; i < numCPUs; i++)
+		syscall(SYS_SCHED_STATS, i, &end[i]);
+
+	stop = 1;
+
+	/* Report per-CPU utilization and balancing */
+	print("sched_bench: ");
+	printNumber(NUM_THREADS);
+	print(" threads on ");
+	printNumber(numCPUs);
+	print(" CPUs\n\r");
+
+	for (size_t i = 0; i < numCPUs; i++) {
+		auto elapsed = end[i].now - begin[i].now;
+		auto idle = end[i].idleTime - begin[i].idleTime;
+		auto busy = elapsed > idle ? elapsed - idle : 0;
+
+		print("CPU ");
+		printNumber(i);
+		print(": utilization ");
+		printNumber(elapsed ? (busy * 100) / elapsed : 0);
+		print("%, switches ");
+		printNumber(end[i].switches - begin[i].switches);
+		print(", steals ");
+		printNumber(end[i].steals - begin[i].steals);
+		print(", migrations ");
+		printNumber(end[i].migrations - begin[i].migrations);
+		print(", ticks avoided ");
+		printNumber(end[i].ticksAvoided - begin[i].ticksAvoided);
+		print("\n\r");
+	}
+
+	for (size_t i = 0; i < NUM_THREADS; i++) {
+		print("Thread ");
+		printNumber(i);
+		print(": ");
+		printNumber(iterations[i]);
+		print(" iterations\n\r");
+	}
+
+	syscall(SYS_EXIT);
+	return 0;
+}
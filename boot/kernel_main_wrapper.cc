@@ -1,3 +1,5 @@
+#include <kernel/percpu.h>
+
 extern int kernelMain(void *fdt);
 extern int kernelMainApp();
 
@@ -15,6 +17,9 @@ extern "C" void kernelMainWrapper(void *fdt, int cpuID) {
 	(void) fdt;
 	(void) cpuID;
 
+	/* Per-CPU data is addressed relative to TPIDR_EL1 */
+	percpu::setBase(cpuID);
+
 	if (cpuID == 0) {
 		/* Call Global constructors */
 		csu_init();
@@ -0,0 +1,166 @@
+#include <cerrno.h>
+#include <cstring.h>
+#include <kernel/cpu.h>
+#include <kernel/math.h>
+#include <kernel/utility.h>
+#include <kernel/lock/guard.h>
+#include <kernel/time/timer_wheel.h>
+#include <driver/drivers.h>
+#include <driver/arm_timer.h>
+
+using namespace driver;
+
+/* Bits of CNTP_CTL_EL0 */
+#define CNTP_CTL_ENABLE (1 << 0)
+
+arm_timer::arm_timer() {
+	name = ("arm,armv7-timer");
+}
+
+bool arm_timer::isCompatible(const char* compatible) const {
+	return strcmp(compatible, "arm,armv7-timer") == 0 || strcmp(compatible, "arm,armv8-timer") == 0;
+}
+
+int arm_timer::init(const config& conf) {
+	/* Clear ticks */
+	intv = 0;
+	period = 0;
+	start = 0;
+	for (size_t i = 0; i < MAX_NUM_CPUS; i++) {
+		auto& state = tickStates.get(i);
+		state.ts = 0;
+		state.pending.store(0);
+		state.stopped.store(false);
+		state.avoided.store(0);
+	}
+
+	/* Prepare interrupt configuration (secure, non-secure, virtual and hypervisor timer) */
+	intConfig.first = conf.getInterruptRange().first;
+	intConfig.second = conf.getInterruptRange().second;
+	if (intConfig.first == nullptr || intConfig.second < (PHYS_NONSECURE_PPI + 1) * INTERRUPT_CELLS * sizeof(uint32_t))
+		return -EINVAL;
+
+	localIRQ = util::bigEndianToHost(static_cast<uint32_t*>(intConfig.first)[PHYS_NONSECURE_PPI * INTERRUPT_CELLS]);
+
+	/* Register at local interrupt controller (interrupt parent) */
+	if (int err = intc.registerLocalHandler(conf.getInterruptParent().first, localIRQ, this); err)
+		return err;
+
+	return 0;
+}
+
+int arm_timer::windup(size_t ms) {
+	auto now = ::CPU::getSystemCounter();
+
+	/* Boot CPU starts grid of ticks */
+	if (::CPU::getProcessorID() == 0) {
+		intv = ms;
+		period = (ms * ::CPU::getSystemCounterFrequency()) / 1000;
+		start = now;
+	}
+
+	if (period == 0 || ms != intv)
+		return -EINVAL;
+
+	/* Time stamp of (virtual) last tick */
+	auto& state = tickStates.get();
+	state.ts = start + math::roundDown(now - start, period);
+	program(nextTick(state, now));
+	return 0;
+}
+
+int arm_timer::registerFunction(size_t ms, lib::function<int(void)> callback) {
+	return time::timerWheel.registerFunction(math::roundUp(ms, intv) / intv, lib::move(callback));
+}
+
+int arm_timer::unregisterFunction(int id) {
+	return time::timerWheel.unregisterFunction(id);
+}
+
+size_t arm_timer::interval() const {
+	return intv;
+}
+
+size_t arm_timer::getTicks() const {
+	if (period == 0)
+		return 0;
+
+	return (::CPU::getSystemCounter() - start) / period;
+}
+
+uint64_t arm_timer::nextTick(const TickState& state, uint64_t now) const {
+	return state.ts + ((now - state.ts) / period + 1) * period;
+}
+
+void arm_timer::program(uint64_t deadline) {
+	/* Writing the compare value clears a pending interrupt */
+	asm volatile(
+		"msr CNTP_CVAL_EL0, %0\n\t"
+		"msr CNTP_CTL_EL0, %1\n\t"
+		"isb\n\t"
+		:
+		: "r"(deadline), "r"(static_cast<uint64_t>(CNTP_CTL_ENABLE))
+	);
+}
+
+void arm_timer::stopTick(uint64_t until) {
+	auto& state = tickStates.get();
+	auto now = ::CPU::getSystemCounter();
+
+	uint64_t deadline = now + MAX_IDLE_MS * (period / intv);
+	if (until != 0 && until < deadline)
+		deadline = until > now ? until : now;
+
+	/* Event is delivered with the first tick after it */
+	state.stopped.store(true, lib::memory_order_release);
+	program(state.ts + math::roundUp(deadline - state.ts, period));
+}
+
+void arm_timer::restartTick() {
+	lock::irqsave irq;
+
+	auto& state = tickStates.get();
+	if (!state.stopped.load(lib::memory_order_relaxed))
+		return;
+
+	state.stopped.store(false, lib::memory_order_release);
+	program(nextTick(state, ::CPU::getSystemCounter()));
+}
+
+bool arm_timer::isTickStopped(size_t cpuID) const {
+	return tickStates.get(cpuID).stopped.load(lib::memory_order_relaxed);
+}
+
+size_t arm_timer::getTicksAvoided(size_t cpuID) const {
+	return tickStates.get(cpuID).avoided.load(lib::memory_order_relaxed);
+}
+
+int arm_timer::prologue(irq::ExceptionContext* context) {
+	(void) context;
+
+	auto& state = tickStates.get();
+	auto now = ::CPU::getSystemCounter();
+
+	/* Update timer ticks (several ticks elapsed if tick was stopped) */
+	size_t elapsed = (now - state.ts) / period;
+	state.ts += elapsed * period;
+	state.pending.fetch_add(elapsed);
+
+	/* Windup timer (again), idle loop stops tick again if needed */
+	program(nextTick(state, now));
+
+	return elapsed > 0 ? 1 : 0;
+}
+
+int arm_timer::epilogue() {
+	auto& state = tickStates.get();
+	auto elapsed = state.pending.exchange(0);
+	if (elapsed == 0)
+		return 0;
+
+	state.avoided.fetch_add(elapsed - 1, lib::memory_order_relaxed);
+
+	/* Expire timers of current CPU */
+	time::timerWheel.run();
+	return 0;
+}
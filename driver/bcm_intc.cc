@@ -1,7 +1,10 @@
 #include "driver/drivers.h"
 #include <cerrno.h>
+#include <kernel/cpu.h>
 #include <kernel/error.h>
 #include <kernel/utility.h>
+#include <kernel/lock/rcu.h>
+#include <kernel/lock/guard.h>
 #include <driver/bcm_intc.h>
 
 using namespace driver;
@@ -9,8 +12,11 @@ using namespace driver;
 #define NUM_SETS    3
 #define NUM_ENTRIES 32
 #define FIXUP_RANGE 0x1000000
+#define NUM_CORES   4
+#define NUM_LOCAL   4
 
 generic_driver* bcm_intc::handlers[NUM_SETS * NUM_ENTRIES] = {nullptr};
+generic_driver* bcm_intc::localHandlers[NUM_LOCAL] = {nullptr};
 
 bcm_intc::bcm_intc() {
 	name = "brcm,bcm2836-armctrl-ic";
@@ -18,6 +24,7 @@ bcm_intc::bcm_intc() {
 
 int bcm_intc::init(const config& conf) {
 	base = reinterpret_cast<void*>(conf.getRange().first);
+	localBase = nullptr;
 
 	return 0;
 }
@@ -30,6 +37,8 @@ int bcm_intc::registerHandler(void* data, size_t size, generic_driver* driver) {
 	if ((size / sizeof(uint32_t)) % 2 != 0)
 		return -EINVAL;
 
+	lock::lock_guard guard(lock);
+
 	for (size_t i = 0; i < size / sizeof(uint32_t); i += 2) {
 		uint32_t set = util::bigEndianToHost(static_cast<uint32_t*>(data)[i]);
 		uint32_t entry = util::bigEndianToHost(static_cast<uint32_t*>(data)[i + 1]);
@@ -56,16 +65,79 @@ int bcm_intc::registerHandler(void* data, size_t size, generic_driver* driver) {
 
 		}
 
-		handlers[set * NUM_ENTRIES + entry] = driver;
+		lock::RCU::assign(handlers[set * NUM_ENTRIES + entry], driver);
+	}
+
+	return 0;
+}
+
+int bcm_intc::unregisterHandler(void* data, size_t size) {
+	if ((size / sizeof(uint32_t)) % 2 != 0)
+		return -EINVAL;
+
+	lock::lock_guard guard(lock);
+
+	for (size_t i = 0; i < size / sizeof(uint32_t); i += 2) {
+		uint32_t set = util::bigEndianToHost(static_cast<uint32_t*>(data)[i]);
+		uint32_t entry = util::bigEndianToHost(static_cast<uint32_t*>(data)[i + 1]);
+		if (set >=  NUM_SETS || entry >= NUM_ENTRIES)
+			return -EINVAL;
+
+		/* Disable entry (writing 1 disables it, 0 is ignored) */
+		if (set == 0) {
+			writeRegister<disable_basic_irqs>(1 << entry);
+
+		} else if (set == 1) {
+			writeRegister<disable_irqs_1>(1 << entry);
+
+		} else {
+			writeRegister<disable_irqs_2>(1 << entry);
+		}
+
+		/* Concurrent IRQs might still use driver (until a grace period elapsed) */
+		lock::RCU::assign(handlers[set * NUM_ENTRIES + entry], static_cast<generic_driver*>(nullptr));
+	}
+
+	return 0;
+}
+
+int bcm_intc::registerLocalHandler(void* parent, uint32_t irq, generic_driver* driver) {
+	/* Only the timer interrupts (CNTPS, CNTPNS, CNTHP, CNTV) are routed by control register */
+	if (parent == nullptr || irq >= NUM_LOCAL)
+		return -EINVAL;
+
+	lock::lock_guard guard(lock);
+
+	if (localBase != nullptr && localBase != parent)
+		return -EINVAL;
+
+	/* Route interrupt to IRQ (instead of FIQ) of each core */
+	for (size_t core = 0; core < NUM_CORES; core++) {
+		auto reg = localRegister(parent, core_timer_irqcntl, core);
+		util::mmioWrite(reg, util::mmioRead(reg) | (1 << irq));
 	}
 
+	lock::RCU::assign(localHandlers[irq], driver);
+	lock::RCU::assign(localBase, parent);
 	return 0;
 }
 
 generic_driver* bcm_intc::getHandler() {
+	/* Per-core interrupts of current CPU (level triggered, cleared by their driver) */
+	auto local = lock::RCU::dereference(localBase);
+	if (local != nullptr) {
+		auto pending = util::mmioRead(localRegister(local, core_irq_source, CPU::getProcessorID()));
+		for (size_t i = 0; i < NUM_LOCAL; i++) {
+			auto handler = lock::RCU::dereference(localHandlers[i]);
+			if (handler != nullptr && (pending & (1 << i)))
+				return handler;
+		}
+	}
+
 	for (size_t i = 0; i < NUM_SETS * NUM_ENTRIES; i++) {
 		/* Skip unused handlers */
-		if (handlers[i] == nullptr)
+		auto handler = lock::RCU::dereference(handlers[i]);
+		if (handler == nullptr)
 			continue;
 
 		/* Calculate set and entry */
@@ -80,7 +152,7 @@ generic_driver* bcm_intc::getHandler() {
 				/* Clear pending bit and branch to handler */
 				pending &= ~(1 << entry);
 				writeRegister<irq_basic_pending>(pending);
-				return handlers[i];
+				return handler;
 			}
 
 		/* Check pending 1 */
@@ -91,7 +163,7 @@ generic_driver* bcm_intc::getHandler() {
 				/* Clear pending bit and branch to handler */
 				pending &= ~(1 << entry);
 				writeRegister<irq_pending_1>(pending);
-				return handlers[i];
+				return handler;
 			}
 
 		/* Check pending 2 */
@@ -102,7 +174,7 @@ generic_driver* bcm_intc::getHandler() {
 				/* Clear pending bit and branch to handler */
 				pending &= ~(1 << entry);
 				writeRegister<irq_pending_2>(pending);
-				return handlers[i];
+				return handler;
 			}
 
 		}
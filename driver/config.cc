@@ -6,6 +6,12 @@ config::config(bool isValid) {
 	configSpace.first = nullptr;
 	configSpace.second = 0;
 
+	intSpace.first = nullptr;
+	intSpace.second = 0;
+
+	intParent.first = nullptr;
+	intParent.second = 0;
+
 	valid = isValid;
 }
 
@@ -27,6 +33,15 @@ lib::pair<void*, size_t> config::getInterruptRange() const {
 	return lib::pair(intSpace);
 }
 
+void config::setInterruptParent(void* addr, size_t size) {
+	intParent.first = addr;
+	intParent.second = size;
+}
+
+lib::pair<void*, size_t> config::getInterruptParent() const {
+	return lib::pair(intParent);
+}
+
 bool config::isValid() const {
 	return valid;
 }
@@ -1,4 +1,5 @@
 #include <cerrno.h>
+#include <cstring.h>
 #include <driver/generic_driver.h>
 
 using namespace driver;
@@ -13,6 +14,10 @@ const char* generic_driver::getName() const {
 	return name;
 }
 
+bool generic_driver::isCompatible(const char* compatible) const {
+	return strcmp(name, compatible) == 0;
+}
+
 size_t generic_driver::getNumDrivers() {
 	return driverNum;
 }
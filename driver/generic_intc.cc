@@ -16,6 +16,19 @@ int generic_intc::registerHandler(void* data, size_t size, generic_driver* drive
 	return -ENXIO;
 }
 
+int generic_intc::unregisterHandler(void* data, size_t size) {
+	(void) data;
+	(void) size;
+	return -ENXIO;
+}
+
+int generic_intc::registerLocalHandler(void* parent, uint32_t irq, generic_driver* driver) {
+	(void) parent;
+	(void) irq;
+	(void) driver;
+	return -ENXIO;
+}
+
 generic_driver* generic_intc::getHandler() const {
 	return makeError<generic_driver*>(-ENXIO);
 }
@@ -28,3 +28,28 @@ int generic_timer::registerFunction(size_t ms, lib::function<int(void)> callback
 
 	return -ENXIO;
 }
+
+void generic_timer::stopTick(uint64_t until) {
+	(void) until;
+}
+
+void generic_timer::restartTick() {
+}
+
+bool generic_timer::isTickStopped(size_t cpuID) const {
+	(void) cpuID;
+
+	return false;
+}
+
+size_t generic_timer::getTicksAvoided(size_t cpuID) const {
+	(void) cpuID;
+
+	return 0;
+}
+
+int generic_timer::unregisterFunction(int id) {
+	(void) id;
+
+	return -ENXIO;
+}
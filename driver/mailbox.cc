@@ -1,5 +1,6 @@
 #include <cerrno.h>
 #include <kernel/cpu.h>
+#include <kernel/lock/guard.h>
 #include <driver/drivers.h>
 #include <driver/mailbox.h>
 
@@ -35,7 +36,8 @@ int mailbox::sendIPI(size_t cpuID, IPI_MSG msg) {
 	(void) cpuID;
 	(void) msg;
 
-	lock.lock();
+	/* Epilogues send IPIs as well */
+	lock::softirq_guard guard(lock);
 
 	/* Save massage count (will be incremented by progolue) */
 	auto savedMsgCount = msgCounter.load();
@@ -47,10 +49,10 @@ int mailbox::sendIPI(size_t cpuID, IPI_MSG msg) {
 	} else if (cpuID == 1) {
 		writeRegister<MAILBOX_WRITE_CORE_1>(static_cast<uint32_t>(msg));
 
-	} if (cpuID == 2) {
+	} else if (cpuID == 2) {
 		writeRegister<MAILBOX_WRITE_CORE_2>(static_cast<uint32_t>(msg));
 
-	} if (cpuID == 3) {
+	} else if (cpuID == 3) {
 		writeRegister<MAILBOX_WRITE_CORE_3>(static_cast<uint32_t>(msg));
 
 	} else {
@@ -58,14 +60,15 @@ int mailbox::sendIPI(size_t cpuID, IPI_MSG msg) {
 	}
 
 	/* Wait for update */
-	while(savedMsgCount == msgCounter.load());
+	while(ret == 0 && savedMsgCount == msgCounter.load());
 
-	lock.unlock();
-
-	return ret;;
+	return ret;
 }
 
 int mailbox::registerHandler(IPI_MSG msg, lib::function<int()> handler) {
+	/* Epilogue reads handlers as well */
+	lock::softirq_guard guard(handlersLock);
+
 	for (size_t i = 0; i < numHandlers; i++) {
 		/* Find valid entry */
 		if (!handlers[i].second.isValid()) {
@@ -141,14 +144,17 @@ int mailbox::epilogue() {
 	uint32_t savedMsg = 0;
 	savedMsg = messages[cpuID].exchange(savedMsg);
 
-	for (size_t i = 0; i < numHandlers; i++) {
-		lock.lock();
-		auto isValid = handlers[i].second.isValid();
-		lock.unlock();
-		if (!isValid)
-			continue;
+	/* Take snapshot of registered handlers (without writing to shared lock) */
+	uint32_t handlerMsgs[numHandlers];
+	uint32_t seq;
+	do {
+		seq = handlersLock.readBegin();
+		for (size_t i = 0; i < numHandlers; i++)
+			handlerMsgs[i] = handlers[i].second.isValid() ? static_cast<uint32_t>(handlers[i].first) : 0;
+	} while (handlersLock.readRetry(seq));
 
-		if ((static_cast<uint32_t>(handlers[i].first) & savedMsg) == 0)
+	for (size_t i = 0; i < numHandlers; i++) {
+		if ((handlerMsgs[i] & savedMsg) == 0)
 			continue;
 
 		auto ret = handlers[i].second();
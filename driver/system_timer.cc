@@ -1,6 +1,9 @@
 #include <cerrno.h>
 #include <kernel/cpu.h>
 #include <kernel/math.h>
+#include <kernel/config.h>
+#include <kernel/lock/guard.h>
+#include <kernel/time/timer_wheel.h>
 #include <driver/cpu.h>
 #include <driver/drivers.h>
 #include <driver/system_timer.h>
@@ -19,9 +22,15 @@ int system_timer::init(const config& conf) {
 
 	/* Clear ticks */
 	ticks.store(0);
-
-	/* Clear idxCallback */
-	idxCallback = 0;
+	pending.store(0);
+	extended = false;
+	for (size_t i = 0; i < MAX_NUM_CPUS; i++) {
+		auto& state = tickStates.get(i);
+		state.stopped.store(false);
+		state.hasDeadline.store(false);
+		state.deadline.store(0);
+		state.avoided.store(0);
+	}
 
 	/* Prepare interrupt configuration */
 	intConfig.first = conf.getInterruptRange().first;
@@ -38,30 +47,19 @@ int system_timer::windup(size_t ms) {
 	if (::CPU::getProcessorID() != 0)
 		return 0;
 
+	/* Time stamp of (virtual) last tick */
 	intv = ms;
 	ts = readRegister<CLO>();
-	ts += ms * TICKS_PER_MS;
-	writeRegister<C1>(ts);
+	writeRegister<C1>(ts + ms * TICKS_PER_MS);
 	return 0;
 }
 
 int system_timer::registerFunction(size_t ms, lib::function<int(void)> callback) {
-	lock.lock();
-	if (idxCallback == MAX_CALLBACKS) {
-		lock.unlock();
-		return -ENOMEM;
-	}
-
-	size_t numTicks = math::roundUp(ms, intv) / intv;
-	callbacks[idxCallback] = lib::pair(numTicks, lib::move(callback));
-	if (!callbacks[idxCallback].second.isValid()) {
-		lock.unlock();
-		return -ENOMEM;
-	}
+	return time::timerWheel.registerFunction(math::roundUp(ms, intv) / intv, lib::move(callback));
+}
 
-	idxCallback++;
-	lock.unlock();
-	return 0;
+int system_timer::unregisterFunction(int id) {
+	return time::timerWheel.unregisterFunction(id);
 }
 
 size_t system_timer::interval() const {
@@ -76,34 +74,149 @@ size_t system_timer::getTicks() const {
 	return ticks.load();
 }
 
+uint32_t system_timer::nextTick(uint32_t now) const {
+	uint32_t period = intv * TICKS_PER_MS;
+
+	/* Ticks stay aligned to the time stamp of the last tick */
+	uint32_t next = ts + ((now - ts) / period + 1) * period;
+	if (next - now < MIN_DELTA)
+		next += period;
+
+	return next;
+}
+
+bool system_timer::isDue(size_t cpuID, uint32_t now) const {
+	auto& state = tickStates.get(cpuID);
+	if (!state.stopped.load(lib::memory_order_acquire))
+		return true;
+
+	if (!state.hasDeadline.load(lib::memory_order_relaxed))
+		return false;
+
+	return static_cast<int32_t>(now - state.deadline.load(lib::memory_order_relaxed)) >= 0;
+}
+
+uint32_t system_timer::nextEvent(uint32_t now) const {
+	auto tick = nextTick(now);
+
+#if NO_HZ
+	/* Search earliest event, unless a CPU needs its tick */
+	uint32_t earliest = now + MAX_IDLE_MS * TICKS_PER_MS;
+	auto numCPUs = driver::cpus.numCPUs();
+	for (size_t i = 0; i < numCPUs; i++) {
+		auto& state = tickStates.get(i);
+		if (!state.stopped.load(lib::memory_order_acquire))
+			return tick;
+
+		auto deadline = state.deadline.load(lib::memory_order_relaxed);
+		if (state.hasDeadline.load(lib::memory_order_relaxed) && static_cast<int32_t>(deadline - earliest) < 0)
+			earliest = deadline;
+	}
+
+	if (static_cast<int32_t>(earliest - tick) <= 0)
+		return tick;
+
+	/* Event is delivered with the first tick after it */
+	uint32_t period = intv * TICKS_PER_MS;
+	return ts + math::roundUp(earliest - ts, period);
+#else
+	return tick;
+#endif
+}
+
+void system_timer::stopTick(uint64_t until) {
+	auto& state = tickStates.get();
+
+	if (until != 0) {
+		/* Convert from system counter to timer ticks (limited to MAX_IDLE_MS) */
+		auto now = ::CPU::getSystemCounter();
+		auto perMs = ::CPU::getSystemCounterFrequency() / 1000;
+		uint64_t delta = until > now ? until - now : 0;
+		if (delta > MAX_IDLE_MS * perMs)
+			delta = MAX_IDLE_MS * perMs;
+
+		auto deadline = readRegister<CLO>() + static_cast<uint32_t>((delta * TICKS_PER_MS) / perMs);
+		state.deadline.store(deadline, lib::memory_order_relaxed);
+		state.hasDeadline.store(true, lib::memory_order_relaxed);
+	} else {
+		state.hasDeadline.store(false, lib::memory_order_relaxed);
+	}
+
+	/* Boot CPU reads deadline after stopped flag */
+	state.stopped.store(true, lib::memory_order_release);
+}
+
+void system_timer::restartTick() {
+	auto& state = tickStates.get();
+	if (!state.stopped.load(lib::memory_order_relaxed))
+		return;
+
+	state.stopped.store(false, lib::memory_order_release);
+
+	/* Compare register might be programmed beyond the next tick */
+	lock::irqsave_guard guard(tickLock);
+	if (!extended)
+		return;
+
+	writeRegister<C1>(nextTick(readRegister<CLO>()));
+	extended = false;
+}
+
+bool system_timer::isTickStopped(size_t cpuID) const {
+	return tickStates.get(cpuID).stopped.load(lib::memory_order_relaxed);
+}
+
+size_t system_timer::getTicksAvoided(size_t cpuID) const {
+	return tickStates.get(cpuID).avoided.load(lib::memory_order_relaxed);
+}
+
 int system_timer::prologue(irq::ExceptionContext* context) {
 	(void) context;
 
-	/* Update timer ticks */
-	this->ticks.fetch_add(1);
+	lock::lock_guard guard(tickLock);
+	auto now = readRegister<CLO>();
+
+	/* Update timer ticks (several ticks elapsed if all CPUs were idle) */
+	uint32_t period = this->intv * TICKS_PER_MS;
+	size_t elapsed = (now - this->ts) / period;
+	this->ts += elapsed * period;
+	this->ticks.fetch_add(elapsed);
+	this->pending.fetch_add(elapsed);
 
 	/* Windup timer (again) */
-	this->ts += this->intv * TICKS_PER_MS;
-	this->writeRegister<C1>(ts);
+	auto next = nextEvent(now);
+	this->extended = (next != nextTick(now));
+	this->writeRegister<C1>(next);
 	this->writeRegister<CS>(1 << 1);
 
-	return 1;
+	return elapsed > 0 ? 1 : 0;
 }
 
 int system_timer::epilogue() {
-	/* Call handlers */
-	lock.lock();
-	for (size_t i = 0; i < MAX_CALLBACKS; i++) {
-		auto& callback = callbacks[i];
-		if (ticks.load() % callback.first == 0) {
-			callback.second();
-		}
+	auto elapsed = pending.exchange(0);
+	if (elapsed == 0)
+		return 0;
+
+	auto now = readRegister<CLO>();
+
+	/* Expire timers of boot CPU */
+	if (isDue(0, now)) {
+		tickStates.get(0).avoided.fetch_add(elapsed - 1, lib::memory_order_relaxed);
+		time::timerWheel.run();
+	} else {
+		tickStates.get(0).avoided.fetch_add(elapsed, lib::memory_order_relaxed);
 	}
-	lock.unlock();
 
-	/* Send IPIs to remaining cores */
+	/* Send IPIs to remaining cores (unless their tick is stopped) */
 	auto numCPUs = driver::cpus.numCPUs();
 	for (size_t i = 1; i < numCPUs; i++) {
+		auto& state = tickStates.get(i);
+		if (!isDue(i, now)) {
+			state.avoided.fetch_add(elapsed, lib::memory_order_relaxed);
+			continue;
+		}
+
+		state.avoided.fetch_add(elapsed - 1, lib::memory_order_relaxed);
 		driver::ipi.sendIPI(i, driver::IPI::IPI_MSG::RESCHEDULE);
 	}
 
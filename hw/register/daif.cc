@@ -3,11 +3,11 @@
 using namespace hw::reg;
 
 void DAIF::read() {
-	asm("mrs %0, DAIF" : "=r"(value.value));
+	asm volatile("mrs %0, DAIF" : "=r"(value.value) :: "memory");
 }
 
 void DAIF::write() const {
-	asm("msr DAIF, %0" :: "r"(value.value));
+	asm volatile("msr DAIF, %0" :: "r"(value.value) : "memory");
 }
 
 hw::reg::DAIF::DAIF() {
@@ -49,3 +49,7 @@ void DAIF::setFiqMasked(bool masked) {
 	value.fiq = masked ? 1 : 0;
 	write();
 }
+
+void DAIF::restore() const {
+	write();
+}
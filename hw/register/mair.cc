@@ -51,4 +51,5 @@ int MAIR::setNormalAttribute(size_t entry, normal_attr_t inner, normal_attr_t ou
 void MAIR::useDefaultLayout() {
 	setDeviceAttribute(0, ngnre);
 	setNormalAttribute(1, nc, nc);
+	setNormalAttribute(2, wbntaraw, wbntaraw);
 }
@@ -7,7 +7,11 @@ void SCTLR::read() {
 }
 
 void SCTLR::write() const {
-	asm("msr SCTLR_EL1, %0" :: "r"(value.value));
+	asm(
+		"msr SCTLR_EL1, %0\n\t"
+		"isb\n\t"
+		:: "r"(value.value)
+	);
 }
 
 hw::reg::SCTLR::SCTLR() {
@@ -161,6 +161,15 @@ void TCR::setTTBR1GranuleSize(granuleSize val) {
 	write();
 }
 
+size_t TCR::getASIDSize() const {
+	return value.as ? 16 : 8;
+}
+
+void TCR::setASIDSize(size_t bits) {
+	value.as = bits == 16 ? 1 : 0;
+	write();
+}
+
 void TCR::useDefaultSetting() {
 	reset();
 
@@ -169,4 +178,16 @@ void TCR::useDefaultSetting() {
 
 	setTTBR0GranuleSize(size_4k);
 	setTTBR1GranuleSize(size_4k);
+
+	setTTBR1TableWalkDisabled(true);
+}
+
+void TCR::useCacheableTableWalks() {
+	setTTBR0InnerCach(normal_mem_inner_write_back_read_alloc_write_alloc_cach);
+	setTTBR0OuterCach(normal_mem_inner_write_back_read_alloc_write_alloc_cach);
+	setTTBR0Sharibility(inner_shareable);
+
+	setTTBR1InnerCach(normal_mem_inner_write_back_read_alloc_write_alloc_cach);
+	setTTBR1OuterCach(normal_mem_inner_write_back_read_alloc_write_alloc_cach);
+	setTTBR1Sharibility(inner_shareable);
 }
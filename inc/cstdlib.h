@@ -10,6 +10,25 @@
 
 namespace lib {
 
+	/**
+	 * @struct malloc_stats_t
+	 * @brief Usage statistics of the per-CPU cache of malloc/free
+	 * @details
+	 * Allocations of up to 4 KByte are served by
+	 * per-CPU free lists of power-of-two size classes, which are refilled
+	 * from and flushed to the buddy allocator in batches. Larger allocations
+	 * are directly passed to the buddy allocator.
+	 */
+	struct malloc_stats_t {
+		size_t hits;        /**< Number of allocations served from per-CPU cache */
+		size_t misses;      /**< Number of allocations which missed per-CPU cache */
+		size_t large;       /**< Number of allocations served by buddy allocator */
+		size_t frees;       /**< Number of frees */
+		size_t remoteFrees; /**< Number of frees of objects cached by another CPU */
+		size_t refills;     /**< Number of batched refills from buddy allocator */
+		size_t flushes;     /**< Number of batched flushes to buddy allocator */
+	};
+
 	/**
 	 * @fn void *malloc(size_t size)
 	 * @brief Allocate memory
@@ -50,6 +69,13 @@ namespace lib {
 	 */
 	void *realloc(void *ptr, size_t size);
 
+	/**
+	 * @fn malloc_stats_t malloc_stats(size_t cpuID)
+	 * @brief Get usage statistics of per-CPU cache of CPU cpuID
+	 * @warning cpuID must be less than MAX_NUM_CPUS
+	 */
+	malloc_stats_t malloc_stats(size_t cpuID);
+
 } /* namespace lib */
 
 #endif /* ifndef _INC_CSTDLIB_H_ */
@@ -0,0 +1,229 @@
+#ifndef _INC_DRIVER_ARM_TIMER_H_
+#define _INC_DRIVER_ARM_TIMER_H_
+
+#include <atomic.h>
+#include <cstdint.h>
+#include <kernel/cpu_local.h>
+#include <driver/config.h>
+#include <driver/generic_timer.h>
+
+/**
+ * @file driver/arm_timer.h
+ * @brief Driver for ARM Generic Timer (EL1 physical timer)
+ * @details
+ * Each CPU has its own timer (CNTP_CVAL_EL0 compared against the system
+ * counter CNTPCT_EL0), whose interrupt is routed to the CPU by the BCM2836
+ * local interrupt controller. Hence every CPU takes its own tick and expires
+ * its timers (see time::TimerWheel) itself, no IPIs are needed to forward the
+ * tick.
+ *
+ * Ticks of all CPUs are aligned to a common grid (starting with the windup on
+ * the boot CPU). With NO_HZ, an idle CPU programs its timer to its next event
+ * (rounded up to the grid, at most MAX_IDLE_MS ahead) and skipped ticks are
+ * accounted with the next interrupt.
+ */
+
+namespace driver {
+
+	/**
+	 * @class arm_timer
+	 * @brief ARM Generic Timer
+	 */
+	class arm_timer : public generic_timer {
+		private:
+			/**
+			 * @var intConfig
+			 * @brief Interrupt configuration
+			 */
+			lib::pair<void*, size_t> intConfig;
+
+			/**
+			 * @var localIRQ
+			 * @brief Interrupt of non-secure physical timer at local interrupt controller
+			 */
+			uint32_t localIRQ;
+
+			/**
+			 * @var PHYS_NONSECURE_PPI
+			 * @brief Index of non-secure physical timer within interrupts property
+			 */
+			static const size_t PHYS_NONSECURE_PPI = 1;
+
+			/**
+			 * @var INTERRUPT_CELLS
+			 * @brief Number of cells of interrupt specifier (of BCM2836 local interrupt controller)
+			 */
+			static const size_t INTERRUPT_CELLS = 2;
+
+			/**
+			 * @var MAX_IDLE_MS
+			 * @brief Maximal time (in ms) between two interrupts of an idle CPU
+			 */
+			static const uint32_t MAX_IDLE_MS = 1000;
+
+			/**
+			 * var intv
+			 * @brief Configured interval (in ms)
+			 */
+			uint32_t intv;
+
+			/**
+			 * @var period
+			 * @brief Configured interval (in system counter ticks)
+			 */
+			uint64_t period;
+
+			/**
+			 * @var start
+			 * @brief System counter at windup of boot CPU (start of tick grid)
+			 */
+			uint64_t start;
+
+			/**
+			 * @struct TickState
+			 * @brief Tick state of a single CPU (on its own cache line)
+			 */
+			struct alignas(64) TickState {
+				uint64_t ts;                  /**< System counter of last tick */
+				lib::atomic<size_t> pending;  /**< Number of ticks elapsed since last epilogue */
+				lib::atomic<bool> stopped;    /**< Tick is stopped (CPU is idle) */
+				lib::atomic<size_t> avoided;  /**< Number of ticks which weren't delivered */
+			};
+
+			/**
+			 * @var tickStates
+			 * @brief Per-CPU tick states
+			 */
+			cpu_local<TickState> tickStates;
+
+			/**
+			 * @fn uint64_t nextTick(const TickState& state, uint64_t now) const
+			 * @brief Get first tick (aligned to grid) after now
+			 */
+			uint64_t nextTick(const TickState& state, uint64_t now) const;
+
+			/**
+			 * @fn void program(uint64_t deadline)
+			 * @brief Program timer of current CPU to fire once the system counter reaches deadline
+			 */
+			void program(uint64_t deadline);
+
+		public:
+			/**
+			 * @fn arm_timer
+			 * @brief Constuctor of driver with sets name
+			 */
+			arm_timer();
+
+			/**
+			 * @fn bool isCompatible(const char* compatible) const override
+			 * @brief Check for ARMv7 or ARMv8 timer
+			 */
+			bool isCompatible(const char* compatible) const override;
+
+			/**
+			 * @fn int init(const config& conf)
+			 * @brief Intialize Timer
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int init(const config& conf);
+
+			/**
+			 * @fn int windup(size_t ms)
+			 * @brief Windup and activate timer of current CPU
+			 * @warning This function has to executed an all processors (starting with the boot CPU)
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int windup(size_t ms);
+
+			/**
+			 * @fn size_t interval() const
+			 * @brief Get current configured interval (in ms)
+			 */
+			size_t interval() const;
+
+			/**
+			 * @fn size_t getTicks() const
+			 * @brief Get number of ticks since startup
+			 */
+			size_t getTicks() const;
+
+			/**
+			 * @fn int registerFunction(size_t ms, lib::function<int(void)> callback)
+			 * @brief Register callback which is executed in a regular interval (on each CPU)
+			 * @details Callbacks are deferrable timers (see time::TimerWheel::registerFunction()).
+			 * With NO_HZ, callbacks are skipped on CPUs with stopped tick.
+			 * @warning ms must be multiple of interval
+			 * @return
+			 *
+			 *	- >=0 - ID of callback
+			 *	- <0  - Failure (-errno)
+			 */
+			int registerFunction(size_t ms, lib::function<int(void)> callback);
+
+			/**
+			 * @fn int unregisterFunction(int id)
+			 * @brief Unregister callback (which might still be executed by concurrent timers)
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int unregisterFunction(int id);
+
+			/**
+			 * @fn void stopTick(uint64_t until)
+			 * @brief Stop tick of current (idle) CPU until system counter reaches until (0 for no event)
+			 * @warning Interrupts must be disabled
+			 */
+			void stopTick(uint64_t until);
+
+			/**
+			 * @fn void restartTick()
+			 * @brief Restart tick of current CPU (leaving idle)
+			 */
+			void restartTick();
+
+			/**
+			 * @fn bool isTickStopped(size_t cpuID) const
+			 * @brief Check if tick of CPU cpuID is stopped
+			 */
+			bool isTickStopped(size_t cpuID) const;
+
+			/**
+			 * @fn size_t getTicksAvoided(size_t cpuID) const
+			 * @brief Get number of ticks which weren't delivered to CPU cpuID
+			 */
+			size_t getTicksAvoided(size_t cpuID) const;
+
+			/**
+			 * @fn int prologue(irq::ExceptionContext* context) override
+			 * @brief Exception prologue
+			 * @return
+			 *
+			 *	-  1 - Epilogue is needed
+			 *	-  0 - Epilogue isn't needed
+			 *	- <0 - Error (errno)
+			 */
+			int prologue(irq::ExceptionContext* context) override;
+
+			/**
+			 * @fn int epilogue() override
+			 * @brief Exception epilogue
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Error (errno)
+			 */
+			int epilogue() override;
+	};
+
+} /* namespace driver */
+
+#endif /* ifndef _INC_DRIVER_ARM_TIMER_H_ */
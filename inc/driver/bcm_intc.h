@@ -3,11 +3,17 @@
 
 #include <cstdint.h>
 #include <kernel/utility.h>
+#include <kernel/lock/spinlock.h>
 #include <driver/generic_intc.h>
 
 /**
  * @file driver/bcm_intc.h
  * @brief Driver for Broadcom 2835 Interrupt Controller
+ * @details
+ * Per-core interrupts (e.g. of the ARM generic timer) bypass the Broadcom 2835
+ * interrupt controller and are routed by the BCM2836 local interrupt
+ * controller (see registerLocalHandler()). Pending per-core interrupts of the
+ * current CPU are handled before the shared interrupts.
  */
 
 namespace driver {
@@ -41,12 +47,39 @@ namespace driver {
 				disable_basic_irqs = 0x24,
 			} regOffset;
 
+			/**
+			 * @enum localRegOffset
+			 * @brief Offsets for registers of local interrupt controller (of core 0, 4 bytes per core)
+			 */
+			typedef enum : uint16_t {
+				core_timer_irqcntl = 0x40, /**< Core timers interrupt control */
+				core_irq_source    = 0x60, /**< Core IRQ source */
+			} localRegOffset;
+
 			/**
 			 * @var handlers
-			 * @brief Available handlers
+			 * @brief Available handlers (read without lock, see lock::RCU)
 			 */
 			static generic_driver* handlers[96];
 
+			/**
+			 * @var localBase
+			 * @brief Base address of local interrupt controller (nullptr until first per-core handler)
+			 */
+			void* localBase;
+
+			/**
+			 * @var localHandlers
+			 * @brief Handlers of per-core timer interrupts (read without lock, see lock::RCU)
+			 */
+			static generic_driver* localHandlers[4];
+
+			/**
+			 * @var lock
+			 * @brief Lock of writers of handlers
+			 */
+			lock::spinlock lock;
+
 			/**
 			 * @fn void writeRegister(uint32_t value)
 			 * @brief Internal write register
@@ -67,6 +100,14 @@ namespace driver {
 				return util::mmioRead(reg);
 			}
 
+			/**
+			 * @fn uint32_t* localRegister(void* local, localRegOffset off, size_t core) const
+			 * @brief Get register of core within local interrupt controller local
+			 */
+			uint32_t* localRegister(void* local, localRegOffset off, size_t core) const {
+				return reinterpret_cast<uint32_t*>(reinterpret_cast<uintptr_t>(local) + off + core * sizeof(uint32_t));
+			}
+
 		public:
 			/**
 			 * @fn bcm_intc
@@ -94,6 +135,28 @@ namespace driver {
 			 */
 			int registerHandler(void* data, size_t size, generic_driver* driver);
 
+			/**
+			 * @fn int unregisterHandler(void* data, size_t size)
+			 * @brief Disable IRQs of driver specific configuration and unregister their driver
+			 * @warning The driver must stay valid until a grace period elapsed (see lock::RCU::synchronize)
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int unregisterHandler(void* data, size_t size);
+
+			/**
+			 * @fn int registerLocalHandler(void* parent, uint32_t irq, generic_driver* driver)
+			 * @brief Register driver for per-core timer interrupt irq of local interrupt controller parent
+			 * @details The interrupt is routed to (the IRQ line of) each core.
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int registerLocalHandler(void* parent, uint32_t irq, generic_driver* driver);
+
 			/**
 			 * @fn generic_driver* getHandler()
 			 * @brief Get handler for pending IRQ
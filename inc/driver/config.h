@@ -29,6 +29,12 @@ namespace driver {
 			 */
 			lib::pair<void*,size_t> intSpace;
 
+			/**
+			 * @var intParent
+			 * @brief Configuration space of interrupt parent
+			 */
+			lib::pair<void*,size_t> intParent;
+
 			/**
 			 * @var valid
 			 * @brief Check validity
@@ -66,6 +72,18 @@ namespace driver {
 			 */
 			lib::pair<void*, size_t> getInterruptRange() const;
 
+			/**
+			 * @fn void setInterruptParent(void* addr, size_t size)
+			 * @brief Set range of configuration space of interrupt parent
+			 */
+			void setInterruptParent(void* addr, size_t size);
+
+			/**
+			 * @fn lib::pair<void*, size_t> getInterruptParent() const
+			 * @brief Get range of configuration space of interrupt parent (nullptr if unknown)
+			 */
+			lib::pair<void*, size_t> getInterruptParent() const;
+
 			/**
 			 * @fn bool isValid() const
 			 * @brief Check if valid
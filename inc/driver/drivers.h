@@ -10,6 +10,7 @@
 #include <driver/mini_uart.h>
 #include <driver/bcm_intc.h>
 #include <driver/system_timer.h>
+#include <driver/arm_timer.h>
 #include <driver/mailbox.h>
 
 /**
@@ -63,9 +64,15 @@ namespace driver {
 /* Use broadcom system timer
  * Defiend in driver/system_timer.h
  */
-#if defined(CONFIG_INTC_BCM_SYS_TIMER)
+#if defined(CONFIG_TIMER_BCM_SYS_TIMER)
 	using Timer = system_timer;
 
+/* Use ARM generic timer
+ * Defiend in driver/arm_timer.h
+ */
+#elif defined(CONFIG_TIMER_ARM_GENERIC_TIMER)
+	using Timer = arm_timer;
+
 /* No valid choice for timer */
 #else
 	#error "No valid choice for Timer (see config file)"
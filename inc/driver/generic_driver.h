@@ -52,6 +52,12 @@ namespace driver {
 			 */
 			const char* getName() const;
 
+			/**
+			 * @fn virtual bool isCompatible(const char* compatible) const
+			 * @brief Check if driver supports device with compatible string
+			 */
+			virtual bool isCompatible(const char* compatible) const;
+
 			/**
 			 * @fn static size_t getNumDrivers()
 			 * @brief Get number of registered drivers
@@ -2,6 +2,7 @@
 #define _INC_DRIVER_GENERIC_INTERRUPT_CONTROLLER_H_
 
 #include <cstddef.h>
+#include <cstdint.h>
 #include <functional.h>
 #include <driver/config.h>
 #include <driver/generic_driver.h>
@@ -39,6 +40,26 @@ namespace driver {
 			 */
 			int registerHandler(void* data, size_t size, generic_driver* driver);
 
+			/**
+			 * @fn int unregisterHandler(void* data, size_t size)
+			 * @brief Unregister driver for driver specific configuration
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int unregisterHandler(void* data, size_t size);
+
+			/**
+			 * @fn int registerLocalHandler(void* parent, uint32_t irq, generic_driver* driver)
+			 * @brief Register driver for per-core interrupt irq of local interrupt controller parent (on all CPUs)
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int registerLocalHandler(void* parent, uint32_t irq, generic_driver* driver);
+
 			/**
 			 * @fn generic_driver* getHandler() const
 			 * @brief Get handler for pending IRQ
@@ -27,6 +27,7 @@ namespace driver {
 			enum class IPI_MSG : uint32_t {
 				PANIC = (1 << 0),      /**< Panic Broadcast */
 				RESCHEDULE = (1 << 1), /**< Panic Broadcast */
+				TLB_SHOOTDOWN = (1 << 2), /**< Invalidate queued TLB ranges */
 			};
 
 			/**
@@ -2,6 +2,7 @@
 #define _INC_DRIVER_GENERIC_TIMER_H_
 
 #include <cstddef.h>
+#include <cstdint.h>
 #include <functional.h>
 #include <driver/config.h>
 #include <driver/generic_driver.h>
@@ -57,10 +58,44 @@ namespace driver {
 			 * @warning ms must be multiple of interval
 			 * @return
 			 *
+			 *	- >=0 - ID of callback
+			 *	- <0  - Failure (-errno)
+			 */
+			int registerFunction(size_t ms, lib::function<int(void)> callback);
+
+			/**
+			 * @fn void stopTick(uint64_t until)
+			 * @brief Stop tick of current (idle) CPU until system counter reaches until (0 for no event)
+			 */
+			void stopTick(uint64_t until);
+
+			/**
+			 * @fn void restartTick()
+			 * @brief Restart tick of current CPU
+			 */
+			void restartTick();
+
+			/**
+			 * @fn bool isTickStopped(size_t cpuID) const
+			 * @brief Check if tick of CPU cpuID is stopped
+			 */
+			bool isTickStopped(size_t cpuID) const;
+
+			/**
+			 * @fn size_t getTicksAvoided(size_t cpuID) const
+			 * @brief Get number of ticks which weren't delivered to CPU cpuID
+			 */
+			size_t getTicksAvoided(size_t cpuID) const;
+
+			/**
+			 * @fn int unregisterFunction(int id)
+			 * @brief Unregister callback
+			 * @return
+			 *
 			 *	-  0 - Success
 			 *	- <0 - Failure (-errno)
 			 */
-			int registerFunction(size_t ms, lib::function<int(void)> callback);
+			int unregisterFunction(int id);
 	};
 
 } /* namespace driver */
@@ -1,6 +1,7 @@
 #ifndef _INC_DRIVER_MAILBOX_H_
 #define _INC_DRIVER_MAILBOX_H_
 
+#include "kernel/lock/seqlock.h"
 #include "kernel/lock/spinlock.h"
 #include <atomic.h>
 #include <cstdint.h>
@@ -96,6 +97,12 @@ namespace driver {
 
 			lib::pair<IPI_MSG, lib::function<int()>> handlers[numHandlers];
 
+			/**
+			 * @var handlersLock
+			 * @brief Lock of handlers (registered handlers are never replaced)
+			 */
+			lock::seqlock handlersLock;
+
 		public:
 			/**
 			 * @fn mailbox
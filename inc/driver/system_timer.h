@@ -4,6 +4,7 @@
 #include <atomic.h>
 #include <cstdint.h>
 #include <kernel/utility.h>
+#include <kernel/cpu_local.h>
 #include <driver/config.h>
 #include <driver/generic_timer.h>
 #include <kernel/lock/spinlock.h>
@@ -11,6 +12,18 @@
 /**
  * @file driver/system_timer.h
  * @brief Driver for BCM2835 System Timer
+ * @details
+ * The timer interrupt is taken by the boot CPU, which expires its timers (see
+ * time::TimerWheel) and forwards the tick to all other CPUs with the RESCHEDULE
+ * IPI (expiring their timers).
+ *
+ * With NO_HZ, idle CPUs stop their tick (see stopTick()) until their next
+ * timer event and only receive the IPI once this event is due. If all CPUs
+ * stopped their tick, the compare register is programmed to the next event
+ * (at most MAX_IDLE_MS ahead) instead of the next tick. Ticks stay aligned to
+ * the configured interval, skipped ticks are accounted (see getTicks()) with
+ * the next interrupt. A CPU leaving idle restarts its tick (see restartTick()).
+ * Deferrable timers of idle CPUs are expired once they process ticks again.
  */
 
 namespace driver {
@@ -29,12 +42,6 @@ namespace driver {
 			 */
 			lib::pair<void*, size_t> intConfig;
 
-			/**
-			 * @var lock
-			 * @brief Synchronaztion lock
-			 */
-			lock::spinlock lock;
-
 			/**
 			 * @enum regOffset
 			 * @brief Offsets for registers
@@ -77,7 +84,7 @@ namespace driver {
 
 			/**
 			 * @var ts
-			 * @brief Current time stamp
+			 * @brief Time stamp of last tick
 			 */
 			uint32_t ts;
 
@@ -88,22 +95,70 @@ namespace driver {
 			lib::atomic<size_t> ticks;
 
 			/**
-			 * @var MAX_CALLBACKS
-			 * @brief Number of registable callbacks
+			 * @var MAX_IDLE_MS
+			 * @brief Maximal time (in ms) between two interrupts if all CPUs are idle
+			 */
+			static const uint32_t MAX_IDLE_MS = 1000;
+
+			/**
+			 * @var MIN_DELTA
+			 * @brief Minimal distance (in timer ticks) of compare value to current time
+			 */
+			static const uint32_t MIN_DELTA = 50;
+
+			/**
+			 * @struct TickState
+			 * @brief Tick state of a single CPU (on its own cache line)
+			 */
+			struct alignas(64) TickState {
+				lib::atomic<bool> stopped;      /**< Tick is stopped (CPU is idle) */
+				lib::atomic<bool> hasDeadline;  /**< Stopped CPU has a timer event */
+				lib::atomic<uint32_t> deadline; /**< Timer value of next event of stopped CPU */
+				lib::atomic<size_t> avoided;    /**< Number of ticks which weren't delivered */
+			};
+
+			/**
+			 * @var tickStates
+			 * @brief Per-CPU tick states
+			 */
+			cpu_local<TickState> tickStates;
+
+			/**
+			 * @var tickLock
+			 * @brief Lock of compare register (taken with disabled interrupts)
 			 */
-			static const size_t MAX_CALLBACKS = 10;
+			lock::spinlock tickLock;
 
 			/**
-			 * @var callbacks
-			 * @brief Pair of number of (needed) ticks and the actual callback
+			 * @var extended
+			 * @brief Compare register is programmed beyond next tick (all CPUs are idle)
 			 */
-			lib::pair<size_t, lib::function<int(void)>> callbacks[MAX_CALLBACKS];
+			bool extended;
 
 			/**
-			 * @var idxCallback
-			 * @brief Current index in callbacks
+			 * @var pending
+			 * @brief Number of ticks elapsed since last epilogue
 			 */
-			size_t idxCallback;
+			lib::atomic<size_t> pending;
+
+			/**
+			 * @fn uint32_t nextTick(uint32_t now) const
+			 * @brief Get first tick (aligned to interval) after now (with distance of at least MIN_DELTA)
+			 */
+			uint32_t nextTick(uint32_t now) const;
+
+			/**
+			 * @fn bool isDue(size_t cpuID, uint32_t now) const
+			 * @brief Check if CPU cpuID needs tick (tick isn't stopped or its event is due)
+			 */
+			bool isDue(size_t cpuID, uint32_t now) const;
+
+			/**
+			 * @fn uint32_t nextEvent(uint32_t now) const
+			 * @brief Get time of next interrupt (tick or next event if all CPUs are idle)
+			 * @warning tickLock must be held
+			 */
+			uint32_t nextEvent(uint32_t now) const;
 
 		public:
 			/**
@@ -147,14 +202,51 @@ namespace driver {
 
 			/**
 			 * @fn int registerFunction(size_t ms, lib::function<int(void)> callback)
-			 * @brief Register callback which is executed in a regular interval
+			 * @brief Register callback which is executed in a regular interval (on each CPU)
+			 * @details Callbacks are deferrable timers (see time::TimerWheel::registerFunction()).
+			 * With NO_HZ, callbacks are skipped on CPUs with stopped tick.
 			 * @warning ms must be multiple of interval
 			 * @return
 			 *
+			 *	- >=0 - ID of callback
+			 *	- <0  - Failure (-errno)
+			 */
+			int registerFunction(size_t ms, lib::function<int(void)> callback);
+
+			/**
+			 * @fn int unregisterFunction(int id)
+			 * @brief Unregister callback (which might still be executed by concurrent timers)
+			 * @return
+			 *
 			 *	-  0 - Success
 			 *	- <0 - Failure (-errno)
 			 */
-			int registerFunction(size_t ms, lib::function<int(void)> callback);
+			int unregisterFunction(int id);
+
+			/**
+			 * @fn void stopTick(uint64_t until)
+			 * @brief Stop tick of current (idle) CPU until system counter reaches until (0 for no event)
+			 * @warning Interrupts must be disabled
+			 */
+			void stopTick(uint64_t until);
+
+			/**
+			 * @fn void restartTick()
+			 * @brief Restart tick of current CPU (leaving idle)
+			 */
+			void restartTick();
+
+			/**
+			 * @fn bool isTickStopped(size_t cpuID) const
+			 * @brief Check if tick of CPU cpuID is stopped
+			 */
+			bool isTickStopped(size_t cpuID) const;
+
+			/**
+			 * @fn size_t getTicksAvoided(size_t cpuID) const
+			 * @brief Get number of ticks which weren't delivered to CPU cpuID
+			 */
+			size_t getTicksAvoided(size_t cpuID) const;
 
 			/**
 			 * @fn int prologue(irq::ExceptionContext* context) override
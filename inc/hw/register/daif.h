@@ -111,6 +111,12 @@ class DAIF {
 		 * @brief Set mask for FIQs
 		 */
 		void setFiqMasked(bool masked);
+
+		/**
+		 * @fn void restore() const
+		 * @brief Write value of this object (e.g. read on construction) back into DAIF
+		 */
+		void restore() const;
 };
 
 } /* namespace hw::reg */
@@ -139,9 +139,11 @@ class MAIR {
 		 * @brief Set MAIR to default layout
 		 * @details:
 		 * The first entry of the MAIR will contain the device memory setting
-		 * (ngnrne) while the second entry will be used for normal memory
-		 * (outer non-cacheable, inner non-cacheable). All other entries will
-		 * remain the same as before.
+		 * (ngnre) while the second entry will be used for normal memory
+		 * (outer non-cacheable, inner non-cacheable). The third entry will be
+		 * used for cacheable normal memory (outer and inner write-back
+		 * non-transient, allocate read, allocate write). All other entries
+		 * will remain the same as before.
 		 */
 		void useDefaultLayout();
 };
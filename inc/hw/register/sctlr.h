@@ -61,6 +61,9 @@ class SCTLR {
 		/**
 		 * @fn void write() const
 		 * @brief Write value back into SCTLR
+		 * @details
+		 * The write is followed by an instruction barrier, so the new setting
+		 * is in effect for all subsequent instructions.
 		 */
 		void write() const;
 
@@ -261,15 +261,41 @@ class TCR {
 		 */
 		void setTTBR1GranuleSize(granuleSize val);
 
+		/**
+		 * @fn size_t getASIDSize() const
+		 * @brief Get ASID size (8 or 16 bits)
+		 */
+		size_t getASIDSize() const;
+
+		/**
+		 * @fn void setASIDSize(size_t bits)
+		 * @brief Set ASID size (8 or 16 bits)
+		 * @warning 16 bit ASIDs must be supported by the CPU (see ID_AA64MMFR0_EL1)
+		 */
+		void setASIDSize(size_t bits);
+
 		/**
 		 * @fn void useDefaultSetting()
 		 * @brief Use default setting
 		 * @details
 		 * In the default setting, the TCR will utilize (1 << 48) bytes for
 		 * TTBR0/TTRB1 region space while use 4K pages as its default page
-		 * size.
+		 * size. The ASID is taken from TTBR0 and table walks using TTBR1 are
+		 * disabled, as all mappings (kernel and user) are located in the
+		 * lower half.
 		 */
 		void useDefaultSetting();
+
+		/**
+		 * @fn void useCacheableTableWalks()
+		 * @brief Use cacheable table walks
+		 * @details
+		 * Translation table walks for TTBR0/TTBR1 will use inner and outer
+		 * write-back (read-allocate, write-allocate) cacheable and inner
+		 * shareable memory accesses. Therefore, translation tables must be
+		 * mapped as cacheable normal memory, too.
+		 */
+		void useCacheableTableWalks();
 };
 
 } /* namespace hw::reg */
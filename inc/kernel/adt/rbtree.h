@@ -1,6 +1,7 @@
 #ifndef _INC_KERNEL_ADT_RB_TREE_H_
 #define _INC_KERNEL_ADT_RB_TREE_H_
 
+#include <cassert.h>
 #include <cstddef.h>
 #include <cstdint.h>
 #include <cstring.h>
@@ -145,6 +146,12 @@ class RBTree {
 		 */
 		size_t count;
 
+		/**
+		 * @var leftmost
+		 * @brief Cached first node (or nullptr if tree is empty)
+		 */
+		RBNode* leftmost;
+
 		/**
 		 * @var cmp
 		 * @brief Compare function
@@ -415,6 +422,7 @@ class RBTree {
 			memset(&null_node, 0, sizeof(null_node));
 			root = &null_node;
 			count = 0;
+			leftmost = nullptr;
 		}
 
 		/**
@@ -442,6 +450,7 @@ class RBTree {
 		 */
 		RBNode* insert(RBNode* data) {
 			bool r = false;
+			bool isLeftmost = true;
 
 			/* We start at the root of the tree */
 			RBNode	*node = root;
@@ -457,6 +466,7 @@ class RBTree {
 					node = node->left;
 				} else {
 					node = node->right;
+					isLeftmost = false;
 				}
 			}
 
@@ -480,6 +490,10 @@ class RBTree {
 			/* Fix up the red-black properties... */
 			RBTree::insert_fixup(data);
 
+			/* Rotations don't change the order of nodes */
+			if (isLeftmost)
+				leftmost = data;
+
 			return data;
 		}
 
@@ -517,6 +531,10 @@ class RBTree {
 
 			count--;
 
+			/* Successor becomes first node */
+			if (to_delete == leftmost)
+				leftmost = to_delete->next();
+
 			/* make sure we have at most one non-leaf child */
 			if (to_delete->left != &null_node && to_delete->right != &null_node) {
 				/* swap with smallest from right subtree (or largest from left) */
@@ -616,20 +634,41 @@ class RBTree {
 		}
 
 		/**
-		 * @fn RBNode* first()
-		 * @brief Return fist entry
+		 * @fn RBNode* floor(const T& other)
+		 * @brief Find last node which is not greater than other
+		 * @param other Matching data
 		 * @return
 		 *
-		 *	- Pointer to first element - Success
+		 *	- Pointer to node - Success
 		 *	- nullptr - Failure
 		 */
-		RBNode* first() {
+		RBNode* floor(const T& other) {
 			RBNode* node = root;
+			RBNode* ret = nullptr;
 
-			if (root != &null_node)
-				for (node = root; node->left != &null_node; node = node->left);
+			while (node != &null_node) {
+				if (cmp(other, node->t)) {
+					node = node->left;
 
-			return node != &null_node ? node : nullptr;
+				} else {
+					ret = node;
+					node = node->right;
+				}
+			}
+
+			return ret;
+		}
+
+		/**
+		 * @fn RBNode* first()
+		 * @brief Return fist entry (in O(1))
+		 * @return
+		 *
+		 *	- Pointer to first element - Success
+		 *	- nullptr - Failure
+		 */
+		RBNode* first() {
+			return leftmost;
 		}
 
 		/**
@@ -33,26 +33,81 @@
  * @def STACK_SIZE
  * @brief Stack size in bytes
  */
-#if defined(CONFIGSTACK_SIZE_16)
+#if defined(CONFIG_STACK_SIZE_16)
 	#define STACK_SIZE (16 * 1024)
 
-#elif defined(CONFIGSTACK_SIZE_32)
+#elif defined(CONFIG_STACK_SIZE_32)
 	#define STACK_SIZE (32 * 1024)
 
-#elif defined(CONFIGSTACK_SIZE_64)
+#elif defined(CONFIG_STACK_SIZE_64)
 	#define STACK_SIZE (64 * 1024)
 
-#elif defined(CONFIGSTACK_SIZE_128)
+#elif defined(CONFIG_STACK_SIZE_128)
 	#define STACK_SIZE (128 * 1024)
 
-#elif defined(CONFIGSTACK_SIZE_256)
+#elif defined(CONFIG_STACK_SIZE_256)
 	#define STACK_SIZE (256 * 1024)
 
-#elif defined(CONFIGSTACK_SIZE_512)
+#elif defined(CONFIG_STACK_SIZE_512)
 	#define STACK_SIZE (512 * 1024)
 
 #else
 	#define STACK_SIZE (1024 * 1024)
 #endif
 
+/**
+ * @def NO_HZ
+ * @brief Stop timer tick of idle CPUs
+ */
+#if defined(CONFIG_NO_HZ_DISABLED)
+	#define NO_HZ 0
+
+#else
+	#define NO_HZ 1
+#endif
+
+/**
+ * @def CACHED_MEMORY
+ * @brief Use write-back cacheable normal memory (and enable caches)
+ */
+#if defined(CONFIG_MEMORY_UNCACHED)
+	#define CACHED_MEMORY 0
+
+#else
+	#define CACHED_MEMORY 1
+#endif
+
+/**
+ * @def TLB_SHOOTDOWN_IPI
+ * @brief Invalidate TLB entries of other CPUs via IPIs (instead of broadcast TLB maintenance)
+ */
+#if defined(CONFIG_TLB_SHOOTDOWN_IPI)
+	#define TLB_SHOOTDOWN_IPI 1
+
+#else
+	#define TLB_SHOOTDOWN_IPI 0
+#endif
+
+/**
+ * @def LOCK_BENCHMARK
+ * @brief Run spinlock contention benchmark during boot
+ */
+#if defined(CONFIG_LOCK_BENCHMARK_ENABLED)
+	#define LOCK_BENCHMARK 1
+
+#else
+	#define LOCK_BENCHMARK 0
+#endif
+
+/**
+ * @def LOCK_STATISTICS
+ * @brief Record hold times of locks and IRQ-off times (see kernel/lock/statistics.h)
+ */
+#if defined(CONFIG_LOCK_STATISTICS_ENABLED)
+	#define LOCK_STATISTICS 1
+
+#else
+	#define LOCK_STATISTICS 0
+#endif
+
 #endif /* ifndef _INC_KENREL_CONFIG_H_ */
@@ -2,6 +2,7 @@
 #define _INC_KERNEL_CPU_H_
 
 #include <cstddef.h>
+#include <cstdint.h>
 
 /**
  * @file kernel/cpu.h
@@ -58,12 +59,70 @@ namespace CPU {
 	 */
 	void invalidatePage(void *vaddr);
 
+	/**
+	 * @fn void invalidatePages(void *vaddr, size_t num)
+	 * @brief Invalidate num consecutive pages starting at vaddr (using a single barrier sequence)
+	 */
+	void invalidatePages(void *vaddr, size_t num);
+
+	/**
+	 * @fn void invalidateLocalPages(void *vaddr, size_t num)
+	 * @brief Invalidate num consecutive pages starting at vaddr in TLB of current CPU only
+	 */
+	void invalidateLocalPages(void *vaddr, size_t num);
+
 	/**
 	 * @fn void invalidateTLB()
 	 * @brief invalidate whole TLB
 	 */
 	void invalidateTLB();
 
+	/**
+	 * @fn void invalidateLocalTLB()
+	 * @brief Invalidate whole TLB of current CPU only
+	 */
+	void invalidateLocalTLB();
+
+	/**
+	 * @fn void invalidateASID(size_t asid)
+	 * @brief Invalidate all non-global TLB entries tagged with asid
+	 */
+	void invalidateASID(size_t asid);
+
+	/**
+	 * @fn size_t getASIDBits()
+	 * @brief Get number of supported ASID bits (8 or 16)
+	 */
+	size_t getASIDBits();
+
+	/**
+	 * @fn void invalidateDataCache()
+	 * @brief Invalidate all data and unified caches by set/way
+	 * @warning
+	 * Dirty cache lines are discarded and set/way operations also affect
+	 * caches shared with other CPUs. Therefore, this function must only be
+	 * used by the boot CPU before enabling the data cache.
+	 */
+	void invalidateDataCache();
+
+	/**
+	 * @fn void invalidateInstrCache()
+	 * @brief Invalidate whole instruction cache
+	 */
+	void invalidateInstrCache();
+
+	/**
+	 * @fn void cleanDataCache(void* addr, size_t size)
+	 * @brief Clean data cache lines of [addr, addr + size) to point of coherency
+	 */
+	void cleanDataCache(void* addr, size_t size);
+
+	/**
+	 * @fn void cleanInvalidateDataCache(void* addr, size_t size)
+	 * @brief Clean and invalidate data cache lines of [addr, addr + size) to point of coherency
+	 */
+	void cleanInvalidateDataCache(void* addr, size_t size);
+
 	/**
 	 * @fn size_t getProcessorID()
 	 * @brief Get processor ID
@@ -76,12 +135,30 @@ namespace CPU {
 	 */
 	void setTranslationTable(void *addr);
 
+	/**
+	 * @fn void setTranslationTable(void *addr, size_t asid)
+	 * @brief Update TTBR0 with translation table at addr tagged with asid
+	 */
+	void setTranslationTable(void *addr, size_t asid);
+
 	/**
 	 * @fn void* getTranslationTable()
-	 * @brief Receive current value of TTBR0
+	 * @brief Receive current translation table of TTBR0 (without ASID)
 	 */
 	void* getTranslationTable();
 
+	/**
+	 * @fn uint64_t getSystemCounter()
+	 * @brief Get current value of system counter (CNTPCT_EL0)
+	 */
+	uint64_t getSystemCounter();
+
+	/**
+	 * @fn uint64_t getSystemCounterFrequency()
+	 * @brief Get frequency of system counter in Hz (CNTFRQ_EL0)
+	 */
+	uint64_t getSystemCounterFrequency();
+
 	/**
 	 * @fn void halt()
 	 * @brief Enter power-saving halt mode (WFE instruction)
@@ -100,6 +177,12 @@ namespace CPU {
 	 */
 	void dataBarrier();
 
+	/**
+	 * @fn void instrBarrier()
+	 * @brief Instruction barrier (ISB instruction)
+	 */
+	void instrBarrier();
+
 } /* namespace CPU */
 
 #endif /* ifndef _INC_KERNEL_CPU_H_ */
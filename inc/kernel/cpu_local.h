@@ -1,34 +1,52 @@
 #ifndef _INC_KERNEL_CPU_LOCAL_H_
 #define _INC_KERNEL_CPU_LOCAL_H_
 
-#include <cstdlib.h>
-#include <kernel/cpu.h>
+#include <new.h>
+#include <cstddef.h>
+#include <cstdint.h>
 #include <kernel/config.h>
+#include <kernel/percpu.h>
 
 /**
  * @file kernel/cpu_local.h
  * @brief CPU local data
+ * @details
+ * The copies of all CPUs are stored in the per-CPU areas (see
+ * kernel/percpu.h) at the same offset. Accessing the copy of the current CPU
+ * reads the base of its area from TPIDR_EL1 and adds the offset.
  */
 
 /**
  * @class cpu_local
  * @brief CPU local data
+ * @warning Slots are never released, hence cpu_local must only be used for global objects (or their members)
  */
 template<typename T>
 class cpu_local {
 	private:
 		/**
-		 * @var t
-		 * @brief CPU local data
+		 * @var offset
+		 * @brief Offset of slot within per-CPU areas
 		 */
-		T t[MAX_NUM_CPUS];
+		size_t offset;
+
+		/**
+		 * @fn T* slot(uintptr_t base) const
+		 * @brief Get slot within per-CPU area at base
+		 */
+		T* slot(uintptr_t base) const {
+			return reinterpret_cast<T*>(base + offset);
+		}
 
 	public:
 		/**
 		 * @fn cpu_local()
 		 * @brief Default initialization
 		 */
-		cpu_local() { }
+		cpu_local() : offset(percpu::allocate(sizeof(T), alignof(T))) {
+			for (size_t i = 0; i < MAX_NUM_CPUS; i++)
+				::new (slot(percpu::getArea(i))) T();
+		}
 
 		cpu_local(const cpu_local& other) = delete;
 
@@ -38,9 +56,9 @@ class cpu_local {
 		 * @fn cpu_local(const T& other)
 		 * @brief Initialize with defaut value
 		 */
-		cpu_local(const T& other) {
+		cpu_local(const T& other) : offset(percpu::allocate(sizeof(T), alignof(T))) {
 			for (size_t i = 0; i < MAX_NUM_CPUS; i++)
-				t = other;
+				::new (slot(percpu::getArea(i))) T(other);
 		}
 
 		/**
@@ -48,7 +66,7 @@ class cpu_local {
 		 * @brief Get CPU local data
 		 */
 		T& get() {
-			return t[CPU::getProcessorID()];
+			return *slot(percpu::getBase());
 		}
 
 		/**
@@ -56,7 +74,25 @@ class cpu_local {
 		 * @brief Get CPU local data
 		 */
 		const T& get() const {
-			return t[CPU::getProcessorID()];
+			return *slot(percpu::getBase());
+		}
+
+		/**
+		 * @fn T& get(size_t cpuID)
+		 * @brief Get CPU local data of CPU cpuID
+		 * @warning cpuID must be less than MAX_NUM_CPUS
+		 */
+		T& get(size_t cpuID) {
+			return *slot(percpu::getArea(cpuID));
+		}
+
+		/**
+		 * @fn const T& get(size_t cpuID) const
+		 * @brief Get CPU local data of CPU cpuID
+		 * @warning cpuID must be less than MAX_NUM_CPUS
+		 */
+		const T& get(size_t cpuID) const {
+			return *slot(percpu::getArea(cpuID));
 		}
 };
 
@@ -0,0 +1,78 @@
+#ifndef _INC_KERNEL_CPU_MASK_H_
+#define _INC_KERNEL_CPU_MASK_H_
+
+#include <atomic.h>
+#include <cstddef.h>
+#include <cstdint.h>
+#include <kernel/config.h>
+
+/**
+ * @file kernel/cpu_mask.h
+ * @brief Set of CPUs
+ */
+
+/**
+ * @class cpu_mask
+ * @brief Atomic set of CPUs (one bit per CPU)
+ */
+class cpu_mask {
+	private:
+		/**
+		 * @var NUM_WORDS
+		 * @brief Number of words needed for MAX_NUM_CPUS bits
+		 */
+		static const size_t NUM_WORDS = (MAX_NUM_CPUS + 63) / 64;
+
+		/**
+		 * @var words
+		 * @brief Bits of all CPUs
+		 */
+		lib::atomic<uint64_t> words[NUM_WORDS];
+
+	public:
+		/**
+		 * @fn cpu_mask()
+		 * @brief Create empty set
+		 */
+		cpu_mask() {
+			for (size_t i = 0; i < NUM_WORDS; i++)
+				words[i].store(0);
+		}
+
+		cpu_mask(const cpu_mask& other) = delete;
+
+		cpu_mask(cpu_mask&& other) = delete;
+
+		cpu_mask& operator=(const cpu_mask& other) = delete;
+
+		cpu_mask& operator=(cpu_mask&& other) = delete;
+
+		/**
+		 * @fn void set(size_t cpuID)
+		 * @brief Add CPU cpuID to set
+		 * @warning cpuID must be less than MAX_NUM_CPUS
+		 */
+		void set(size_t cpuID) {
+			words[cpuID / 64].fetch_or(static_cast<uint64_t>(1) << (cpuID % 64));
+		}
+
+		/**
+		 * @fn void clear(size_t cpuID)
+		 * @brief Remove CPU cpuID from set
+		 * @warning cpuID must be less than MAX_NUM_CPUS
+		 */
+		void clear(size_t cpuID) {
+			words[cpuID / 64].fetch_and(~(static_cast<uint64_t>(1) << (cpuID % 64)));
+		}
+
+		/**
+		 * @fn bool test(size_t cpuID) const
+		 * @brief Check if CPU cpuID is part of set
+		 * @warning cpuID must be less than MAX_NUM_CPUS
+		 */
+		bool test(size_t cpuID) const {
+			return (words[cpuID / 64].load() >> (cpuID % 64)) & 1;
+		}
+};
+
+#endif /* ifndef _INC_KERNEL_CPU_MASK_H_ */
@@ -20,14 +20,14 @@ namespace debug::panic {
 	 * @brief Generate panic
 	 * @warning This will stop the whole system
 	 */
-	void generate(const char msg[]);
+	[[noreturn]] void generate(const char msg[]);
 
 	/**
 	 * @fn void generateFromIRQ(const char msg[], irq::ExceptionContext* exceptionContext)
 	 * @brief Generate panic (as viewed in exceptionContext)
 	 * @warning This will stop the whole system
 	 */
-	void generateFromIRQ(const char msg[], irq::ExceptionContext* exceptionContext);
+	[[noreturn]] void generateFromIRQ(const char msg[], irq::ExceptionContext* exceptionContext);
 }
 
 #endif /* ifndef _INC_KERNEL_DEBUG_PANIC_H_ */
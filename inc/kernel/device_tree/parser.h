@@ -39,6 +39,22 @@ namespace DeviceTree {
 			 */
 			bool valid;
 
+			/**
+			 * @fn lib::pair<void*, size_t> findRegister(const Node& node) const
+			 * @brief Get first entry of reg property of node (translated by ranges of parent)
+			 * @return
+			 *
+			 *	- Address and size - Success
+			 *	- nullptr and 0    - Failure (no reg property)
+			 */
+			lib::pair<void*, size_t> findRegister(const Node& node) const;
+
+			/**
+			 * @fn Node findInterruptParent(const Node& node) const
+			 * @brief Find node referenced by (inherited) interrupt-parent property (or invalid node)
+			 */
+			Node findInterruptParent(const Node& node) const;
+
 		public:
 			/**
 			 * @fn explicit Parser(void* rawData)
@@ -74,6 +90,7 @@ namespace DeviceTree {
 			/**
 			 * @fn driver::config findConfig(const driver::generic_driver& driver) const
 			 * @brief Find configuration for given driver based of the driver name
+			 * @details Any entry of the compatible property is matched (see generic_driver::isCompatible).
 			 */
 			driver::config findConfig(const driver::generic_driver& driver) const;
 
@@ -83,6 +100,16 @@ namespace DeviceTree {
 			 */
 			lib::pair<void*, size_t> getConfigSpace() const;
 
+			/**
+			 * @fn lib::pair<void*, size_t> getReservedMemory(size_t idx) const
+			 * @brief Get entry idx of memory reservation block (/memreserve/)
+			 * @return
+			 *
+			 *	- Address and size - Success
+			 *	- nullptr and 0    - Failure (no such entry)
+			 */
+			lib::pair<void*, size_t> getReservedMemory(size_t idx) const;
+
 			/**
 			 * @fn int createMapping() const
 			 * @brief Create mapping for device tree parser and associated devices
@@ -83,6 +83,16 @@ namespace irq {
 			 */
 			int prologue_instr_abort_elc(irq::ExceptionContext* context);
 
+			/**
+			 * @fn bool resolve(Actor actor, Operation operation)
+			 * @brief Try to resolve translation fault by populating demand-paged area of active address space
+			 * @return
+			 *
+			 *	- true  - Fault was resolved (faulting instruction can be retried)
+			 *	- false - otherwise
+			 */
+			bool resolve(Actor actor, Operation operation);
+
 			/**
 			 * @fn void panic(Actor actor, Operation operation, Cause cause, irq::ExceptionContext* context)
 			 * @brief Specialized Panic for dumping all pagefault related information
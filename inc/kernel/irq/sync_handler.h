@@ -1,6 +1,7 @@
 #ifndef _INC_KERNEL_IRQ_SYNC_HANDLER_H_
 #define _INC_KERNEL_IRQ_SYNC_HANDLER_H_
 
+#include <kernel/lock/spinlock.h>
 #include <kernel/irq/generic_sync_handler.h>
 
 /**
@@ -26,10 +27,16 @@ namespace irq {
 			static const size_t NUM_HANDLERS = (1 << 6);
 			/**
 			 * @var handlers
-			 * @brief List of handlers
+			 * @brief List of handlers (read without lock, see lock::RCU)
 			 */
 			irq::GenericSyncHandler* handlers[NUM_HANDLERS] = {0};
 
+			/**
+			 * @var lock
+			 * @brief Lock of writers of handlers
+			 */
+			lock::spinlock lock;
+
 		public:
 			/**
 			 * @fn int registerHandler(GenericSyncHandler* handler)
@@ -41,6 +48,17 @@ namespace irq {
 			 */
 			int registerHandler(GenericSyncHandler* handler);
 
+			/**
+			 * @fn int unregisterHandler(GenericSyncHandler* handler)
+			 * @brief Unregister handler
+			 * @warning The handler must stay valid until a grace period elapsed (see lock::RCU::synchronize)
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int unregisterHandler(GenericSyncHandler* handler);
+
 			/**
 			 * @fn driver::generic_driver* getHandler()
 			 * @brief Get Handler for pending exception
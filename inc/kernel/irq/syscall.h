@@ -39,7 +39,7 @@ namespace irq {
 			 * @var NUM_HANDLERS
 			 * @brief Maximum number of system call handlers
 			 */
-			static const size_t NUM_HANDLERS = 255;
+			static const size_t NUM_HANDLERS = 1024;
 
 			/**
 			 * @var handlers
@@ -0,0 +1,125 @@
+#ifndef _INC_KERNEL_LOCK_BENCHMARK_H_
+#define _INC_KERNEL_LOCK_BENCHMARK_H_
+
+#include <atomic.h>
+#include <cstddef.h>
+#include <cstdint.h>
+#include <kernel/cpu_local.h>
+
+/**
+ * @file kernel/lock/benchmark.h
+ * @brief Spinlock contention benchmark
+ * @details
+ * All CPUs repeatedly acquire a shared lock, update a shared counter and
+ * release the lock for DURATION_MS milliseconds. This is done with 1 up to all
+ * CPUs, both for a plain test-and-set lock (as reference) and for
+ * lock::spinlock. For each run, the number of acquisitions per millisecond and
+ * the smallest and largest number of acquisitions of a single CPU (fairness)
+ * are printed.
+ * @see CONFIG_LOCK_BENCHMARK
+ */
+
+namespace lock {
+
+	/**
+	 * @class Benchmark
+	 * @brief Spinlock contention benchmark
+	 */
+	class Benchmark {
+		public:
+			/**
+			 * @var DURATION_MS
+			 * @brief Duration of a single run in milliseconds
+			 */
+			static const uint64_t DURATION_MS = 100;
+
+		private:
+			/**
+			 * @struct Counter
+			 * @brief Number of acquisitions of a CPU (on its own cache line)
+			 */
+			struct alignas(64) Counter {
+				size_t value;
+			};
+
+			/**
+			 * @var arrived
+			 * @brief Number of CPUs waiting at barrier
+			 */
+			lib::atomic<size_t> arrived;
+
+			/**
+			 * @var phase
+			 * @brief Number of completed barriers
+			 */
+			lib::atomic<size_t> phase;
+
+			/**
+			 * @var stop
+			 * @brief Current run is finished
+			 */
+			lib::atomic<size_t> stop;
+
+			/**
+			 * @var counters
+			 * @brief Acquisitions per CPU
+			 */
+			cpu_local<Counter> counters;
+
+			/**
+			 * @var shared
+			 * @brief Data protected by the benchmarked lock
+			 */
+			alignas(64) size_t shared;
+
+			/**
+			 * @fn void barrier()
+			 * @brief Wait until all CPUs (see driver::cpus) reached the barrier
+			 */
+			void barrier();
+
+			/**
+			 * @fn void measure(Lock& lock, const char* name, size_t participants)
+			 * @brief Measure lock with first participants CPUs (called by all CPUs)
+			 */
+			template<typename Lock>
+			void measure(Lock& lock, const char* name, size_t participants);
+
+			/**
+			 * @fn void report(const char* name, size_t participants)
+			 * @brief Print results of last run
+			 */
+			void report(const char* name, size_t participants);
+
+		public:
+			/**
+			 * @fn Benchmark()
+			 * @brief Create benchmark
+			 */
+			Benchmark();
+
+			Benchmark(const Benchmark& other) = delete;
+
+			Benchmark(Benchmark&& other) = delete;
+
+			Benchmark& operator=(const Benchmark& other) = delete;
+
+			Benchmark& operator=(Benchmark&& other) = delete;
+
+			/**
+			 * @fn void run()
+			 * @brief Run benchmark
+			 * @warning This function must be called by all CPUs (with disabled interrupts)
+			 */
+			void run();
+	};
+
+	/**
+	 * @var benchmark
+	 * @brief Global spinlock benchmark
+	 */
+	extern Benchmark benchmark;
+
+} /* namespace lock */
+
+#endif /* ifndef _INC_KERNEL_LOCK_BENCHMARK_H_ */
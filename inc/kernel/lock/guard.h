@@ -0,0 +1,293 @@
+#ifndef _INC_KERNEL_LOCK_GUARD_H_
+#define _INC_KERNEL_LOCK_GUARD_H_
+
+#include <cstdint.h>
+#include <kernel/cpu.h>
+#include <kernel/config.h>
+#include <kernel/lock/softirq.h>
+#include <kernel/lock/spinlock.h>
+#include <kernel/lock/statistics.h>
+#include <hw/register/daif.h>
+
+/**
+ * @file kernel/lock/guard.h
+ * @brief RAII guards for locks, interrupts and epilogues
+ * @details
+ * Which guard must be used depends on the contexts a lock is taken in:
+ *
+ *	- lock_guard:    Lock is never taken by prologues or epilogues
+ *	                 (or interrupts are already disabled by the caller)
+ *	- shared_guard:  Like lock_guard, but for readers (see kernel/lock/rwlock.h)
+ *	- softirq_guard: Lock is taken by epilogues (but not by prologues)
+ *	- irqsave_guard: Lock is taken with disabled interrupts (e.g. by prologues)
+ *
+ * Taking such a lock without the matching guard allows an interrupt on the same
+ * CPU to spin on the lock held by the interrupted code forever.
+ * irqsave saves DAIF on construction and restores it on destruction, so guards
+ * can be nested and used with disabled interrupts. If CONFIG_LOCK_STATISTICS =
+ * ENABLED is used, hold times and IRQ-off times are recorded (see
+ * kernel/lock/statistics.h).
+ */
+
+namespace lock {
+
+	/**
+	 * @class lock_guard
+	 * @brief Hold lock for lifetime of guard
+	 */
+	template<typename Lock = spinlock>
+	class lock_guard {
+		private:
+			/**
+			 * @var lock
+			 * @brief Held lock
+			 */
+			Lock& lock;
+
+			/**
+			 * @var start
+			 * @brief Value of system counter after locking
+			 */
+			uint64_t start;
+
+		public:
+			/**
+			 * @fn lock_guard(Lock& lock)
+			 * @brief Lock lock
+			 */
+			explicit lock_guard(Lock& lock) : lock(lock), start(0) {
+				lock.lock();
+				if (LOCK_STATISTICS)
+					start = CPU::getSystemCounter();
+			}
+
+			/**
+			 * @fn ~lock_guard()
+			 * @brief Unlock lock
+			 */
+			~lock_guard() {
+				uint64_t end = LOCK_STATISTICS ? CPU::getSystemCounter() : 0;
+				lock.unlock();
+				if (LOCK_STATISTICS)
+					lockStatistics.recordHold(end - start);
+			}
+
+			lock_guard(const lock_guard& other) = delete;
+
+			lock_guard(lock_guard&& other) = delete;
+
+			lock_guard& operator=(const lock_guard& other) = delete;
+
+			lock_guard& operator=(lock_guard&& other) = delete;
+	};
+
+	/**
+	 * @class shared_guard
+	 * @brief Hold lock shared (e.g. as reader of an rwlock) for lifetime of guard
+	 */
+	template<typename Lock>
+	class shared_guard {
+		private:
+			/**
+			 * @var lock
+			 * @brief Held lock
+			 */
+			Lock& lock;
+
+			/**
+			 * @var start
+			 * @brief Value of system counter after locking
+			 */
+			uint64_t start;
+
+		public:
+			/**
+			 * @fn shared_guard(Lock& lock)
+			 * @brief Lock lock shared
+			 */
+			explicit shared_guard(Lock& lock) : lock(lock), start(0) {
+				lock.lockShared();
+				if (LOCK_STATISTICS)
+					start = CPU::getSystemCounter();
+			}
+
+			/**
+			 * @fn ~shared_guard()
+			 * @brief Unlock lock
+			 */
+			~shared_guard() {
+				uint64_t end = LOCK_STATISTICS ? CPU::getSystemCounter() : 0;
+				lock.unlockShared();
+				if (LOCK_STATISTICS)
+					lockStatistics.recordHold(end - start);
+			}
+
+			shared_guard(const shared_guard& other) = delete;
+
+			shared_guard(shared_guard&& other) = delete;
+
+			shared_guard& operator=(const shared_guard& other) = delete;
+
+			shared_guard& operator=(shared_guard&& other) = delete;
+	};
+
+	/**
+	 * @class irqsave
+	 * @brief Disable interrupts for lifetime of object (and restore DAIF afterwards)
+	 */
+	class irqsave {
+		private:
+			/**
+			 * @var saved
+			 * @brief DAIF on construction
+			 */
+			hw::reg::DAIF saved;
+
+			/**
+			 * @var start
+			 * @brief Value of system counter after disabling interrupts
+			 */
+			uint64_t start;
+
+		public:
+			/**
+			 * @fn irqsave()
+			 * @brief Save DAIF and disable interrupts
+			 */
+			irqsave() : saved(), start(0) {
+				CPU::disableInterrupts();
+				if (LOCK_STATISTICS && !saved.isIrqMasked())
+					start = CPU::getSystemCounter();
+			}
+
+			/**
+			 * @fn ~irqsave()
+			 * @brief Restore saved DAIF (irqrestore)
+			 */
+			~irqsave() {
+				if (LOCK_STATISTICS && !saved.isIrqMasked())
+					lockStatistics.recordIrqOff(CPU::getSystemCounter() - start);
+				saved.restore();
+			}
+
+			irqsave(const irqsave& other) = delete;
+
+			irqsave(irqsave&& other) = delete;
+
+			irqsave& operator=(const irqsave& other) = delete;
+
+			irqsave& operator=(irqsave&& other) = delete;
+	};
+
+	/**
+	 * @class irqsave_guard
+	 * @brief Disable interrupts and hold lock for lifetime of guard
+	 */
+	template<typename Lock = spinlock>
+	class irqsave_guard {
+		private:
+			/**
+			 * @var irq
+			 * @brief Saved DAIF (constructed before and destructed after guard)
+			 */
+			irqsave irq;
+
+			/**
+			 * @var guard
+			 * @brief Held lock
+			 */
+			lock_guard<Lock> guard;
+
+		public:
+			/**
+			 * @fn irqsave_guard(Lock& lock)
+			 * @brief Disable interrupts and lock lock
+			 */
+			explicit irqsave_guard(Lock& lock) : irq(), guard(lock) {}
+
+			irqsave_guard(const irqsave_guard& other) = delete;
+
+			irqsave_guard(irqsave_guard&& other) = delete;
+
+			irqsave_guard& operator=(const irqsave_guard& other) = delete;
+
+			irqsave_guard& operator=(irqsave_guard&& other) = delete;
+	};
+
+	/**
+	 * @class softirq_disable
+	 * @brief Postpone epilogues on current CPU for lifetime of object
+	 * @details
+	 * Interrupts stay enabled and prologues are still executed. Postponed
+	 * epilogues are executed on destruction.
+	 */
+	class softirq_disable {
+		private:
+			/**
+			 * @var wasDisabled
+			 * @brief Epilogues were already postponed on construction
+			 */
+			bool wasDisabled;
+
+		public:
+			/**
+			 * @fn softirq_disable()
+			 * @brief Postpone epilogues
+			 */
+			softirq_disable() : wasDisabled(softirq.disable()) {}
+
+			/**
+			 * @fn ~softirq_disable()
+			 * @brief Execute postponed epilogues (if not nested)
+			 */
+			~softirq_disable() {
+				softirq.enable(wasDisabled);
+			}
+
+			softirq_disable(const softirq_disable& other) = delete;
+
+			softirq_disable(softirq_disable&& other) = delete;
+
+			softirq_disable& operator=(const softirq_disable& other) = delete;
+
+			softirq_disable& operator=(softirq_disable&& other) = delete;
+	};
+
+	/**
+	 * @class softirq_guard
+	 * @brief Postpone epilogues and hold lock for lifetime of guard
+	 */
+	template<typename Lock = spinlock>
+	class softirq_guard {
+		private:
+			/**
+			 * @var softirq
+			 * @brief Postponed epilogues (constructed before and destructed after guard)
+			 */
+			softirq_disable softirq;
+
+			/**
+			 * @var guard
+			 * @brief Held lock
+			 */
+			lock_guard<Lock> guard;
+
+		public:
+			/**
+			 * @fn softirq_guard(Lock& lock)
+			 * @brief Postpone epilogues and lock lock
+			 */
+			explicit softirq_guard(Lock& lock) : softirq(), guard(lock) {}
+
+			softirq_guard(const softirq_guard& other) = delete;
+
+			softirq_guard(softirq_guard&& other) = delete;
+
+			softirq_guard& operator=(const softirq_guard& other) = delete;
+
+			softirq_guard& operator=(softirq_guard&& other) = delete;
+	};
+
+} /* namespace lock */
+
+#endif /* ifndef _INC_KERNEL_LOCK_GUARD_H_ */
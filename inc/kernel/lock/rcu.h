@@ -0,0 +1,264 @@
+#ifndef _INC_KERNEL_LOCK_RCU_H_
+#define _INC_KERNEL_LOCK_RCU_H_
+
+#include <atomic.h>
+#include <cstddef.h>
+#include <cstdint.h>
+#include <kernel/cpu_local.h>
+
+/**
+ * @file kernel/lock/rcu.h
+ * @brief Read-copy-update (epoch based deferred reclamation)
+ * @details
+ * Readers access shared data between readLock() and readUnlock() without any
+ * atomic operation and must not pass a quiescent state in between. Writers
+ * publish new data with assign() (a release store), readers fetch it with
+ * dereference(). Removed data is freed with call() once every CPU passed a
+ * quiescent state (i.e. a grace period elapsed), as no reader can hold a
+ * reference to it any more.
+ *
+ * Quiescent states are context switches, each iteration of the idle loop and
+ * entries from user mode. Grace periods are numbered by a global epoch, each
+ * CPU publishes the epoch it observed during its last quiescent state. Removed
+ * data is collected in a per-CPU batch, which is handed to the next grace
+ * period and executed on the timer tick after it completed.
+ *
+ * CPUs which haven't passed their first quiescent state yet (i.e. which are
+ * still booting) are considered quiescent.
+ *
+ * Idle CPUs with a stopped tick (see NO_HZ) enter an extended quiescent state
+ * with enterIdle() and are ignored until their next quiescent state. Interrupts
+ * taken by such a CPU leave the extended quiescent state for the duration of
+ * the handler (see irqEnter() and irqExit()).
+ */
+
+namespace lock {
+
+	/**
+	 * @struct rcu_head
+	 * @brief Link of data waiting for grace period (embedded into freed object)
+	 */
+	struct rcu_head {
+		rcu_head* next;               /**< Next entry of batch */
+		void (*func)(rcu_head* head); /**< Function releasing object */
+	};
+
+	/**
+	 * @class RCU
+	 * @brief Read-copy-update
+	 */
+	class RCU {
+		private:
+			/**
+			 * @var BOOTING
+			 * @brief Observed epoch of CPUs which didn't pass a quiescent state yet
+			 */
+			static const uint64_t BOOTING = ~static_cast<uint64_t>(0);
+
+			/**
+			 * @var IDLE
+			 * @brief Observed epoch of CPUs in extended quiescent state
+			 */
+			static const uint64_t IDLE = ~static_cast<uint64_t>(0) - 1;
+
+			/**
+			 * @struct CPUState
+			 * @brief State of a single CPU (on its own cache line)
+			 */
+			struct alignas(64) CPUState {
+				lib::atomic<uint64_t> observed; /**< Epoch observed during last quiescent state */
+				size_t nesting;                 /**< Nesting of read-side critical sections */
+				rcu_head* next;                 /**< Batch waiting for next grace period */
+				rcu_head** nextTail;            /**< Last link of next batch */
+				rcu_head* wait;                 /**< Batch waiting for current grace period */
+				uint64_t waitEpoch;             /**< Grace period of wait batch */
+				size_t irqNesting;              /**< Nesting of interrupt handlers (see irqEnter()) */
+				bool idleIrq;                   /**< Outermost interrupt left extended quiescent state */
+			};
+
+			/**
+			 * @var epoch
+			 * @brief Number of last started grace period
+			 */
+			lib::atomic<uint64_t> epoch;
+
+			/**
+			 * @var states
+			 * @brief Per-CPU states
+			 */
+			cpu_local<CPUState> states;
+
+			/**
+			 * @fn uint64_t startGracePeriod()
+			 * @brief Start new grace period and return its number
+			 */
+			uint64_t startGracePeriod();
+
+			/**
+			 * @fn void publish(CPUState& state)
+			 * @brief Publish observed epoch (leaving extended quiescent state)
+			 */
+			void publish(CPUState& state);
+
+			/**
+			 * @fn bool isCompleted(uint64_t gracePeriod) const
+			 * @brief Check if all CPUs passed a quiescent state since start of grace period
+			 */
+			bool isCompleted(uint64_t gracePeriod) const;
+
+		public:
+			/**
+			 * @fn RCU()
+			 * @brief Create RCU without pending callbacks
+			 */
+			RCU();
+
+			RCU(const RCU& other) = delete;
+
+			RCU(RCU&& other) = delete;
+
+			RCU& operator=(const RCU& other) = delete;
+
+			RCU& operator=(RCU&& other) = delete;
+
+			/**
+			 * @fn int init()
+			 * @brief Drain batches on timer tick (on all CPUs)
+			 * @warning This function must be called after initializing the timer wheel
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int init();
+
+			/**
+			 * @fn void readLock()
+			 * @brief Enter read-side critical section
+			 */
+			void readLock();
+
+			/**
+			 * @fn void readUnlock()
+			 * @brief Leave read-side critical section
+			 */
+			void readUnlock();
+
+			/**
+			 * @fn void quiescentState()
+			 * @brief Report quiescent state of current CPU
+			 * @warning This function must not be called within a read-side critical section
+			 */
+			void quiescentState();
+
+			/**
+			 * @fn void enterIdle()
+			 * @brief Enter extended quiescent state (left by next quiescent state)
+			 * @warning This function must be called by the idle thread with disabled interrupts
+			 */
+			void enterIdle();
+
+			/**
+			 * @fn void irqEnter()
+			 * @brief Leave extended quiescent state (if any) for an interrupt handler
+			 * @warning Interrupts must be disabled
+			 */
+			void irqEnter();
+
+			/**
+			 * @fn void irqExit()
+			 * @brief Reenter extended quiescent state left by irqEnter()
+			 * @warning Interrupts must be disabled
+			 */
+			void irqExit();
+
+			/**
+			 * @fn bool needsTick()
+			 * @brief Check if current CPU has pending callbacks (and can't stop its tick)
+			 */
+			bool needsTick();
+
+			/**
+			 * @fn void call(rcu_head* head, void (*func)(rcu_head* head))
+			 * @brief Call func(head) after the next grace period elapsed
+			 * @details
+			 * This function may be called from any context. func is called from
+			 * the timer tick with enabled interrupts.
+			 */
+			void call(rcu_head* head, void (*func)(rcu_head* head));
+
+			/**
+			 * @fn void synchronize()
+			 * @brief Wait until a grace period elapsed
+			 * @warning This function must be called with enabled interrupts and not within a read-side critical section
+			 */
+			void synchronize();
+
+			/**
+			 * @fn int tick()
+			 * @brief Execute batch of completed grace period and hand over next batch (on current CPU)
+			 * @return
+			 *
+			 *	-  0 - Success
+			 */
+			int tick();
+
+			/**
+			 * @fn static T* dereference(T* const& pointer)
+			 * @brief Read RCU protected pointer (within read-side critical section)
+			 */
+			template<typename T>
+			static T* dereference(T* const& pointer) {
+				return __atomic_load_n(&pointer, __ATOMIC_ACQUIRE);
+			}
+
+			/**
+			 * @fn static void assign(T*& pointer, T* value)
+			 * @brief Publish value (after it was initialized completely)
+			 */
+			template<typename T>
+			static void assign(T*& pointer, T* value) {
+				__atomic_store_n(&pointer, value, __ATOMIC_RELEASE);
+			}
+	};
+
+	/**
+	 * @var rcu
+	 * @brief Global RCU
+	 */
+	extern RCU rcu;
+
+	/**
+	 * @class rcu_read_guard
+	 * @brief Read-side critical section for lifetime of guard
+	 */
+	class rcu_read_guard {
+		public:
+			/**
+			 * @fn rcu_read_guard()
+			 * @brief Enter read-side critical section
+			 */
+			rcu_read_guard() {
+				rcu.readLock();
+			}
+
+			/**
+			 * @fn ~rcu_read_guard()
+			 * @brief Leave read-side critical section
+			 */
+			~rcu_read_guard() {
+				rcu.readUnlock();
+			}
+
+			rcu_read_guard(const rcu_read_guard& other) = delete;
+
+			rcu_read_guard(rcu_read_guard&& other) = delete;
+
+			rcu_read_guard& operator=(const rcu_read_guard& other) = delete;
+
+			rcu_read_guard& operator=(rcu_read_guard&& other) = delete;
+	};
+
+} /* namespace lock */
+
+#endif /* ifndef _INC_KERNEL_LOCK_RCU_H_ */
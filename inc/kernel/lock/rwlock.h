@@ -0,0 +1,75 @@
+#ifndef _INC_KERNEL_LOCK_RWLOCK_H_
+#define _INC_KERNEL_LOCK_RWLOCK_H_
+
+#include <atomic.h>
+#include <cstdint.h>
+
+/**
+ * @file kernel/lock/rwlock.h
+ * @brief Reader/writer spinlock
+ * @details
+ * Any number of readers or a single writer may hold the lock. A waiting writer
+ * sets the writer bit first, which keeps new readers out, and then waits until
+ * all active readers left. Hence, writers are not starved by a constant
+ * stream of readers.
+ */
+
+namespace lock {
+
+	/**
+	 * @class rwlock
+	 * @brief Reader/writer spinlock
+	 */
+	class rwlock {
+		private:
+			/**
+			 * @var WRITER
+			 * @brief Writer bit of state (all other bits count the readers)
+			 */
+			static const uint32_t WRITER = static_cast<uint32_t>(1) << 31;
+
+			/**
+			 * @var state
+			 * @brief Writer bit and number of readers
+			 */
+			lib::atomic<uint32_t> state;
+
+		public:
+			/**
+			 * @fn rwlock()
+			 * @brief Construct unlocked rwlock
+			 */
+			rwlock();
+
+			rwlock(const rwlock&) = delete;
+
+			rwlock(rwlock&&) = delete;
+
+			/**
+			 * @fn void lock()
+			 * @brief Lock exclusively (as writer)
+			 */
+			void lock();
+
+			/**
+			 * @fn void unlock()
+			 * @brief Unlock exclusively held lock
+			 */
+			void unlock();
+
+			/**
+			 * @fn void lockShared()
+			 * @brief Lock shared (as reader)
+			 */
+			void lockShared();
+
+			/**
+			 * @fn void unlockShared()
+			 * @brief Unlock shared lock
+			 */
+			void unlockShared();
+	};
+
+} /* namespace lock */
+
+#endif /* ifndef _INC_KERNEL_LOCK_RWLOCK_H_ */
@@ -0,0 +1,93 @@
+#ifndef _INC_KERNEL_LOCK_SEQLOCK_H_
+#define _INC_KERNEL_LOCK_SEQLOCK_H_
+
+#include <atomic.h>
+#include <cstdint.h>
+#include <kernel/lock/spinlock.h>
+
+/**
+ * @file kernel/lock/seqlock.h
+ * @brief Sequence lock
+ * @details
+ * Writers are serialized by a spinlock and increment a sequence counter before
+ * and after modifying the protected data, so the counter is odd while a write
+ * is in progress. Readers don't write to the lock at all: They read the
+ * counter, copy the protected data and retry if the counter was odd or has
+ * changed in the meantime. Hence, readers on different CPUs don't bounce the
+ * cache line of the lock, but they must only copy the protected data (and
+ * must not follow pointers which a concurrent writer might free).
+ *
+ *	uint32_t seq;
+ *	do {
+ *		seq = lock.readBegin();
+ *		copy = data;
+ *	} while (lock.readRetry(seq));
+ *
+ * A reader interrupting a writer on the same CPU spins forever, so writers
+ * must use a guard disabling such readers (see kernel/lock/guard.h).
+ */
+
+namespace lock {
+
+	/**
+	 * @class seqlock
+	 * @brief Sequence lock
+	 */
+	class seqlock {
+		private:
+			/**
+			 * @var sequence
+			 * @brief Sequence counter (odd while a writer is active)
+			 */
+			lib::atomic<uint32_t> sequence;
+
+			/**
+			 * @var writer
+			 * @brief Lock of writers
+			 */
+			spinlock writer;
+
+		public:
+			/**
+			 * @fn seqlock()
+			 * @brief Construct unlocked seqlock
+			 */
+			seqlock();
+
+			seqlock(const seqlock&) = delete;
+
+			seqlock(seqlock&&) = delete;
+
+			/**
+			 * @fn void lock()
+			 * @brief Start writing
+			 */
+			void lock();
+
+			/**
+			 * @fn void unlock()
+			 * @brief Finish writing
+			 */
+			void unlock();
+
+			/**
+			 * @fn uint32_t readBegin() const
+			 * @brief Start reading (and wait for active writer)
+			 * @return Sequence number to pass to readRetry()
+			 */
+			uint32_t readBegin() const;
+
+			/**
+			 * @fn bool readRetry(uint32_t start) const
+			 * @brief Finish reading
+			 * @return
+			 *
+			 *	- true  - Data was modified while reading (read must be retried)
+			 *	- false - Read data is consistent
+			 */
+			bool readRetry(uint32_t start) const;
+	};
+
+} /* namespace lock */
+
+#endif /* ifndef _INC_KERNEL_LOCK_SEQLOCK_H_ */
@@ -49,6 +49,17 @@ namespace lock {
 			 */
 			cpu_local<lib::atomic_flag> used;
 
+			/**
+			 * @fn int executePending(size_t cpuID)
+			 * @brief Execute all postponed epilogues of CPU cpuID
+			 * @warning Interrupts must be disabled (and are enabled while executing an epilogue)
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int executePending(size_t cpuID);
+
 		public:
 			/**
 			 * @fn int init()
@@ -70,6 +81,33 @@ namespace lock {
 			 *	- <0 - Failure (-errno)
 			 */
 			int execute(driver::generic_driver* driver, irq::ExceptionContext* context);
+
+			/**
+			 * @fn bool disable()
+			 * @brief Postpone all epilogues on current CPU (prologues are still executed)
+			 * @return
+			 *
+			 *	- true  - Epilogues were already postponed (e.g. within an epilogue)
+			 *	- false - Otherwise
+			 */
+			bool disable();
+
+			/**
+			 * @fn void enable(bool wasDisabled)
+			 * @brief Undo disable() and execute postponed epilogues
+			 * @details
+			 * If interrupts are disabled, postponed epilogues are left to the next
+			 * softirq of the current CPU.
+			 */
+			void enable(bool wasDisabled);
+
+			/**
+			 * @fn bool isDisabled()
+			 * @brief Check if epilogues are currently postponed on current CPU
+			 * @details
+			 * This is the case while an epilogue is executed or within softirq_guard.
+			 */
+			bool isDisabled();
 	};
 
 	/**
@@ -1,11 +1,18 @@
 #ifndef _INC_KERNEL_LOCK_SPINLOCK_H_
 #define _INC_KERNEL_LOCK_SPINLOCK_H_
 
-#include <atomic.h>
+#include <cstdint.h>
 
 /**
  * @file kernel/lock/spinlock.h
  * @brief Spinlock
+ * @details
+ * The spinlock is a ticket lock: Each CPU takes the next ticket and waits
+ * until the ticket of the current owner matches, so the lock is handed over
+ * in FIFO order. Waiting CPUs only read the owner field (using a load-exclusive
+ * to arm the exclusive monitor) and sleep with WFE in between. The unlocking
+ * store to the owner field clears the monitors of all waiting CPUs, which
+ * generates the wakeup event.
  */
 
 namespace lock {
@@ -17,10 +24,10 @@ namespace lock {
 	class spinlock {
 		private:
 			/**
-			 * @var lock_flag
-			 * @brief Underlying lock flag
+			 * @var tickets
+			 * @brief Ticket of current owner (lower 16 bits) and next ticket (upper 16 bits)
 			 */
-			lib::atomic_flag lock_flag;
+			uint32_t tickets;
 
 		public:
 			/**
@@ -0,0 +1,128 @@
+#ifndef _INC_KERNEL_LOCK_STATISTICS_H_
+#define _INC_KERNEL_LOCK_STATISTICS_H_
+
+#include <cstddef.h>
+#include <cstdint.h>
+#include <kernel/cpu_local.h>
+
+/**
+ * @file kernel/lock/statistics.h
+ * @brief Hold time and IRQ-off time statistics
+ * @details
+ * If CONFIG_LOCK_STATISTICS = ENABLED is used, the lock guards (see
+ * kernel/lock/guard.h) measure how long a lock is held and how long interrupts
+ * are disabled using the system counter. For each CPU, the largest times are
+ * recorded and all sections exceeding HOLD_LIMIT_US (or IRQ_OFF_LIMIT_US) are
+ * counted.
+ * @see CONFIG_LOCK_STATISTICS
+ */
+
+namespace lock {
+
+	/**
+	 * @class LockStatistics
+	 * @brief Hold time and IRQ-off time statistics
+	 */
+	class LockStatistics {
+		public:
+			/**
+			 * @var HOLD_LIMIT_US
+			 * @brief Max. expected hold time of a lock in microseconds
+			 */
+			static const uint64_t HOLD_LIMIT_US = 50;
+
+			/**
+			 * @var IRQ_OFF_LIMIT_US
+			 * @brief Max. expected time with disabled interrupts in microseconds
+			 */
+			static const uint64_t IRQ_OFF_LIMIT_US = 100;
+
+			/**
+			 * @struct Statistics
+			 * @brief Statistics of a single CPU
+			 */
+			struct Statistics {
+				uint64_t maxHoldUS;   /**< Largest hold time of a lock in microseconds */
+				uint64_t maxIrqOffUS; /**< Largest time with disabled interrupts in microseconds */
+				size_t longHolds;     /**< Number of hold times exceeding HOLD_LIMIT_US */
+				size_t longIrqOffs;   /**< Number of IRQ-off times exceeding IRQ_OFF_LIMIT_US */
+			};
+
+		private:
+			/**
+			 * @struct Values
+			 * @brief Recorded values of a single CPU (in ticks of system counter)
+			 */
+			struct alignas(64) Values {
+				uint64_t maxHold;
+				uint64_t maxIrqOff;
+				size_t longHolds;
+				size_t longIrqOffs;
+			};
+
+			/**
+			 * @var values
+			 * @brief Recorded values per CPU
+			 */
+			cpu_local<Values> values;
+
+			/**
+			 * @var ticksPerUS
+			 * @brief Ticks of system counter per microsecond
+			 */
+			uint64_t ticksPerUS;
+
+		public:
+			/**
+			 * @fn LockStatistics()
+			 * @brief Create empty statistics
+			 */
+			LockStatistics();
+
+			LockStatistics(const LockStatistics& other) = delete;
+
+			LockStatistics(LockStatistics&& other) = delete;
+
+			LockStatistics& operator=(const LockStatistics& other) = delete;
+
+			LockStatistics& operator=(LockStatistics&& other) = delete;
+
+			/**
+			 * @fn int init()
+			 * @brief Read frequency of system counter
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int init();
+
+			/**
+			 * @fn void recordHold(uint64_t ticks)
+			 * @brief Record hold time of a lock on current CPU
+			 */
+			void recordHold(uint64_t ticks);
+
+			/**
+			 * @fn void recordIrqOff(uint64_t ticks)
+			 * @brief Record time with disabled interrupts on current CPU
+			 */
+			void recordIrqOff(uint64_t ticks);
+
+			/**
+			 * @fn Statistics get(size_t cpuID) const
+			 * @brief Get statistics of CPU cpuID
+			 * @warning cpuID must be less than MAX_NUM_CPUS
+			 */
+			Statistics get(size_t cpuID) const;
+	};
+
+	/**
+	 * @var lockStatistics
+	 * @brief Global lock statistics
+	 */
+	extern LockStatistics lockStatistics;
+
+} /* namespace lock */
+
+#endif /* ifndef _INC_KERNEL_LOCK_STATISTICS_H_ */
@@ -0,0 +1,220 @@
+#ifndef _INC_KERNEL_MM_ADDRESS_SPACE_H_
+#define _INC_KERNEL_MM_ADDRESS_SPACE_H_
+
+#include <atomic.h>
+#include <cstdint.h>
+#include <kernel/cpu_mask.h>
+#include <kernel/adt/rbtree.h>
+#include <kernel/lock/spinlock.h>
+#include <kernel/mm/slab.h>
+#include <kernel/mm/paging.h>
+
+/**
+ * @file kernel/mm/address_space.h
+ * @brief User address spaces
+ * @details
+ * Each address space owns the translation tables of its user part
+ * [Paging::USER_SPACE_START, Paging::USER_SPACE_END) and shares the (global)
+ * kernel mapping. Its non-global mappings are tagged with an ASID (see
+ * ASIDAllocator), so that switching between address spaces only needs a write
+ * of TTBR0.
+ *
+ * Memory of an address space is described by areas, which are populated on
+ * demand: The first access to a page of an area raises a translation fault,
+ * which is resolved by mapping a zeroed page frame (see PagefaultHandler).
+ * Areas below Paging::USER_SPACE_START are populated in the (shared) kernel
+ * mapping.
+ */
+
+namespace mm {
+
+	/**
+	 * @class AddressSpace
+	 * @brief User address space
+	 */
+	class AddressSpace : public SlabObject<AddressSpace> {
+		public:
+			/**
+			 * @var SLAB_NAME
+			 * @brief Name of slab cache of address spaces
+			 */
+			static constexpr const char* SLAB_NAME = "mm::AddressSpace";
+
+			/**
+			 * @enum Access
+			 * @brief Type of access causing a fault
+			 */
+			enum class Access {
+				READ,    /**< Read access */
+				WRITE,   /**< Write access */
+				EXECUTE, /**< Instruction fetch */
+			};
+
+			/**
+			 * @struct Area
+			 * @brief Demand-paged memory area [start, end)
+			 */
+			struct Area {
+				uintptr_t start;             /**< Start of area (page-aligned) */
+				uintptr_t end;               /**< End of area (page-aligned) */
+				Paging::priv_lvl_t priv;     /**< Privileged level of mappings */
+				Paging::prot_t prot;         /**< Protection of mappings */
+
+				bool operator<(const Area& other) const {
+					return start < other.start;
+				}
+
+				bool operator==(const Area& other) const {
+					return start == other.start;
+				}
+			};
+
+			/**
+			 * @typedef AreaTree
+			 * @brief Areas sorted by start address
+			 */
+			using AreaTree = RBTree<Area>;
+
+		private:
+			/**
+			 * @var tables
+			 * @brief Translation tables (level 0)
+			 */
+			void* tables;
+
+			/**
+			 * @var context
+			 * @brief Context ID (generation and ASID) used by ASIDAllocator
+			 */
+			lib::atomic<uint64_t> context;
+
+			/**
+			 * @var cpus
+			 * @brief CPUs which activated the address space (and may still cache translations tagged with its ASID)
+			 */
+			cpu_mask cpus;
+
+			/**
+			 * @var areas
+			 * @brief Areas of address space
+			 */
+			AreaTree areas;
+
+			/**
+			 * @var lock
+			 * @brief Lock of areas
+			 */
+			lock::spinlock lock;
+
+			/**
+			 * @fn void* getTablesFor(uintptr_t vaddr) const
+			 * @brief Get translation tables responsible for vaddr (own or shared kernel mapping)
+			 */
+			void* getTablesFor(uintptr_t vaddr) const;
+
+			/**
+			 * @fn int populate(uintptr_t vaddr, Access access, bool user)
+			 * @brief Map zeroed page frame at (page-aligned) vaddr without locking
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int populate(uintptr_t vaddr, Access access, bool user);
+
+			/**
+			 * @fn void releaseArea(const Area& area)
+			 * @brief Unmap and free all populated pages of area
+			 */
+			void releaseArea(const Area& area);
+
+		public:
+			/**
+			 * @fn AddressSpace()
+			 * @brief Create empty (uninitialized) address space
+			 */
+			AddressSpace();
+
+			AddressSpace(const AddressSpace& other) = delete;
+
+			AddressSpace(AddressSpace&& other) = delete;
+
+			AddressSpace& operator=(const AddressSpace& other) = delete;
+
+			AddressSpace& operator=(AddressSpace&& other) = delete;
+
+			/**
+			 * @fn ~AddressSpace()
+			 * @brief Release ASID and translation tables
+			 * @warning The address space must not be active on any CPU
+			 */
+			~AddressSpace();
+
+			/**
+			 * @fn int init()
+			 * @brief Allocate translation tables
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int init();
+
+			/**
+			 * @fn void* getTables() const
+			 * @brief Get translation tables (e.g. to create mappings with Paging)
+			 */
+			void* getTables() const;
+
+			/**
+			 * @fn int addArea(void* start, size_t size, Paging::priv_lvl_t priv, Paging::prot_t prot)
+			 * @brief Add demand-paged area [start, start + size) without populating it
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int addArea(void* start, size_t size, Paging::priv_lvl_t priv, Paging::prot_t prot);
+
+			/**
+			 * @fn int removeArea(void* start)
+			 * @brief Remove area starting at start and free its populated pages
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int removeArea(void* start);
+
+			/**
+			 * @fn int handleFault(void* vaddr, Access access, bool user)
+			 * @brief Populate page containing vaddr with zeroed page frame
+			 * @return
+			 *
+			 *	-  0 - Success (access can be retried)
+			 *	- <0 - Failure (-errno), e.g. vaddr is not part of an area or access is not permitted
+			 */
+			int handleFault(void* vaddr, Access access, bool user);
+
+			/**
+			 * @fn void activate()
+			 * @brief Load address space on current CPU
+			 */
+			void activate();
+
+			/**
+			 * @fn static void activateKernel()
+			 * @brief Load kernel mapping (without any user address space) on current CPU
+			 */
+			static void activateKernel();
+
+			/**
+			 * @fn static AddressSpace* getActive()
+			 * @brief Get address space active on current CPU (or nullptr for kernel mapping only)
+			 */
+			static AddressSpace* getActive();
+	};
+
+} /* namespace mm */
+
+#endif /* ifndef _INC_KERNEL_MM_ADDRESS_SPACE_H_ */
@@ -0,0 +1,200 @@
+#ifndef _INC_KERNEL_MM_ASID_ALLOCATOR_H_
+#define _INC_KERNEL_MM_ASID_ALLOCATOR_H_
+
+#include <atomic.h>
+#include <cstddef.h>
+#include <cstdint.h>
+#include <kernel/cpu_local.h>
+#include <kernel/lock/spinlock.h>
+
+/**
+ * @file kernel/mm/asid_allocator.h
+ * @brief Allocate address space identifiers (ASIDs)
+ * @details
+ * Each user address space is tagged with an ASID, so that switching between
+ * address spaces only requires a write of TTBR0 instead of a TLB flush. An
+ * ASID is combined with a generation into a context ID. If all ASIDs of the
+ * current generation are used, a new generation is started (rollover): All
+ * ASIDs are released except the ones currently active on a CPU, and every CPU
+ * flushes its local TLB before activating its next address space.
+ * ASID 0 is reserved for the kernel mapping.
+ */
+
+namespace mm {
+
+	/**
+	 * @class ASIDAllocator
+	 * @brief Rollover-generation ASID allocator
+	 */
+	class ASIDAllocator {
+		public:
+			/**
+			 * @var MAX_ASIDS
+			 * @brief Max. number of ASIDs (16 bit)
+			 */
+			static const size_t MAX_ASIDS = 1 << 16;
+
+		private:
+			/**
+			 * @var bits
+			 * @brief Number of used ASID bits (8 or 16)
+			 */
+			size_t bits;
+
+			/**
+			 * @var generation
+			 * @brief Current generation (in bits above the ASID)
+			 */
+			lib::atomic<uint64_t> generation;
+
+			/**
+			 * @var used
+			 * @brief Bitmap of ASIDs used in current generation
+			 */
+			uint64_t used[MAX_ASIDS / 64];
+
+			/**
+			 * @var next
+			 * @brief Start of search for next free ASID
+			 */
+			size_t next;
+
+			/**
+			 * @var rollovers
+			 * @brief Number of started generations
+			 */
+			size_t rollovers;
+
+			/**
+			 * @var active
+			 * @brief Context ID currently active per CPU (0 during rollover)
+			 */
+			cpu_local<lib::atomic<uint64_t>> active;
+
+			/**
+			 * @var reserved
+			 * @brief Context ID which was active on CPU during last rollover
+			 */
+			cpu_local<uint64_t> reserved;
+
+			/**
+			 * @var flushPending
+			 * @brief CPU must flush its TLB before activating next address space
+			 */
+			cpu_local<bool> flushPending;
+
+			/**
+			 * @var lock
+			 * @brief Synchronization lock
+			 */
+			lock::spinlock lock;
+
+			/**
+			 * @fn size_t getASID(uint64_t context) const
+			 * @brief Get ASID of context ID
+			 */
+			size_t getASID(uint64_t context) const;
+
+			/**
+			 * @fn bool isCurrent(uint64_t context) const
+			 * @brief Check if context ID is part of current generation
+			 */
+			bool isCurrent(uint64_t context) const;
+
+			/**
+			 * @fn void setUsed(size_t asid)
+			 * @brief Mark ASID as used in current generation
+			 */
+			void setUsed(size_t asid);
+
+			/**
+			 * @fn bool isUsed(size_t asid) const
+			 * @brief Check if ASID is used in current generation
+			 */
+			bool isUsed(size_t asid) const;
+
+			/**
+			 * @fn size_t findFree(size_t start) const
+			 * @brief Find first free ASID starting at start (or 0 if there is none)
+			 */
+			size_t findFree(size_t start) const;
+
+			/**
+			 * @fn void rollover()
+			 * @brief Start new generation (without locking)
+			 */
+			void rollover();
+
+			/**
+			 * @fn bool updateReserved(uint64_t context, uint64_t newContext)
+			 * @brief Replace context ID reserved during last rollover by newContext
+			 * @return
+			 *
+			 *	- true  - context was reserved by at least one CPU
+			 *	- false - otherwise
+			 */
+			bool updateReserved(uint64_t context, uint64_t newContext);
+
+			/**
+			 * @fn uint64_t newContext(uint64_t context)
+			 * @brief Get context ID of current generation (keeping the ASID if possible) without locking
+			 */
+			uint64_t newContext(uint64_t context);
+
+		public:
+			/**
+			 * @fn ASIDAllocator()
+			 * @brief Create allocator
+			 */
+			ASIDAllocator();
+
+			ASIDAllocator(const ASIDAllocator& other) = delete;
+
+			ASIDAllocator(ASIDAllocator&& other) = delete;
+
+			ASIDAllocator& operator=(const ASIDAllocator& other) = delete;
+
+			ASIDAllocator& operator=(ASIDAllocator&& other) = delete;
+
+			/**
+			 * @fn int init(size_t bits)
+			 * @brief Initialize allocator for 8 or 16 bit ASIDs
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int init(size_t bits);
+
+			/**
+			 * @fn void activate(void* tables, lib::atomic<uint64_t>& context)
+			 * @brief Load translation tables with ASID of context ID on current CPU
+			 * @details
+			 * If the context ID belongs to an older generation, it is replaced by
+			 * a context ID of the current generation. The fast path (context ID
+			 * of current generation) doesn't take the lock.
+			 * @warning Interrupts must be disabled
+			 */
+			void activate(void* tables, lib::atomic<uint64_t>& context);
+
+			/**
+			 * @fn void release(lib::atomic<uint64_t>& context)
+			 * @brief Invalidate all TLB entries tagged with the ASID of context ID
+			 * @details
+			 * The ASID itself is only reused after the next rollover.
+			 * @warning The address space must not be active on any CPU
+			 */
+			void release(lib::atomic<uint64_t>& context);
+
+			/**
+			 * @fn size_t getRollovers() const
+			 * @brief Get number of rollovers
+			 */
+			size_t getRollovers() const;
+	};
+
+	extern ASIDAllocator asidAlloc;
+
+} /* namespace mm */
+
+#endif /* ifndef _INC_KERNEL_MM_ASID_ALLOCATOR_H_ */
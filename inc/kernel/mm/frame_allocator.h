@@ -1,13 +1,24 @@
 #ifndef _INC_KERNEL_MM_FRAME_ALLOCATOR_H_
 #define _INC_KERNEL_MM_FRAME_ALLOCATOR_H_
 
+#include <utility.h>
 #include <cstddef.h>
+#include <cstdint.h>
 #include <climits.h>
+#include <kernel/cpu_local.h>
 #include <kernel/lock/spinlock.h>
+#include <kernel/device_tree/parser.h>
 
 /**
  * @file kernel/mm/frame_allocator.h
  * @brief Allocate page frames
+ * @details
+ * The frame allocator manages all physical memory described by the memory
+ * nodes of the device tree. The memory reservation block of the device tree,
+ * the kernel image (including the symbol map), the device tree blob itself
+ * and all device ranges are excluded. Free memory is organized as binary
+ * buddy system, where each block of 2^order page frames is part of the free
+ * list of its order.
  */
 
 namespace mm {
@@ -17,33 +28,133 @@ namespace mm {
 	 * @brief Frame Allocator
 	 */
 	class FrameAllocator {
+		public:
+			/**
+			 * @var NUM_ORDERS
+			 * @brief Number of supported orders (block of 2^order page frames)
+			 */
+			static const size_t NUM_ORDERS = 11;
+
+			/**
+			 * @var MAGAZINE_SIZE
+			 * @brief Max. number of page frames cached per CPU
+			 */
+			static const size_t MAGAZINE_SIZE = 32;
+
+			/**
+			 * @var MAGAZINE_BATCH
+			 * @brief Number of page frames moved between magazine and buddy system at once
+			 */
+			static const size_t MAGAZINE_BATCH = MAGAZINE_SIZE / 2;
+
+			/**
+			 * @struct Statistics
+			 * @brief Usage statistics of a per-CPU magazine
+			 */
+			struct Statistics {
+				size_t allocs;    /**< Number of alloc() calls */
+				size_t allocHits; /**< Number of alloc() calls served from magazine */
+				size_t frees;     /**< Number of free() calls */
+				size_t freeHits;  /**< Number of free() calls served by magazine */
+				size_t refills;   /**< Number of batched refills from buddy system */
+				size_t drains;    /**< Number of batched drains to buddy system */
+			};
+
+			/**
+			 * @typedef iterator
+			 * @brief Iterator for managed memory ranges
+			 */
+			using iterator = const lib::pair<void*, size_t>*;
+
 		private:
 			/**
-			 * @var NUM_FRAMES
-			 * @brief Number of pages within allocator
+			 * @var MAX_RANGES
+			 * @brief Max. number of managed memory ranges (including frame descriptors, init() fails beyond)
 			 */
-			static const size_t NUM_FRAMES = 4096;
+			static const size_t MAX_RANGES = 16;
 
 			/**
-			 * @var SIZE
-			 * @brief Size of allocator in bytes
+			 * @var MAX_RESERVED
+			 * @brief Max. number of reserved memory ranges (after merging adjacent ones, init() fails beyond)
 			 */
-			static const size_t SIZE = NUM_FRAMES * PAGESIZE;
-			char frames[SIZE] __attribute__((aligned(PAGESIZE)));
+			static const size_t MAX_RESERVED = 16;
+
+			/**
+			 * @typedef frame_state_t
+			 * @brief State of a page frame
+			 */
+			typedef enum : uint8_t {
+				FRAME_RESERVED = 0, /**< Frame is not managed (or not head of a block) */
+				FRAME_FREE     = 1, /**< Frame is head of a free block */
+				FRAME_USED     = 2, /**< Frame is head of an allocated block */
+			} frame_state_t;
+
+			/**
+			 * @struct Frame
+			 * @brief Descriptor of a page frame
+			 */
+			struct Frame {
+				uint8_t order;       /**< Order of block (only valid for head of block) */
+				frame_state_t state; /**< State of frame */
+				uint16_t count;      /**< Usage counter of allocated frame (e.g. live entries of translation table) */
+			};
 
 			/**
 			 * @struct FrameLink
-			 * @brief Link between available page frames
+			 * @brief Link between free blocks of the same order (stored within free block)
 			 */
 			struct FrameLink {
 				FrameLink* next;
+				FrameLink* prev;
 			};
 
 			/**
-			 * @var head
-			 * @brief Pointer to top of stack
+			 * @var base
+			 * @brief Physical address of first described page frame
+			 */
+			uintptr_t base;
+
+			/**
+			 * @var numFrames
+			 * @brief Number of described page frames
+			 */
+			size_t numFrames;
+
+			/**
+			 * @var frames
+			 * @brief Array of frame descriptors (placed in managed memory)
+			 */
+			Frame* frames;
+
+			/**
+			 * @var freeLists
+			 * @brief Free lists per order
 			 */
-			FrameLink* head = nullptr;
+			FrameLink* freeLists[NUM_ORDERS];
+
+			/**
+			 * @var freeMask
+			 * @brief Bitmask of non-empty free lists
+			 */
+			size_t freeMask;
+
+			/**
+			 * @var freeFrames
+			 * @brief Number of free page frames
+			 */
+			size_t freeFrames;
+
+			/**
+			 * @var ranges
+			 * @brief Managed memory ranges
+			 */
+			lib::pair<void*, size_t> ranges[MAX_RANGES];
+
+			/**
+			 * @var numRanges
+			 * @brief Number of managed memory ranges
+			 */
+			size_t numRanges;
 
 			/**
 			 * @var lock
@@ -51,6 +162,90 @@ namespace mm {
 			 */
 			lock::spinlock lock;
 
+			/**
+			 * @struct Magazine
+			 * @brief Per-CPU cache of page frames
+			 */
+			struct alignas(64) Magazine {
+				void* frames[MAGAZINE_SIZE]; /**< Cached page frames */
+				size_t count;                /**< Number of cached page frames */
+				Statistics stats;            /**< Usage statistics */
+			};
+
+			/**
+			 * @var magazines
+			 * @brief Per-CPU magazines
+			 */
+			cpu_local<Magazine> magazines;
+
+			/**
+			 * @fn size_t toIndex(const void* addr) const
+			 * @brief Get index of frame descriptor for page frame at addr
+			 */
+			size_t toIndex(const void* addr) const;
+
+			/**
+			 * @fn void* toAddress(size_t idx) const
+			 * @brief Get address of page frame described by frames[idx]
+			 */
+			void* toAddress(size_t idx) const;
+
+			/**
+			 * @fn void pushFree(size_t idx, size_t order)
+			 * @brief Insert free block into free list of order
+			 */
+			void pushFree(size_t idx, size_t order);
+
+			/**
+			 * @fn void removeFree(size_t idx, size_t order)
+			 * @brief Remove free block from free list of order
+			 */
+			void removeFree(size_t idx, size_t order);
+
+			/**
+			 * @fn void* allocBlock(size_t order)
+			 * @brief Allocate block of 2^order page frames without locking
+			 * @return
+			 *
+			 *	- Pointer to pages - Success
+			 *	- nullptr          - Failure
+			 */
+			void* allocBlock(size_t order);
+
+			/**
+			 * @fn int freeBlock(void* addr)
+			 * @brief Free allocated block starting at addr and merge with its buddies without locking
+			 * @return
+			 *
+			 *	- 0  - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int freeBlock(void* addr);
+
+			/**
+			 * @fn void addRange(uintptr_t start, uintptr_t end)
+			 * @brief Add free (page-aligned) memory range [start, end) to buddy system
+			 */
+			void addRange(uintptr_t start, uintptr_t end);
+
+			/**
+			 * @fn bool isFrame(void* page) const
+			 * @brief Check if page is an allocated single page frame
+			 */
+			bool isFrame(void* page) const;
+
+			/**
+			 * @fn void refill(Magazine& magazine)
+			 * @brief Move up to MAGAZINE_BATCH frames from buddy system into magazine
+			 */
+			void refill(Magazine& magazine);
+
+			/**
+			 * @fn void drain(Magazine& magazine)
+			 * @brief Move MAGAZINE_BATCH frames from magazine back into buddy system
+			 */
+			void drain(Magazine& magazine);
+
 		public:
 			/**
 			 * @fn FrameAllocator
@@ -67,10 +262,15 @@ namespace mm {
 			FrameAllocator& operator=(FrameAllocator&& other) = delete;
 
 			/**
-			 * @fn void init()
-			 * @brief Initialize allocator
+			 * @fn int init(const DeviceTree::Parser& dtp)
+			 * @brief Initialize allocator with all available memory of the device tree
+			 * @warning This function must be called before enabling the MMU
+			 * @return
+			 *
+			 *	- 0  - Success
+			 *	- <0 - Failure (-errno)
 			 */
-			void init();
+			int init(const DeviceTree::Parser& dtp);
 
 			/**
 			 * @fn void* earlyAlloc()
@@ -97,6 +297,9 @@ namespace mm {
 			/**
 			 * @fn void* alloc()
 			 * @brief Allocate page frame
+			 * @details
+			 * Page frames are taken from the magazine of the current CPU, which
+			 * is refilled in batches from the buddy system if empty.
 			 * @return
 			 *
 			 *	- Pointer to pages - Success
@@ -107,6 +310,9 @@ namespace mm {
 			/**
 			 * @fn int free(void *page)
 			 * @brief Free page frame
+			 * @details
+			 * Page frames are put into the magazine of the current CPU, which
+			 * is drained in batches to the buddy system if full.
 			 * @return
 			 *
 			 *	- 0  - Success
@@ -114,6 +320,76 @@ namespace mm {
 			 */
 			int free(void *page);
 
+			/**
+			 * @fn void* allocPages(size_t order)
+			 * @brief Allocate 2^order physically contiguous page frames
+			 * @details
+			 * The returned block is aligned to its size. Its order is kept in
+			 * the frame descriptor, therefore no header is placed in the block.
+			 * @return
+			 *
+			 *	- Pointer to pages - Success
+			 *	- nullptr          - Failure
+			 */
+			void* allocPages(size_t order);
+
+			/**
+			 * @fn int freePages(void* pages)
+			 * @brief Free block allocated by allocPages and merge it with its free buddies
+			 * @return
+			 *
+			 *	- 0  - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int freePages(void* pages);
+
+			/**
+			 * @fn static size_t sizeToOrder(size_t size)
+			 * @brief Get smallest order whose block covers at least size bytes
+			 */
+			static size_t sizeToOrder(size_t size);
+
+			/**
+			 * @fn Statistics getStatistics(size_t cpuID) const
+			 * @brief Get usage statistics of magazine of CPU cpuID
+			 * @warning cpuID must be less than MAX_NUM_CPUS
+			 */
+			Statistics getStatistics(size_t cpuID) const;
+
+			/**
+			 * @fn size_t getUseCount(const void* page) const
+			 * @brief Get usage counter of allocated page frame
+			 * @details
+			 * The counter is kept in the frame descriptor, reset on allocation and
+			 * free, and can be used by the owner of the frame (e.g. to count live
+			 * entries of a translation table).
+			 */
+			size_t getUseCount(const void* page) const;
+
+			/**
+			 * @fn void setUseCount(const void* page, size_t count)
+			 * @brief Set usage counter of allocated page frame
+			 * @warning count must be less than 65536
+			 */
+			void setUseCount(const void* page, size_t count);
+
+			/**
+			 * @fn size_t getFreeFrames() const
+			 * @brief Get number of free page frames (excluding magazines)
+			 */
+			size_t getFreeFrames() const;
+
+			/**
+			 * @fn iterator begin() const
+			 * @brief Iterator for managed memory ranges
+			 */
+			iterator begin() const;
+
+			/**
+			 * @fn iterator end() const
+			 * @brief Iterator for managed memory ranges
+			 */
+			iterator end() const;
 	};
 
 	extern FrameAllocator frameAlloc;
@@ -6,6 +6,8 @@
 #include <cerrno.h>
 #include <climits.h>
 #include <cstdint.h>
+#include <kernel/config.h>
+#include <kernel/cpu_mask.h>
 #include <kernel/lock/spinlock.h>
 
 /**
@@ -43,16 +45,64 @@ namespace mm {
 			 * @brief Memory attribute
 			 */
 			typedef enum {
-				NORMAL_ATTR    = (1 << 0), /**< Normal Memory */
-				DEVICE_ATTR    = (1 << 1), /**< Device Memory */
+				DEVICE_ATTR        = 0, /**< Device Memory (MAIR entry 0) */
+				NORMAL_ATTR        = 1, /**< Normal Memory, non-cacheable (MAIR entry 1) */
+				NORMAL_CACHED_ATTR = 2, /**< Normal Memory, write-back cacheable (MAIR entry 2) */
 			} mem_attr_t;
 
+			/**
+			 * @var DEFAULT_ATTR
+			 * @brief Memory attribute of kernel and app memory (see CONFIG_MEMORY)
+			 */
+			static const mem_attr_t DEFAULT_ATTR = CACHED_MEMORY ? NORMAL_CACHED_ATTR : NORMAL_ATTR;
+
+			/**
+			 * @var NUM_TABLES
+			 * @brief Number of Translation Tables
+			 */
+			const static size_t NUM_TABLES = 4;
+
+			/**
+			 * @var TLBI_THRESHOLD
+			 * @brief Max. number of pages invalidated one by one (instead of whole TLB) by range operations
+			 */
+			const static size_t TLBI_THRESHOLD = 64;
+
+			/**
+			 * @var USER_SPACE_START
+			 * @brief Start of user address spaces
+			 * @details
+			 * The kernel mapping covers [0, USER_SPACE_START), which is described
+			 * by the first entry of the translation table of level 0. This entry
+			 * (and therefore all its global mappings) is shared by all user
+			 * address spaces.
+			 */
+			const static uintptr_t USER_SPACE_START = static_cast<uintptr_t>(1) << 39;
+
+			/**
+			 * @var USER_SPACE_END
+			 * @brief End of user address spaces
+			 */
+			const static uintptr_t USER_SPACE_END = static_cast<uintptr_t>(1) << 48;
+
 		private:
+			/**
+			 * @var kernelTables
+			 * @brief Translation Tables of kernel mapping
+			 */
+			static void* kernelTables;
+
 			/**
 			 * @var tables
-			 * @brief (Global) Translation Tables
+			 * @brief Translation Tables used by this object
 			 */
-			static void* tables;
+			void* tables;
+
+			/**
+			 * @var cpus
+			 * @brief CPUs which may cache translations of tables (or nullptr for all CPUs)
+			 */
+			const cpu_mask* cpus;
 
 			/**
 			 * @var lock
@@ -61,40 +111,113 @@ namespace mm {
 			static lock::spinlock lock;
 
 			/**
-			 * @fn static size_t getOffset(void* addr)
-			 * @brief Get offset in translation table for for given level
-			 * @tparam level Target Translation Table Level (0-3)
+			 * @fn static size_t getOffset(void* addr, size_t level)
+			 * @brief Get offset in translation table for given level (0-3)
 			 */
-			template<size_t level>
-			static size_t getOffset(void* addr);
+			static size_t getOffset(void* addr, size_t level);
 
 			/**
-			 * @fn static void getOffsets(void* addr, size_t offsets[4])
-			 * @brief Save all offsets in target array
+			 * @fn static size_t getLevelSize(size_t level)
+			 * @brief Get size of memory described by a single entry of given level (0-3)
 			 */
-			static void getOffsets(void* addr, size_t offsets[4]);
+			static size_t getLevelSize(size_t level);
 
 			/**
-			 * @fn int genTTs(void* vaddr)
-			 * @brief Generate Translation Table Level 1, 2, 3 if necessary and initialize with default values
-			 * @tparm earlyBoot Use TTAllocator::earlyAlloc instead of TTAllocator::alloc
+			 * @fn static int setProtection(TranslationTable& tt, size_t entry, priv_lvl_t priv, prot_t prot, mem_attr_t attr)
+			 * @brief Set access control, execute-never bits and memory attribute of entry
 			 * @return
 			 *
 			 *	-  0 - Success
-			 *	- <0 - Failure
+			 *	- <0 - Failure (-errno)
+			 */
+			static int setProtection(TranslationTable& tt, size_t entry, priv_lvl_t priv, prot_t prot, mem_attr_t attr);
+
+			/**
+			 * @fn static void* allocTT()
+			 * @brief Allocate translation table initialized with default values
+			 * @tparm earlyBoot Use TTAllocator::earlyAlloc instead of TTAllocator::alloc
+			 * @return
+			 *
+			 *	- Pointer to table - Success
+			 *	- nullptr          - Failure
 			 */
 			template<bool earlyBoot = false>
-			int genTTs(void* vaddr);
+			static void* allocTT();
+
+			/**
+			 * @fn static bool isEmpty(const TranslationTable& tt)
+			 * @brief Check if translation table has no present entry
+			 * @details
+			 * The number of present entries is kept as usage counter of the
+			 * page frame of the table (see FrameAllocator::getUseCount).
+			 */
+			static bool isEmpty(const TranslationTable& tt);
 
 			/**
-			 * @fn int getTTs(void *vaddr, TranslationTable tt[4]) const
-			 * @brief Lookup Translation Tables for given virtual address
+			 * @fn static void setPresent(TranslationTable& tt, size_t entry, bool present)
+			 * @brief Set present bit of entry and update number of present entries of tt
+			 */
+			static void setPresent(TranslationTable& tt, size_t entry, bool present);
+
+			/**
+			 * @fn static int splitBlock(TranslationTable& tt, size_t entry, size_t level, void* vaddr)
+			 * @brief Replace block descriptor (of level 1 or 2) containing vaddr by translation table with same mapping
+			 * @details
+			 * Break-before-make leaves the whole block unmapped on all CPUs while the
+			 * entry is invalid. Hence blocks of the kernel mapping (global entries) are
+			 * only split during early boot (only the boot CPU runs), later splits of
+			 * kernel blocks fail with -EBUSY. User blocks might be split at any time.
+			 * @tparm earlyBoot Use TTAllocator::earlyAlloc instead of TTAllocator::alloc
 			 * @return
 			 *
 			 *	-  0 - Success
-			 *	- <0 - Error (-errno)
+			 *	- <0 - Failure (-errno)
+			 */
+			template<bool earlyBoot = false>
+			static int splitBlock(TranslationTable& tt, size_t entry, size_t level, void* vaddr);
+
+			/**
+			 * @class Cursor
+			 * @brief Cached walk through the translation tables
+			 * @details
+			 * A cursor remembers the translation tables of its last walk. Subsequent
+			 * walks only descend from the deepest table, which also describes the
+			 * new address, instead of starting at the root again.
 			 */
-			int getTTs(void *vaddr, TranslationTable tt[4]) const;
+			class Cursor {
+				private:
+					TranslationTable tts[NUM_TABLES]; /**< Translation tables of last walk */
+					uintptr_t bases[NUM_TABLES];      /**< Virtual base address described by tts */
+					size_t depth;                     /**< Number of valid translation tables */
+
+				public:
+					/**
+					 * @fn Cursor(void* root)
+					 * @brief Create cursor for translation tables starting at root
+					 */
+					explicit Cursor(void* root);
+
+					/**
+					 * @fn int walk(void* vaddr, bool create)
+					 * @brief Walk down to translation table of last level describing vaddr
+					 * @details
+					 * Blocks on the way are split on demand. Missing translation tables
+					 * are generated if create is set.
+					 * @tparm earlyBoot Use TTAllocator::earlyAlloc instead of TTAllocator::alloc
+					 * @return
+					 *
+					 *	-  0 - Success
+					 *	- <0 - Failure (-errno)
+					 */
+					template<bool earlyBoot = false>
+					int walk(void* vaddr, bool create);
+
+					/**
+					 * @fn TranslationTable& getTable(size_t level)
+					 * @brief Get translation table of given level (0-3) of last walk
+					 */
+					TranslationTable& getTable(size_t level);
+			};
 
 			/**
 			 * @fn int internalProtect(void *vaddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr)
@@ -122,19 +245,89 @@ namespace mm {
 			template<bool earlyBoot = false>
 			int internalMap(void* vaddr, void* paddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr);
 
-		public:
 			/**
-			 * @var NUM_TABLES
-			 * @brief Number of Translation Tables
+			 * @fn int mapLevel(TranslationTable tt, size_t level, uintptr_t vaddr, uintptr_t end, uintptr_t paddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr)
+			 * @brief Map [vaddr, end) within translation table tt of given level (and all levels below)
+			 * @details
+			 * Level 1 (1 GiB) and level 2 (2 MiB) blocks are used whenever
+			 * alignment and size of the remaining range allow it and no
+			 * translation table of the next level exists.
+			 * @tparm earlyBoot Use TTAllocator::earlyAlloc instead of TTAllocator::alloc
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
 			 */
-			const static size_t NUM_TABLES = 4;
+			template<bool earlyBoot = false>
+			int mapLevel(TranslationTable tt, size_t level, uintptr_t vaddr, uintptr_t end, uintptr_t paddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr);
+
+			/**
+			 * @fn int unmapLevel(TranslationTable tt, size_t level, uintptr_t vaddr, uintptr_t end)
+			 * @brief Unmap [vaddr, end) within translation table tt of given level and release empty tables below
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int unmapLevel(TranslationTable tt, size_t level, uintptr_t vaddr, uintptr_t end);
 
+			/**
+			 * @fn int protectLevel(TranslationTable tt, size_t level, uintptr_t vaddr, uintptr_t end, priv_lvl_t priv, prot_t prot, mem_attr_t attr)
+			 * @brief Update protection of [vaddr, end) within translation table tt of given level
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int protectLevel(TranslationTable tt, size_t level, uintptr_t vaddr, uintptr_t end, priv_lvl_t priv, prot_t prot, mem_attr_t attr);
+
+			/**
+			 * @fn bool isValidRange(void* vaddr, size_t size) const
+			 * @brief Check if range is non-empty, page-aligned, doesn't overflow and is part of the address space
+			 */
+			bool isValidRange(void* vaddr, size_t size) const;
+
+			/**
+			 * @fn bool isInAddressSpace(uintptr_t start, uintptr_t end) const
+			 * @brief Check if [start, end) is part of kernel mapping (or user address space)
+			 */
+			bool isInAddressSpace(uintptr_t start, uintptr_t end) const;
+
+			/**
+			 * @fn void invalidateRange(void* vaddr, size_t size) const
+			 * @brief Invalidate TLB entries of range on all CPUs of cpus (or whole TLB if range exceeds TLBI_THRESHOLD pages)
+			 * @see TLBShootdown
+			 */
+			void invalidateRange(void* vaddr, size_t size) const;
+
+			/**
+			 * @fn int earlyMapSegment(void* start, size_t size, priv_lvl_t priv, prot_t prot)
+			 * @brief Create identity mapping (in early initialization code) for all pages of segment
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int earlyMapSegment(void* start, size_t size, priv_lvl_t priv, prot_t prot);
+
+		public:
 			/**
 			 * @fn Paging()
-			 * @brief Constructor Paging from current TTBR0
+			 * @brief Construct Paging for kernel mapping
 			 */
 			Paging();
 
+			/**
+			 * @fn Paging(void* tables, const cpu_mask* cpus = nullptr)
+			 * @brief Construct Paging for user address space with translation tables
+			 * @details
+			 * Only [USER_SPACE_START, USER_SPACE_END) can be modified and all
+			 * created mappings are non-global (i.e. tagged with the ASID of the
+			 * address space). Stale TLB entries are only invalidated on cpus (or
+			 * on all CPUs if cpus is nullptr).
+			 */
+			explicit Paging(void* tables, const cpu_mask* cpus = nullptr);
+
 			Paging(const Paging& other) = delete;
 
 			Paging(Paging&& other) = delete;
@@ -147,16 +340,39 @@ namespace mm {
 			 * @fn static int createEarlyKernelMapping()
 			 * @brief Create and load initial mapping
 			 * @details
-			 * Create mapping for text, data, rodata, bss (of kernel and app) and symbol map
+			 * Create mapping for text, data, rodata, bss (of kernel), text, data, rodata
+			 * (of app), symbol map and all memory managed by the frame allocator. The bss
+			 * of the app is populated on demand (see AddressSpace).
 			 */
 			static int createEarlyKernelMapping();
 
 			/**
 			 * @fn static int loadKernelMapping()
-			 * @brief Load kernel mapping
+			 * @brief Load kernel mapping (with reserved ASID 0)
 			 */
 			static int loadKernelMapping();
 
+			/**
+			 * @fn static void* createUserTables()
+			 * @brief Create translation tables for new user address space sharing the kernel mapping
+			 * @return
+			 *
+			 *	- Pointer to table - Success
+			 *	- nullptr          - Failure
+			 */
+			static void* createUserTables();
+
+			/**
+			 * @fn static int destroyUserTables(void* tables)
+			 * @brief Release all translation tables of user address space (but not the mapped page frames)
+			 * @warning The address space must not be active on any CPU
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			static int destroyUserTables(void* tables);
+
 			/**
 			 * @fn int earlyMap(void* vaddr, void* paddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr)
 			 * @brief Create mapping (in early initialization code)
@@ -172,6 +388,25 @@ namespace mm {
 			 */
 			int earlyMap(void* vaddr, void* paddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr);
 
+			/**
+			 * @fn int earlyMapRange(void* vaddr, void* paddr, size_t size, priv_lvl_t priv, prot_t prot, mem_attr_t attr)
+			 * @brief Create mapping for range (in early initialization code)
+			 * @details
+			 * Level 1 (1 GiB) and level 2 (2 MiB) blocks are used whenever
+			 * alignment and size of the remaining range allow it.
+			 * @param vaddr Desired (page-aligned) virtual address
+			 * @param paddr Desired (page-aligned) physical adress
+			 * @param size Size of range (multiple of PAGESIZE)
+			 * @param priv Privileged Level
+			 * @param prot Protection
+			 * @param attr Memory Attribute
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int earlyMapRange(void* vaddr, void* paddr, size_t size, priv_lvl_t priv, prot_t prot, mem_attr_t attr);
+
 			/**
 			 * @fn int map(void* vaddr, void* paddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr)
 			 * @brief Create mapping
@@ -187,9 +422,48 @@ namespace mm {
 			 */
 			int map(void* vaddr, void* paddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr);
 
+			/**
+			 * @fn int mapRange(void* vaddr, void* paddr, size_t size, priv_lvl_t priv, prot_t prot, mem_attr_t attr)
+			 * @brief Create mapping for range
+			 * @details
+			 * The translation tables are walked once for the whole range, blocks
+			 * are used whenever possible and the TLB is invalidated in one batch.
+			 * @param vaddr Desired (page-aligned) virtual address
+			 * @param paddr Desired (page-aligned) physical adress
+			 * @param size Size of range (multiple of PAGESIZE)
+			 * @param priv Privileged Level
+			 * @param prot Protection
+			 * @param attr Memory Attribute
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int mapRange(void* vaddr, void* paddr, size_t size, priv_lvl_t priv, prot_t prot, mem_attr_t attr);
+
+			/**
+			 * @fn int unmapRange(void* vaddr, size_t size)
+			 * @brief Unmap (page-aligned) range, release empty translation tables and invalidate TLB in one batch
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int unmapRange(void* vaddr, size_t size);
+
+			/**
+			 * @fn int protectRange(void* vaddr, size_t size, priv_lvl_t priv, prot_t prot, mem_attr_t attr)
+			 * @brief Update protection of (page-aligned and completely mapped) range and invalidate TLB in one batch
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int protectRange(void* vaddr, size_t size, priv_lvl_t priv, prot_t prot, mem_attr_t attr);
+
 			/**
 			 * @fn int unmap(void* vaddr)
-			 * @brief Unmap page
+			 * @brief Unmap page (and split block containing it if necessary) and invalidate its TLB entries
 			 * @return
 			 *
 			 *	- Pointer to page frame   - Success
@@ -199,7 +473,7 @@ namespace mm {
 
 			/**
 			 * @fn int protect(void* vaddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr)
-			 * @brief Update protection of page
+			 * @brief Update protection of page (and split block containing it if necessary) and invalidate its TLB entries
 			 * @return
 			 *
 			 *	-  0 - Success
@@ -0,0 +1,292 @@
+#ifndef _INC_KERNEL_MM_SLAB_H_
+#define _INC_KERNEL_MM_SLAB_H_
+
+#include <new.h>
+#include <cstddef.h>
+#include <utility.h>
+#include <kernel/cpu_local.h>
+#include <kernel/lock/spinlock.h>
+
+/**
+ * @file kernel/mm/slab.h
+ * @brief Slab allocator for fixed-size kernel objects
+ * @details
+ * A slab cache carves blocks of page frames (taken from mm::frameAlloc) into
+ * objects of a fixed size. Free objects are kept in per-CPU free lists, which
+ * are refilled from and drained to a global (locked) free list in batches.
+ * Slabs are never returned to the frame allocator.
+ *
+ * Free objects hold the link of their free list, hence objects are only
+ * constructed on allocation (see ObjectCache::create()).
+ */
+
+namespace mm {
+
+	/**
+	 * @class SlabCache
+	 * @brief Untyped cache of fixed-size objects
+	 */
+	class SlabCache {
+		public:
+			/**
+			 * @struct Statistics
+			 * @brief Usage statistics of a slab cache
+			 */
+			struct Statistics {
+				size_t allocs;  /**< Number of allocations */
+				size_t frees;   /**< Number of frees */
+				size_t hits;    /**< Number of allocations served from per-CPU free list */
+				size_t refills; /**< Number of batched refills of per-CPU free lists */
+				size_t drains;  /**< Number of batched drains of per-CPU free lists */
+				size_t slabs;   /**< Number of allocated slabs */
+				size_t objects; /**< Total number of objects (free and allocated) */
+			};
+
+			/**
+			 * @var CPU_CACHE_SIZE
+			 * @brief Max. number of objects kept per CPU
+			 */
+			static const size_t CPU_CACHE_SIZE = 32;
+
+			/**
+			 * @var CPU_CACHE_BATCH
+			 * @brief Number of objects moved between per-CPU and global free list at once
+			 */
+			static const size_t CPU_CACHE_BATCH = CPU_CACHE_SIZE / 2;
+
+		private:
+			/**
+			 * @struct ObjectLink
+			 * @brief Link between free objects (stored within free object)
+			 */
+			struct ObjectLink {
+				ObjectLink* next;
+			};
+
+			/**
+			 * @struct CPUCache
+			 * @brief Per-CPU free list
+			 */
+			struct alignas(64) CPUCache {
+				ObjectLink* head; /**< First free object */
+				size_t count;     /**< Number of free objects */
+				size_t allocs;    /**< Number of allocations */
+				size_t frees;     /**< Number of frees */
+				size_t hits;      /**< Number of allocations served from list */
+				size_t refills;   /**< Number of batched refills */
+				size_t drains;    /**< Number of batched drains */
+			};
+
+			/**
+			 * @var name
+			 * @brief Name of cache
+			 */
+			const char* name;
+
+			/**
+			 * @var objSize
+			 * @brief Size of a single object (including alignment)
+			 */
+			size_t objSize;
+
+			/**
+			 * @var slabOrder
+			 * @brief Order of page frame blocks used as slabs
+			 */
+			size_t slabOrder;
+
+			/**
+			 * @var head
+			 * @brief Global free list
+			 */
+			ObjectLink* head;
+
+			/**
+			 * @var slabs
+			 * @brief Number of allocated slabs
+			 */
+			size_t slabs;
+
+			/**
+			 * @var lock
+			 * @brief Lock of global free list
+			 */
+			lock::spinlock lock;
+
+			/**
+			 * @var cpuCaches
+			 * @brief Per-CPU free lists
+			 */
+			cpu_local<CPUCache> cpuCaches;
+
+			/**
+			 * @fn bool grow()
+			 * @brief Allocate new slab and add its objects to the global free list (without locking)
+			 */
+			bool grow();
+
+			/**
+			 * @fn void refill(CPUCache& cache)
+			 * @brief Move up to CPU_CACHE_BATCH objects from global to per-CPU free list
+			 */
+			void refill(CPUCache& cache);
+
+			/**
+			 * @fn void drain(CPUCache& cache)
+			 * @brief Move CPU_CACHE_BATCH objects from per-CPU to global free list
+			 */
+			void drain(CPUCache& cache);
+
+		public:
+			/**
+			 * @fn SlabCache(const char* name, size_t size, size_t align)
+			 * @brief Create cache for objects of size bytes with given alignment
+			 */
+			SlabCache(const char* name, size_t size, size_t align);
+
+			SlabCache(const SlabCache& other) = delete;
+
+			SlabCache(SlabCache&& other) = delete;
+
+			SlabCache& operator=(const SlabCache& other) = delete;
+
+			SlabCache& operator=(SlabCache&& other) = delete;
+
+			/**
+			 * @fn void* alloc()
+			 * @brief Allocate object
+			 * @return
+			 *
+			 *	- Pointer to object - Success
+			 *	- nullptr           - Failure
+			 */
+			void* alloc();
+
+			/**
+			 * @fn void free(void* obj)
+			 * @brief Free object (previously allocated from this cache)
+			 */
+			void free(void* obj);
+
+			/**
+			 * @fn const char* getName() const
+			 * @brief Get name of cache
+			 */
+			const char* getName() const;
+
+			/**
+			 * @fn Statistics getStatistics() const
+			 * @brief Get usage statistics (accumulated over all CPUs)
+			 */
+			Statistics getStatistics() const;
+	};
+
+	/**
+	 * @class ObjectCache
+	 * @brief Typed cache of objects of type T
+	 */
+	template<typename T>
+	class ObjectCache : public SlabCache {
+		public:
+			/**
+			 * @fn ObjectCache(const char* name)
+			 * @brief Create cache for objects of type T
+			 */
+			explicit ObjectCache(const char* name) : SlabCache(name, sizeof(T), alignof(T)) {}
+
+			/**
+			 * @fn T* create(Args&&... args)
+			 * @brief Allocate and construct object
+			 * @return
+			 *
+			 *	- Pointer to object - Success
+			 *	- nullptr           - Failure
+			 */
+			template<typename... Args>
+			T* create(Args&&... args) {
+				void* mem = alloc();
+				if (mem == nullptr)
+					return nullptr;
+
+				return new (mem) T(lib::forward<Args>(args)...);
+			}
+
+			/**
+			 * @fn void destroy(T* t)
+			 * @brief Destruct and free object
+			 */
+			void destroy(T* t) {
+				if (t == nullptr)
+					return;
+
+				t->~T();
+				free(t);
+			}
+	};
+
+	/**
+	 * @class SlabObject
+	 * @brief Base class which allocates objects of T using new/delete from an ObjectCache
+	 * @details The cache is named after T::SLAB_NAME.
+	 * @tparam T Derived class
+	 */
+	template<typename T>
+	class SlabObject {
+		private:
+			/**
+			 * @var cache
+			 * @brief Cache used for objects of type T
+			 */
+			static ObjectCache<T> cache;
+
+		public:
+			/**
+			 * @fn static void* operator new(size_t size)
+			 * @brief Allocate object from cache
+			 */
+			static void* operator new(size_t size) {
+				if (size != sizeof(T))
+					return lib::malloc(size);
+
+				return cache.alloc();
+			}
+
+			/**
+			 * @fn static void operator delete(void* ptr, size_t size)
+			 * @brief Return object to cache
+			 */
+			static void operator delete(void* ptr, size_t size) {
+				if (ptr == nullptr)
+					return;
+
+				if (size != sizeof(T)) {
+					lib::free(ptr);
+					return;
+				}
+
+				cache.free(ptr);
+			}
+
+			/**
+			 * @fn static SlabCache::Statistics getCacheStatistics()
+			 * @brief Get usage statistics of underlying cache
+			 */
+			static SlabCache::Statistics getCacheStatistics() {
+				return cache.getStatistics();
+			}
+
+			/**
+			 * @fn static const char* getCacheName()
+			 * @brief Get name of underlying cache
+			 */
+			static const char* getCacheName() {
+				return cache.getName();
+			}
+	};
+
+	template<typename T>
+	ObjectCache<T> SlabObject<T>::cache(T::SLAB_NAME);
+
+} /* namespace mm */
+
+#endif /* ifndef _INC_KERNEL_MM_SLAB_H_ */
@@ -0,0 +1,204 @@
+#ifndef _INC_KERNEL_MM_TLB_SHOOTDOWN_H_
+#define _INC_KERNEL_MM_TLB_SHOOTDOWN_H_
+
+#include <atomic.h>
+#include <cstddef.h>
+#include <cstdint.h>
+#include <kernel/config.h>
+#include <kernel/cpu_mask.h>
+#include <kernel/cpu_local.h>
+#include <kernel/lock/spinlock.h>
+
+/**
+ * @file kernel/mm/tlb_shootdown.h
+ * @brief Invalidate TLB entries on all CPUs using a translation
+ * @details
+ * After a mapping was removed or changed, TLB entries for it must be
+ * invalidated on every CPU which may have cached it. If only the current CPU
+ * is affected, a local invalidation is used. Otherwise, the broadcast TLB
+ * maintenance instructions (TLBI ... IS) reach all CPUs of the inner shareable
+ * domain without interrupting them.
+ * If CONFIG_TLB_SHOOTDOWN = IPI is used, the range is instead queued for each
+ * affected CPU, which gets a single IPI and invalidates all queued ranges
+ * locally. A range for a CPU whose IPI is still pending is coalesced into its
+ * queue without sending another IPI. The caller waits until all affected CPUs
+ * are done. As waiting for other CPUs requires enabled interrupts, callers
+ * with disabled interrupts always use the broadcast.
+ */
+
+namespace mm {
+
+	/**
+	 * @class TLBShootdown
+	 * @brief TLB shootdown
+	 */
+	class TLBShootdown {
+		public:
+			/**
+			 * @var QUEUE_SIZE
+			 * @brief Max. number of ranges queued per CPU (before whole TLB is invalidated)
+			 */
+			static const size_t QUEUE_SIZE = 16;
+
+			/**
+			 * @struct Statistics
+			 * @brief Usage statistics
+			 */
+			struct Statistics {
+				size_t shootdowns; /**< Number of invalidate() calls */
+				size_t local;      /**< Number of shootdowns handled by current CPU only */
+				size_t broadcasts; /**< Number of shootdowns using broadcast TLB maintenance */
+				size_t ipis;       /**< Number of sent IPIs */
+				size_t coalesced;  /**< Number of ranges queued for a CPU whose IPI was still pending */
+				size_t overflows;  /**< Number of queues replaced by invalidation of whole TLB */
+			};
+
+		private:
+			/**
+			 * @struct Range
+			 * @brief Queued range of pages
+			 */
+			struct Range {
+				uintptr_t start; /**< First page */
+				size_t pages;    /**< Number of pages */
+			};
+
+			/**
+			 * @struct Queue
+			 * @brief Ranges queued for a single CPU
+			 */
+			struct alignas(64) Queue {
+				lock::spinlock lock;             /**< Lock of queue */
+				Range ranges[QUEUE_SIZE];        /**< Queued ranges */
+				size_t count;                    /**< Number of queued ranges */
+				bool flushAll;                   /**< Whole TLB must be invalidated */
+				bool pending;                    /**< IPI was sent, but not handled yet */
+				uint64_t requested;              /**< Ticket of last queued range */
+				lib::atomic<uint64_t> completed; /**< Ticket of last invalidated range */
+			};
+
+			/**
+			 * @var useIPIs
+			 * @brief Deliver shootdowns via IPIs (see CONFIG_TLB_SHOOTDOWN)
+			 */
+			bool useIPIs;
+
+			/**
+			 * @var queues
+			 * @brief Per-CPU queues
+			 */
+			cpu_local<Queue> queues;
+
+			/**
+			 * @var shootdowns
+			 * @brief Number of invalidate() calls
+			 */
+			lib::atomic<size_t> shootdowns;
+
+			/**
+			 * @var local
+			 * @brief Number of shootdowns handled by current CPU only
+			 */
+			lib::atomic<size_t> local;
+
+			/**
+			 * @var broadcasts
+			 * @brief Number of shootdowns using broadcast TLB maintenance
+			 */
+			lib::atomic<size_t> broadcasts;
+
+			/**
+			 * @var ipis
+			 * @brief Number of sent IPIs
+			 */
+			lib::atomic<size_t> ipis;
+
+			/**
+			 * @var coalesced
+			 * @brief Number of ranges queued for a CPU whose IPI was still pending
+			 */
+			lib::atomic<size_t> coalesced;
+
+			/**
+			 * @var overflows
+			 * @brief Number of queues replaced by invalidation of whole TLB
+			 */
+			lib::atomic<size_t> overflows;
+
+			/**
+			 * @fn uint64_t enqueue(size_t cpuID, uintptr_t start, size_t pages, bool& sendIPI)
+			 * @brief Queue range for CPU cpuID and return ticket of request
+			 * @details
+			 * sendIPI is set if no IPI is pending for the CPU (and one must be sent).
+			 */
+			uint64_t enqueue(size_t cpuID, uintptr_t start, size_t pages, bool& sendIPI);
+
+			/**
+			 * @fn static void invalidateLocal(uintptr_t start, size_t pages)
+			 * @brief Invalidate range in TLB of current CPU (or whole TLB for large ranges)
+			 */
+			static void invalidateLocal(uintptr_t start, size_t pages);
+
+			/**
+			 * @fn static void invalidateBroadcast(uintptr_t start, size_t pages)
+			 * @brief Invalidate range in TLBs of all CPUs of the inner shareable domain (or whole TLBs for large ranges)
+			 */
+			static void invalidateBroadcast(uintptr_t start, size_t pages);
+
+		public:
+			/**
+			 * @fn TLBShootdown()
+			 * @brief Create TLB shootdown
+			 */
+			TLBShootdown();
+
+			TLBShootdown(const TLBShootdown& other) = delete;
+
+			TLBShootdown(TLBShootdown&& other) = delete;
+
+			TLBShootdown& operator=(const TLBShootdown& other) = delete;
+
+			TLBShootdown& operator=(TLBShootdown&& other) = delete;
+
+			/**
+			 * @fn int init()
+			 * @brief Register IPI handler (if IPIs are used)
+			 * @warning This function must be called after initializing the IPI driver
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int init();
+
+			/**
+			 * @fn void invalidate(const cpu_mask* cpus, void* vaddr, size_t size)
+			 * @brief Invalidate TLB entries of (page-aligned) range on all CPUs of cpus
+			 * @details
+			 * If cpus is nullptr (e.g. for the kernel mapping), all registered
+			 * CPUs are affected. Returns after all affected CPUs invalidated the
+			 * range.
+			 */
+			void invalidate(const cpu_mask* cpus, void* vaddr, size_t size);
+
+			/**
+			 * @fn int process()
+			 * @brief Invalidate all ranges queued for current CPU
+			 * @return
+			 *
+			 *	-  0 - Success
+			 */
+			int process();
+
+			/**
+			 * @fn Statistics getStatistics() const
+			 * @brief Get usage statistics
+			 */
+			Statistics getStatistics() const;
+	};
+
+	extern TLBShootdown tlbShootdown;
+
+} /* namespace mm */
+
+#endif /* ifndef _INC_KERNEL_MM_TLB_SHOOTDOWN_H_ */
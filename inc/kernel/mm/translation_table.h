@@ -22,7 +22,7 @@ namespace mm {
 			typedef union {
 				struct {
 					uint64_t present:1;    /**< Bit 00: Present Bit */
-					uint64_t one:1;        /**< Bit 01: Must be one */
+					uint64_t type:1;       /**< Bit 01: Descriptor Type (1: Table/Page, 0: Block) */
 					uint64_t attrIndex:3;  /**< Bit 02: Memory Attributes Index Field (see MAIR) */
 					uint64_t ns:1;         /**< Bit 05: Non-Secure Bit */
 					uint64_t ap:2;         /**< Bit 06: Data Access Permission Bits */
@@ -57,6 +57,8 @@ namespace mm {
 			 */
 			TranslationTable();
 
+			TranslationTable(const TranslationTable& other) = default;
+
 			TranslationTable& operator=(const TranslationTable& other) = default;
 
 			TranslationTable& operator=(TranslationTable&& other) = default;
@@ -115,7 +117,7 @@ namespace mm {
 			 * - attrIndex: 1 (Normal memory)
 			 * - ns:        0
 			 * - ap:        1 (ELX_RW_EL0_RW)
-			 * - sh:        0 (NON_SHAREABLE)
+			 * - sh:        3 (INNER_SHAREABLE)
 			 * - aF:        1 (Software Access Flag see D5.4.10)
 			 * - nG:        0
 			 * - addr:      0
@@ -135,7 +137,7 @@ namespace mm {
 			 * - attrIndex: 1 (Normal memory)
 			 * - ns:        0
 			 * - ap:        1 (ELX_RW_EL0_RW)
-			 * - sh:        0 (NON_SHAREABLE)
+			 * - sh:        3 (INNER_SHAREABLE)
 			 * - aF:        1 (Software Access Flag see D5.4.10)
 			 * - nG:        0
 			 * - addr:      0
@@ -166,6 +168,47 @@ namespace mm {
 			 */
 			int setPresentBit(size_t entry, bool present);
 
+			/**
+			 * @fn int getBlockBit(size_t entry) const
+			 * @brief Check if entry is a block descriptor (only valid for present entries in level 1 and 2)
+			 * @warning entry must be less than NUM_ENTRIES
+			 * @return
+			 *
+			 *	-  1 - Entry is a block descriptor
+			 *	-  0 - Entry is a table (or page) descriptor
+			 *	- <1 - Failure (-errno)
+			 */
+			int getBlockBit(size_t entry) const;
+
+			/**
+			 * @fn int setBlockBit(size_t entry, bool block)
+			 * @brief Set entry as block descriptor or table (or page) descriptor
+			 * @warning entry must be less than NUM_ENTRIES
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <1 - Failure (-errno)
+			 */
+			int setBlockBit(size_t entry, bool block);
+
+			/**
+			 * @fn uint64_t getDescriptor(size_t entry) const
+			 * @brief Get raw descriptor of entry
+			 * @warning entry must be less than NUM_ENTRIES
+			 */
+			uint64_t getDescriptor(size_t entry) const;
+
+			/**
+			 * @fn int setDescriptor(size_t entry, uint64_t descriptor)
+			 * @brief Set raw descriptor of entry
+			 * @warning entry must be less than NUM_ENTRIES
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <1 - Failure (-errno)
+			 */
+			int setDescriptor(size_t entry, uint64_t descriptor);
+
 			/**
 			 * @fn int getAttrIndex(size_t entry) const
 			 * @brief Get index (in MAIR) for entry
@@ -0,0 +1,84 @@
+#ifndef _INC_KERNEL_PERCPU_H_
+#define _INC_KERNEL_PERCPU_H_
+
+#include <cstddef.h>
+#include <cstdint.h>
+
+/**
+ * @file kernel/percpu.h
+ * @brief Per-CPU areas
+ * @details
+ * Each CPU owns an area of AREA_SIZE bytes in the .bss.percpu linker section.
+ * Per-CPU data (see cpu_local) is placed at the same offset within every area,
+ * in slots aligned to (at least) a cache line, so data of different CPUs never
+ * shares a cache line. The base address of the area of the current CPU is kept
+ * in TPIDR_EL1, hence accessing per-CPU data of the current CPU only needs an
+ * mrs and an add.
+ */
+
+namespace percpu {
+
+	/**
+	 * @var AREA_SIZE
+	 * @brief Size of per-CPU area of a single CPU
+	 */
+	static const size_t AREA_SIZE = 16 * 1024;
+
+	/**
+	 * @var SLOT_ALIGN
+	 * @brief Minimal alignment of slots (size of a cache line)
+	 */
+	static const size_t SLOT_ALIGN = 64;
+
+	/**
+	 * @fn size_t allocate(size_t size, size_t align)
+	 * @brief Allocate slot in per-CPU areas and return its offset
+	 * @details
+	 * Slots are allocated during construction of global objects and never
+	 * released. If the areas are exhausted, init() fails.
+	 */
+	size_t allocate(size_t size, size_t align);
+
+	/**
+	 * @fn uintptr_t getArea(size_t cpuID)
+	 * @brief Get base address of per-CPU area of CPU cpuID
+	 * @warning cpuID must be less than MAX_NUM_CPUS
+	 */
+	uintptr_t getArea(size_t cpuID);
+
+	/**
+	 * @fn void setBase(size_t cpuID)
+	 * @brief Set base address of current CPU (cpuID) in TPIDR_EL1
+	 * @warning This function must be called before any per-CPU data is accessed on this CPU
+	 */
+	void setBase(size_t cpuID);
+
+	/**
+	 * @fn uintptr_t getBase()
+	 * @brief Get base address of per-CPU area of current CPU
+	 */
+	inline uintptr_t getBase() {
+		uintptr_t base;
+		asm volatile("mrs %0, TPIDR_EL1" : "=r"(base));
+		return base;
+	}
+
+	/**
+	 * @fn int init()
+	 * @brief Check if all slots fit into per-CPU areas
+	 * @return
+	 *
+	 *	-  0 - Success
+	 *	- <0 - Failure (-errno)
+	 */
+	int init();
+
+	/**
+	 * @fn size_t getUsed()
+	 * @brief Get number of allocated bytes per CPU
+	 */
+	size_t getUsed();
+
+} /* namespace percpu */
+
+#endif /* ifndef _INC_KERNEL_PERCPU_H_ */
@@ -0,0 +1,204 @@
+#ifndef _INC_KERNEL_SYSCALL_SCHED_H_
+#define _INC_KERNEL_SYSCALL_SCHED_H_
+
+/**
+ * @file kernel/syscall/sched.h
+ * @brief Thread and Scheduler System Calls
+ */
+
+#include <kernel/irq/exception_handler.h>
+#include <kernel/thread/scheduler.h>
+
+#include <cstddef.h>
+
+namespace syscall {
+
+	/**
+	 * @fn long clone(void (*entry)())
+	 * @brief Create user thread executing entry (within address space of calling thread)
+	 * @details
+	 * The user stack of thread i is placed at Paging::USER_SPACE_END - (2 * i + 1) *
+	 * STACK_SIZE, hence stacks are separated by unmapped guard areas.
+	 * @return
+	 *
+	 *	- >0 - ID of created thread
+	 *	- <0 - Failure (-errno)
+	 */
+	long clone(void (*entry)());
+
+	/**
+	 * @fn void __clone(irq::ExceptionContext* irq)
+	 * @brief Clone system call wrapper
+	 */
+	void __clone(irq::ExceptionContext* irq);
+
+	/**
+	 * @fn void exit()
+	 * @brief Terminate calling thread (on return from system call)
+	 */
+	void exit();
+
+	/**
+	 * @fn void __exit(irq::ExceptionContext* irq)
+	 * @brief Exit system call wrapper
+	 */
+	void __exit(irq::ExceptionContext* irq);
+
+	/**
+	 * @fn void __sched_yield(irq::ExceptionContext* irq)
+	 * @brief Yield system call wrapper (reschedule on return from system call)
+	 */
+	void __sched_yield(irq::ExceptionContext* irq);
+
+	/**
+	 * @struct timespec
+	 * @brief Time interval (like POSIX)
+	 */
+	struct timespec {
+		long tv_sec;  /**< Seconds */
+		long tv_nsec; /**< Nanoseconds (within [0, 999999999]) */
+	};
+
+	/**
+	 * @struct sched_param
+	 * @brief Scheduling parameters (like POSIX)
+	 */
+	struct sched_param {
+		int sched_priority; /**< Real-time priority (0 for SCHED_OTHER) */
+	};
+
+	/**
+	 * @fn long nanosleep(const timespec* req)
+	 * @brief Let calling thread wait for (at least) req (on return from system call)
+	 * @details Sleeping threads are woken up by the timer tick, hence the delay is rounded up to the tick interval.
+	 * @return
+	 *
+	 *	-  0 - Success
+	 *	- <0 - Failure (-errno)
+	 */
+	long nanosleep(const timespec* req);
+
+	/**
+	 * @fn void __nanosleep(irq::ExceptionContext* irq)
+	 * @brief Nanosleep system call wrapper (remaining time is never written, as sleeping is not interrupted)
+	 */
+	void __nanosleep(irq::ExceptionContext* irq);
+
+	/**
+	 * @var PRIO_PROCESS
+	 * @brief Priority of a single thread (only supported target of getpriority/setpriority)
+	 */
+	static const int PRIO_PROCESS = 0;
+
+	/**
+	 * @fn long getpriority(int which, size_t who)
+	 * @brief Get nice level of calling thread (who must be 0 or its ID)
+	 * @return
+	 *
+	 *	- >0 - 20 - nice level (within [1, 40], like Linux)
+	 *	- <0 - Failure (-errno)
+	 */
+	long getpriority(int which, size_t who);
+
+	/**
+	 * @fn void __getpriority(irq::ExceptionContext* irq)
+	 * @brief Getpriority system call wrapper
+	 */
+	void __getpriority(irq::ExceptionContext* irq);
+
+	/**
+	 * @fn long setpriority(int which, size_t who, int nice)
+	 * @brief Set nice level (and therefore CPU share) of calling thread (who must be 0 or its ID)
+	 * @return
+	 *
+	 *	-  0 - Success
+	 *	- <0 - Failure (-errno)
+	 */
+	long setpriority(int which, size_t who, int nice);
+
+	/**
+	 * @fn void __setpriority(irq::ExceptionContext* irq)
+	 * @brief Setpriority system call wrapper
+	 */
+	void __setpriority(irq::ExceptionContext* irq);
+
+	/**
+	 * @fn long sched_setscheduler(size_t pid, int policy, const sched_param* param)
+	 * @brief Set scheduling policy (SCHED_OTHER, SCHED_FIFO or SCHED_RR) and priority of calling thread (pid must be 0 or its ID)
+	 * @return
+	 *
+	 *	-  0 - Success
+	 *	- <0 - Failure (-errno)
+	 */
+	long sched_setscheduler(size_t pid, int policy, const sched_param* param);
+
+	/**
+	 * @fn void __sched_setscheduler(irq::ExceptionContext* irq)
+	 * @brief Sched_setscheduler system call wrapper
+	 */
+	void __sched_setscheduler(irq::ExceptionContext* irq);
+
+	/**
+	 * @fn long sched_getscheduler(size_t pid)
+	 * @brief Get scheduling policy of calling thread (pid must be 0 or its ID)
+	 * @return
+	 *
+	 *	- >=0 - Policy
+	 *	-  <0 - Failure (-errno)
+	 */
+	long sched_getscheduler(size_t pid);
+
+	/**
+	 * @fn void __sched_getscheduler(irq::ExceptionContext* irq)
+	 * @brief Sched_getscheduler system call wrapper
+	 */
+	void __sched_getscheduler(irq::ExceptionContext* irq);
+
+	/**
+	 * @fn long sched_stats(size_t cpuID, thread::Scheduler::Statistics* stats)
+	 * @brief Get scheduler statistics of CPU cpuID
+	 * @return
+	 *
+	 *	-  0 - Success
+	 *	- <0 - Failure (-errno)
+	 */
+	long sched_stats(size_t cpuID, thread::Scheduler::Statistics* stats);
+
+	/**
+	 * @fn void __sched_stats(irq::ExceptionContext* irq)
+	 * @brief Scheduler statistics system call wrapper
+	 */
+	void __sched_stats(irq::ExceptionContext* irq);
+
+	/**
+	 * @var WAKEUP_LATENCY_DEADLINE
+	 * @brief Wakeup latency from requested wakeup time (e.g. of nanosleep) until running
+	 */
+	static const int WAKEUP_LATENCY_DEADLINE = 0;
+
+	/**
+	 * @var WAKEUP_LATENCY_READY
+	 * @brief Wakeup latency from becoming runnable until running
+	 */
+	static const int WAKEUP_LATENCY_READY = 1;
+
+	/**
+	 * @fn long sched_wakeup_latency(int which)
+	 * @brief Get time (system counter ticks) from last wakeup of calling thread until it was running
+	 * @param which WAKEUP_LATENCY_DEADLINE or WAKEUP_LATENCY_READY
+	 * @return
+	 *
+	 *	- >=0 - Latency
+	 *	- <0  - Failure (-errno)
+	 */
+	long sched_wakeup_latency(int which);
+
+	/**
+	 * @fn void __sched_wakeup_latency(irq::ExceptionContext* irq)
+	 * @brief Wakeup latency system call wrapper
+	 */
+	void __sched_wakeup_latency(irq::ExceptionContext* irq);
+
+} /* namespace syscall */
+
+#endif /* ifndef _INC_KERNEL_SYSCALL_SCHED_H_ */
@@ -55,6 +55,12 @@ namespace syscall {
 	 */
 	bool isReadable(const void* buf, size_t size);
 
+	/**
+	 * @fn bool isWritable(void* buf, size_t size)
+	 * @brief Check if buffer is writable by user thread
+	 */
+	bool isWritable(void* buf, size_t size);
+
 } /* namespace syscall */
 
 #endif /* ifndef _INC_KERNEL_SYSCALL_SYSCALL_H_ */
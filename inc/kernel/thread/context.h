@@ -3,7 +3,12 @@
 
 #include <cstdint.h>
 #include <cstdlib.h>
+#include <kernel/mm/slab.h>
+#include <kernel/mm/address_space.h>
 #include <kernel/irq/exception_handler.h>
+#include <kernel/time/timer_wheel.h>
+#include <kernel/thread/fair_queue.h>
+#include <kernel/thread/rt_queue.h>
 
 /**
  * @file kernel/thread/context.h
@@ -11,18 +16,40 @@
  */
 namespace thread {
 
+	class Scheduler;
+
 	/**
 	 * @enum State
 	 * @brief Execution states of a thread
+	 * @details
+	 * A thread is CREATED by Context::init(), READY while waiting in a run
+	 * queue and RUNNING while executed by a CPU. It is TERMINATED after
+	 * calling Scheduler::exit() and released by the scheduler afterwards.
 	 */
 	enum class State {
 		CREATED,    /**< Created thread */
+		READY,      /**< Runnable thread (within run queue) */
 		RUNNING,    /**< Running thread */
 		TERMINATED, /**< Terminated thread */
 		WAITING,    /**< Waiting thread */
 		INVALID,    /**< INVALID state */
 	};
 
+	/**
+	 * @enum Policy
+	 * @brief Scheduling policies (values match SCHED_OTHER, SCHED_FIFO and SCHED_RR)
+	 * @details
+	 * FIFO and RR threads (see RtQueue) always run before NORMAL threads (see
+	 * FairQueue). A FIFO thread runs until it waits, yields or is preempted by
+	 * a thread of higher priority. RR threads additionally pass the CPU to
+	 * threads of the same priority once their time slice is used up.
+	 */
+	enum class Policy {
+		NORMAL = 0, /**< Fair-share scheduling */
+		FIFO   = 1, /**< Fixed priority, first in first out */
+		RR     = 2, /**< Fixed priority, round-robin */
+	};
+
 	/**
 	 * @struct SavedContext
 	 * @brief Saved context (for context switching)
@@ -41,13 +68,22 @@ namespace thread {
 		uint64_t x29;
 		uint64_t x30;
 		uint64_t sp;
+		uint64_t onCPU; /**< Context is used by a CPU (cleared after it was saved) */
 	} __attribute__((packed));
 
 	/**
 	 * @class Context
 	 * @brief Thread context
+	 * @details Dynamically allocated contexts are taken from a slab cache
 	 */
-	class Context {
+	class Context : public mm::SlabObject<Context> {
+		public:
+			/**
+			 * @var SLAB_NAME
+			 * @brief Name of slab cache of contexts
+			 */
+			static constexpr const char* SLAB_NAME = "thread::Context";
+
 		private:
 			/**
 			 * @var id
@@ -85,6 +121,130 @@ namespace thread {
 			 */
 			irq::ExceptionContext* exceptionContext;
 
+			/**
+			 * @var addressSpace
+			 * @brief User address space (or nullptr for kernel mapping only)
+			 */
+			mm::AddressSpace* addressSpace;
+
+			/**
+			 * @var cpu
+			 * @brief CPU of run queue (last CPU executing the thread)
+			 */
+			size_t cpu;
+
+			/**
+			 * @var fairNode
+			 * @brief Node within fair queue (holding virtual runtime)
+			 */
+			FairTree::RBNode fairNode;
+
+			/**
+			 * @var nice
+			 * @brief Nice level
+			 */
+			int nice;
+
+			/**
+			 * @var weight
+			 * @brief Weight of nice level
+			 */
+			uint32_t weight;
+
+			/**
+			 * @var execStart
+			 * @brief System counter when running thread was last charged
+			 */
+			uint64_t execStart;
+
+			/**
+			 * @var runStart
+			 * @brief System counter when thread was scheduled (for minimum granularity)
+			 */
+			uint64_t runStart;
+
+			/**
+			 * @var policy
+			 * @brief Scheduling policy
+			 */
+			Policy policy;
+
+			/**
+			 * @var rtPriority
+			 * @brief Real-time priority (0 for NORMAL threads)
+			 */
+			int rtPriority;
+
+			/**
+			 * @var rtNext
+			 * @brief Next thread of same priority within real-time queue
+			 */
+			Context* rtNext;
+
+			/**
+			 * @var rtPrev
+			 * @brief Previous thread of same priority within real-time queue
+			 */
+			Context* rtPrev;
+
+			/**
+			 * @var rtSlice
+			 * @brief Remaining time slice (system counter ticks) of RR thread
+			 */
+			uint64_t rtSlice;
+
+			/**
+			 * @var yielded
+			 * @brief Requeue real-time thread behind threads of same priority
+			 */
+			bool yielded;
+
+			/**
+			 * @var sleepTimer
+			 * @brief Timer waking up sleeping thread
+			 */
+			time::timer_head sleepTimer;
+
+			/**
+			 * @var wakeAt
+			 * @brief System counter at which sleeping thread is woken up (or 0)
+			 */
+			uint64_t wakeAt;
+
+			/**
+			 * @var wakeTime
+			 * @brief System counter when thread was made runnable (or 0 once running)
+			 */
+			uint64_t wakeTime;
+
+			/**
+			 * @var wakeLatency
+			 * @brief Time (system counter) from last wakeup until thread was running
+			 */
+			uint64_t wakeLatency;
+
+			/**
+			 * @var wakeDeadline
+			 * @brief Requested wakeup time (system counter) of woken up sleeping thread (or 0)
+			 */
+			uint64_t wakeDeadline;
+
+			/**
+			 * @var deadlineLatency
+			 * @brief Time (system counter) from requested wakeup time (or last wakeup) until thread was running
+			 */
+			uint64_t deadlineLatency;
+
+			/**
+			 * @var lastRun
+			 * @brief System counter when thread was last descheduled (cache hotness)
+			 */
+			uint64_t lastRun;
+
+			friend class Scheduler;
+			friend class FairQueue;
+			friend class RtQueue;
+
 		public:
 			/**
 			 * @fn Context()
@@ -105,6 +265,9 @@ namespace thread {
 			/**
 			 * @fn ~Context()
 			 * @brief Destructor
+			 * @details
+			 * Only the kernel stack is released, the user stack is an area of
+			 * the user address space.
 			 */
 			~Context();
 
@@ -114,6 +277,37 @@ namespace thread {
 			 */
 			size_t getID() const;
 
+			/**
+			 * @fn void* getUserStack() const
+			 * @brief Get start address of user stack
+			 */
+			void* getUserStack() const;
+
+			/**
+			 * @fn Policy getPolicy() const
+			 * @brief Get scheduling policy
+			 */
+			Policy getPolicy() const;
+
+			/**
+			 * @fn int getPriority() const
+			 * @brief Get real-time priority (0 for NORMAL threads)
+			 */
+			int getPriority() const;
+
+			/**
+			 * @fn uint64_t getWakeLatency() const
+			 * @brief Get time (system counter) from last wakeup until thread was running
+			 */
+			uint64_t getWakeLatency() const;
+
+			/**
+			 * @fn uint64_t getDeadlineLatency() const
+			 * @brief Get time (system counter) from requested wakeup time until thread was running
+			 * @details Includes the delay until the timer tick expiring the sleep.
+			 */
+			uint64_t getDeadlineLatency() const;
+
 			/**
 			 * @fn void setState(State state)
 			 * @brief Set execution state
@@ -138,9 +332,21 @@ namespace thread {
 			 */
 			irq::ExceptionContext* getExceptionContext() const;
 
+			/**
+			 * @fn void setAddressSpace(mm::AddressSpace* addressSpace)
+			 * @brief Set user address space
+			 */
+			void setAddressSpace(mm::AddressSpace* addressSpace);
+
+			/**
+			 * @fn mm::AddressSpace* getAddressSpace() const
+			 * @brief Get user address space (or nullptr for kernel mapping only)
+			 */
+			mm::AddressSpace* getAddressSpace() const;
+
 			/**
 			 * @fn static void switching(Context* old, Context* next)
-			 * @brief Perform context switch
+			 * @brief Perform context switch (and switch address space if necessary)
 			 */
 			static void switching(Context* old, Context* next);
 	};
@@ -0,0 +1,209 @@
+#ifndef _INC_KERNEL_THREAD_FAIR_QUEUE_H_
+#define _INC_KERNEL_THREAD_FAIR_QUEUE_H_
+
+#include <cstddef.h>
+#include <cstdint.h>
+#include <kernel/adt/rbtree.h>
+
+/**
+ * @file kernel/thread/fair_queue.h
+ * @brief Run queue of the fair-share scheduling class
+ * @details
+ * Each thread accumulates virtual runtime while running: The consumed time is
+ * scaled by NICE_0_WEIGHT / weight, hence a thread with twice the weight of
+ * another thread gets twice the share of the CPU until both virtual runtimes are
+ * equal. READY threads are sorted by their virtual runtime, the leftmost thread
+ * (i.e. the thread which received the least service) is executed next.
+ *
+ * Virtual runtimes are only comparable within a queue. Therefore, minVruntime
+ * tracks the (monotonically increasing) smallest virtual runtime of the queue,
+ * which is used to place new and migrated threads.
+ */
+
+namespace thread {
+
+	class Context;
+
+	/**
+	 * @struct FairEntity
+	 * @brief Sort key of a thread within a FairQueue
+	 * @details Ties are broken by the address of the thread, hence keys are unique.
+	 */
+	struct FairEntity {
+		uint64_t vruntime; /**< Virtual runtime (in system counter ticks) */
+		Context* thread;   /**< Thread */
+
+		bool operator<(const FairEntity& other) const {
+			/* Difference is signed, hence a wrap-around of the virtual runtime is harmless */
+			auto delta = static_cast<int64_t>(vruntime - other.vruntime);
+			if (delta != 0)
+				return delta < 0;
+
+			return reinterpret_cast<uintptr_t>(thread) < reinterpret_cast<uintptr_t>(other.thread);
+		}
+
+		bool operator==(const FairEntity& other) const {
+			return vruntime == other.vruntime && thread == other.thread;
+		}
+	};
+
+	/**
+	 * @typedef FairTree
+	 * @brief READY threads sorted by virtual runtime
+	 */
+	using FairTree = RBTree<FairEntity>;
+
+	/**
+	 * @class FairQueue
+	 * @brief READY threads of a single CPU sorted by virtual runtime
+	 * @warning The running thread isn't part of the queue and all methods must be called with the lock of the run queue held
+	 */
+	class FairQueue {
+		public:
+			/**
+			 * @var NICE_MIN
+			 * @brief Smallest nice level (highest weight)
+			 */
+			static const int NICE_MIN = -20;
+
+			/**
+			 * @var NICE_MAX
+			 * @brief Largest nice level (lowest weight)
+			 */
+			static const int NICE_MAX = 19;
+
+			/**
+			 * @var NICE_0_WEIGHT
+			 * @brief Weight of nice level 0
+			 */
+			static const uint32_t NICE_0_WEIGHT = 1024;
+
+		private:
+			/**
+			 * @var tree
+			 * @brief READY threads
+			 */
+			FairTree tree;
+
+			/**
+			 * @var minVruntime
+			 * @brief Smallest virtual runtime of queue (never decreases)
+			 */
+			uint64_t minVruntime;
+
+			/**
+			 * @var totalWeight
+			 * @brief Sum of weights of READY threads
+			 */
+			uint64_t totalWeight;
+
+		public:
+			/**
+			 * @fn FairQueue()
+			 * @brief Create empty queue
+			 */
+			FairQueue();
+
+			FairQueue(const FairQueue& other) = delete;
+
+			FairQueue(FairQueue&& other) = delete;
+
+			FairQueue& operator=(const FairQueue& other) = delete;
+
+			FairQueue& operator=(FairQueue&& other) = delete;
+
+			/**
+			 * @fn static uint32_t niceToWeight(int nice)
+			 * @brief Get weight of nice level (each level changes the share by about 10%)
+			 * @warning nice must be within [NICE_MIN, NICE_MAX]
+			 */
+			static uint32_t niceToWeight(int nice);
+
+			/**
+			 * @fn static void charge(Context* thread, uint64_t delta)
+			 * @brief Add delta (system counter ticks) scaled by weight to virtual runtime of running thread
+			 */
+			static void charge(Context* thread, uint64_t delta);
+
+			/**
+			 * @fn void enqueue(Context* thread)
+			 * @brief Insert thread (with its current virtual runtime)
+			 */
+			void enqueue(Context* thread);
+
+			/**
+			 * @fn void dequeue(Context* thread)
+			 * @brief Remove thread
+			 * @warning thread must be part of queue
+			 */
+			void dequeue(Context* thread);
+
+			/**
+			 * @fn Context* first()
+			 * @brief Get thread with smallest virtual runtime in O(1) (or nullptr)
+			 */
+			Context* first();
+
+			/**
+			 * @fn Context* last()
+			 * @brief Get thread with largest virtual runtime (or nullptr)
+			 */
+			Context* last();
+
+			/**
+			 * @fn Context* prev(Context* thread)
+			 * @brief Get thread preceding thread (or nullptr)
+			 */
+			Context* prev(Context* thread);
+
+			/**
+			 * @fn void update(Context* current)
+			 * @brief Advance minVruntime (considering running thread current, which might be nullptr)
+			 */
+			void update(Context* current);
+
+			/**
+			 * @fn void place(Context* thread, bool wakeup, uint64_t credit)
+			 * @brief Limit lag of attached thread becoming runnable
+			 * @details
+			 * New threads start at minVruntime, waking threads may start up to
+			 * credit before minVruntime (but keep their own lag if it is smaller).
+			 * @param wakeup Thread was waiting (instead of being created)
+			 * @param credit Virtual runtime (system counter ticks) granted to waking threads
+			 */
+			void place(Context* thread, bool wakeup, uint64_t credit);
+
+			/**
+			 * @fn void detach(Context* thread)
+			 * @brief Make virtual runtime of thread removed from queue relative to minVruntime (for migration)
+			 */
+			void detach(Context* thread);
+
+			/**
+			 * @fn void attach(Context* thread)
+			 * @brief Make relative virtual runtime of thread (see detach()) absolute for this queue
+			 */
+			void attach(Context* thread);
+
+			/**
+			 * @fn uint64_t getMinVruntime() const
+			 * @brief Get smallest virtual runtime of queue
+			 */
+			uint64_t getMinVruntime() const;
+
+			/**
+			 * @fn size_t size() const
+			 * @brief Get number of READY threads
+			 */
+			size_t size() const;
+
+			/**
+			 * @fn uint64_t getTotalWeight() const
+			 * @brief Get sum of weights of READY threads
+			 */
+			uint64_t getTotalWeight() const;
+	};
+
+} /* namespace thread */
+
+#endif /* ifndef _INC_KERNEL_THREAD_FAIR_QUEUE_H_ */
@@ -0,0 +1,138 @@
+#ifndef _INC_KERNEL_THREAD_RT_QUEUE_H_
+#define _INC_KERNEL_THREAD_RT_QUEUE_H_
+
+#include <cstddef.h>
+#include <cstdint.h>
+
+/**
+ * @file kernel/thread/rt_queue.h
+ * @brief Run queue of the real-time scheduling classes
+ * @details
+ * READY real-time threads are kept in one FIFO list per priority. A bitmap
+ * marks the non-empty lists, hence the thread with the highest priority is
+ * found in O(1) (independent of the number of threads).
+ */
+
+namespace thread {
+
+	class Context;
+
+	/**
+	 * @class RtQueue
+	 * @brief READY real-time threads of a single CPU
+	 * @warning The running thread isn't part of the queue and all methods must be called with the lock of the run queue held
+	 */
+	class RtQueue {
+		public:
+			/**
+			 * @var MIN_PRIORITY
+			 * @brief Lowest real-time priority
+			 */
+			static const int MIN_PRIORITY = 1;
+
+			/**
+			 * @var MAX_PRIORITY
+			 * @brief Highest real-time priority
+			 */
+			static const int MAX_PRIORITY = 99;
+
+		private:
+			/**
+			 * @var NUM_PRIORITIES
+			 * @brief Number of lists (priority 0 is unused)
+			 */
+			static const size_t NUM_PRIORITIES = MAX_PRIORITY + 1;
+
+			/**
+			 * @var NUM_WORDS
+			 * @brief Number of words of bitmap
+			 */
+			static const size_t NUM_WORDS = (NUM_PRIORITIES + 63) / 64;
+
+			/**
+			 * @var bitmap
+			 * @brief Set bit for each non-empty list
+			 */
+			uint64_t bitmap[NUM_WORDS];
+
+			/**
+			 * @var heads
+			 * @brief First thread of each priority
+			 */
+			Context* heads[NUM_PRIORITIES];
+
+			/**
+			 * @var tails
+			 * @brief Last thread of each priority
+			 */
+			Context* tails[NUM_PRIORITIES];
+
+			/**
+			 * @var count
+			 * @brief Number of READY threads
+			 */
+			size_t count;
+
+			/**
+			 * @fn int lowestPriority() const
+			 * @brief Get lowest priority of READY threads (or -1 if queue is empty)
+			 */
+			int lowestPriority() const;
+
+		public:
+			/**
+			 * @fn RtQueue()
+			 * @brief Create empty queue
+			 */
+			RtQueue();
+
+			RtQueue(const RtQueue& other) = delete;
+
+			RtQueue(RtQueue&& other) = delete;
+
+			RtQueue& operator=(const RtQueue& other) = delete;
+
+			RtQueue& operator=(RtQueue&& other) = delete;
+
+			/**
+			 * @fn void enqueue(Context* thread, bool head)
+			 * @brief Insert thread at end (or start) of list of its priority
+			 * @param head Thread was preempted and continues before other threads of same priority
+			 */
+			void enqueue(Context* thread, bool head);
+
+			/**
+			 * @fn void dequeue(Context* thread)
+			 * @brief Remove thread
+			 * @warning thread must be part of queue
+			 */
+			void dequeue(Context* thread);
+
+			/**
+			 * @fn Context* first() const
+			 * @brief Get first thread of highest priority in O(1) (or nullptr)
+			 */
+			Context* first() const;
+
+			/**
+			 * @fn Context* last() const
+			 * @brief Get last thread of lowest priority (or nullptr)
+			 */
+			Context* last() const;
+
+			/**
+			 * @fn int highestPriority() const
+			 * @brief Get highest priority of READY threads (or -1 if queue is empty)
+			 */
+			int highestPriority() const;
+
+			/**
+			 * @fn size_t size() const
+			 * @brief Get number of READY threads
+			 */
+			size_t size() const;
+	};
+
+} /* namespace thread */
+
+#endif /* ifndef _INC_KERNEL_THREAD_RT_QUEUE_H_ */
@@ -0,0 +1,474 @@
+#ifndef _INC_KERNEL_THREAD_SCHEDULER_H_
+#define _INC_KERNEL_THREAD_SCHEDULER_H_
+
+#include <atomic.h>
+#include <cstddef.h>
+#include <cstdint.h>
+#include <kernel/cpu_local.h>
+#include <kernel/lock/spinlock.h>
+#include <kernel/thread/context.h>
+#include <kernel/thread/fair_queue.h>
+#include <kernel/thread/rt_queue.h>
+
+/**
+ * @file kernel/thread/scheduler.h
+ * @brief Preemptive fair-share and real-time scheduler with work stealing
+ * @details
+ * Real-time threads (FIFO and RR, see Policy) are kept in a separate run queue
+ * per CPU (see RtQueue) and always run before fair-share threads. A real-time
+ * thread becoming runnable is placed on the CPU running the least important
+ * thread and preempts it immediately: Locally on return from the interrupt,
+ * remotely by the RESCHEDULE IPI. RR threads pass the CPU to threads of the
+ * same priority after RR_TIMESLICE_US (checked on the tick).
+ *
+ * Each CPU owns a run queue of READY threads sorted by virtual runtime (see
+ * FairQueue). The thread which received the least weighted service is executed
+ * next, hence threads get CPU time proportional to the weight of their nice
+ * level. If a run queue is empty, the idle thread of its CPU is executed.
+ * Runtime is charged from the system counter (on ticks, wakeups and switches),
+ * not in units of timer ticks.
+ *
+ * Within LATENCY_US, each runnable thread should run once (for a share of the
+ * period according to its weight). With many threads, the period is stretched,
+ * so no thread runs less than MIN_GRANULARITY_US before being preempted in
+ * favor of a thread with less virtual runtime. A thread becoming runnable
+ * preempts the running thread immediately if its virtual runtime is smaller by
+ * more than WAKEUP_GRANULARITY_US. Preemption is decided on the timer tick (and
+ * the RESCHEDULE IPI on all other CPUs) and on wakeups, and performed on return
+ * from the interrupt. Threads executing in kernel mode are only preempted if
+ * neither epilogues nor preemption are disabled (see preempt_guard). Spinlocks
+ * don't disable preemption, hence kernel code only takes them within epilogues
+ * (e.g. system calls) or with disabled interrupts. Kernel threads (besides the
+ * idle threads, which hold no locks when interrupts are enabled) are therefore
+ * not supported.
+ *
+ * Sleeping threads are woken up by a timer (see time::TimerWheel) on the CPU
+ * they fell asleep on.
+ *
+ * Idle CPUs might stop their tick (see NO_HZ), hence busy CPUs with waiting
+ * threads wake up such a CPU every BALANCE_INTERVAL ticks to steal a thread.
+ *
+ * Threads are placed on the CPU with the shortest run queue when becoming
+ * runnable. A CPU running out of threads (or being idle on its tick) steals
+ * from the busiest CPU, taking the thread with the largest virtual runtime.
+ * Additionally, each CPU pulls a thread from the busiest CPU every
+ * BALANCE_INTERVAL ticks if the loads differ by at least two threads. Threads
+ * which ran within MIGRATION_COST_US are only stolen by idle CPUs from queues
+ * with several waiting threads, as their cache footprint would be lost.
+ * Migrated threads keep their virtual runtime relative to the minimal virtual
+ * runtime of the queue.
+ */
+
+namespace thread {
+
+	/**
+	 * @class Scheduler
+	 * @brief Preemptive fair-share and real-time scheduler with per-CPU run queues
+	 */
+	class Scheduler {
+		private:
+			/**
+			 * @var LATENCY_US
+			 * @brief Period (in us) in which each runnable thread should run once
+			 */
+			static const uint64_t LATENCY_US = 24000;
+
+			/**
+			 * @var MIN_GRANULARITY_US
+			 * @brief Minimal time (in us) a thread runs before being preempted by the tick
+			 */
+			static const uint64_t MIN_GRANULARITY_US = 3000;
+
+			/**
+			 * @var WAKEUP_GRANULARITY_US
+			 * @brief Advance in virtual runtime (in us) required to preempt on wakeup
+			 */
+			static const uint64_t WAKEUP_GRANULARITY_US = 4000;
+
+			/**
+			 * @var RR_TIMESLICE_US
+			 * @brief Time slice (in us) of RR threads
+			 */
+			static const uint64_t RR_TIMESLICE_US = 100000;
+
+			/**
+			 * @var BALANCE_INTERVAL
+			 * @brief Number of timer ticks between periodic balancing
+			 */
+			static const size_t BALANCE_INTERVAL = 2;
+
+			/**
+			 * @var MIGRATION_COST_US
+			 * @brief Time (in us) after which a descheduled thread is considered cache-cold
+			 */
+			static const uint64_t MIGRATION_COST_US = 500;
+
+			/**
+			 * @struct RunQueue
+			 * @brief Run queue of a single CPU (on its own cache line)
+			 */
+			struct alignas(64) RunQueue {
+				lock::spinlock lock;        /**< Lock of queue (taken with disabled interrupts) */
+				RtQueue rt;                 /**< READY real-time threads */
+				FairQueue fair;             /**< READY threads sorted by virtual runtime */
+				lib::atomic<size_t> length; /**< Number of READY threads */
+				Context* current;           /**< Running thread (or nullptr before start()) */
+				lib::atomic<int> priority;  /**< Rank of running thread (see rank()) */
+				Context* idle;              /**< Idle thread */
+				Context* dead;              /**< Terminated thread, which must be released */
+				bool needResched;           /**< Reschedule on next return from interrupt */
+				size_t preemptCount;        /**< Nesting of disabled preemption */
+				size_t ticks;               /**< Number of timer ticks */
+				uint64_t idleStart;         /**< System counter when idle thread was entered */
+				uint64_t idleTime;          /**< Time (system counter) spent in idle thread */
+				size_t switches;            /**< Number of context switches */
+				size_t steals;              /**< Number of threads stolen while idle */
+				size_t migrations;          /**< Number of threads pulled by periodic balancing */
+			};
+
+			/**
+			 * @var queues
+			 * @brief Per-CPU run queues
+			 */
+			cpu_local<RunQueue> queues;
+
+			/**
+			 * @var latency
+			 * @brief LATENCY_US in system counter ticks
+			 */
+			uint64_t latency;
+
+			/**
+			 * @var minGranularity
+			 * @brief MIN_GRANULARITY_US in system counter ticks
+			 */
+			uint64_t minGranularity;
+
+			/**
+			 * @var wakeupGranularity
+			 * @brief WAKEUP_GRANULARITY_US in system counter ticks
+			 */
+			uint64_t wakeupGranularity;
+
+			/**
+			 * @var rrTimeslice
+			 * @brief RR_TIMESLICE_US in system counter ticks
+			 */
+			uint64_t rrTimeslice;
+
+			/**
+			 * @var migrationCost
+			 * @brief MIGRATION_COST_US in system counter ticks
+			 */
+			uint64_t migrationCost;
+
+			/**
+			 * @var nextID
+			 * @brief ID of next created thread
+			 */
+			lib::atomic<size_t> nextID;
+
+			/**
+			 * @fn static int rank(const RunQueue& queue, const Context* thread)
+			 * @brief Get importance of thread (0 for idle, 1 for NORMAL and 1 + priority for real-time threads)
+			 */
+			static int rank(const RunQueue& queue, const Context* thread);
+
+			/**
+			 * @fn void enqueue(RunQueue& queue, Context* thread, bool head = false)
+			 * @brief Insert thread into queue of its class
+			 * @param head Real-time thread is inserted before threads of same priority
+			 * @warning Lock of queue must be held
+			 */
+			void enqueue(RunQueue& queue, Context* thread, bool head = false);
+
+			/**
+			 * @fn Context* dequeue(RunQueue& queue)
+			 * @brief Remove real-time thread with highest priority or thread with smallest virtual runtime (or return nullptr if queue is empty)
+			 * @warning Lock of queue must be held
+			 */
+			Context* dequeue(RunQueue& queue);
+
+			/**
+			 * @fn void updateCurrent(RunQueue& queue, uint64_t now)
+			 * @brief Charge running thread of queue up to now
+			 * @warning Lock of queue must be held
+			 */
+			void updateCurrent(RunQueue& queue, uint64_t now);
+
+			/**
+			 * @fn uint64_t idealRuntime(RunQueue& queue, Context* thread) const
+			 * @brief Get share (system counter ticks) of running thread within current period
+			 * @warning Lock of queue must be held
+			 */
+			uint64_t idealRuntime(RunQueue& queue, Context* thread) const;
+
+			/**
+			 * @fn size_t selectCPU(const Context* thread) const
+			 * @brief Select CPU for a thread becoming runnable
+			 */
+			size_t selectCPU(const Context* thread) const;
+
+			/**
+			 * @fn size_t getLoad(size_t cpuID) const
+			 * @brief Get number of READY and running threads (except the idle thread) of CPU cpuID
+			 */
+			size_t getLoad(size_t cpuID) const;
+
+			/**
+			 * @fn size_t findBusiest(size_t cpuID, size_t& load) const
+			 * @brief Find CPU with highest load (except cpuID) and return it (with its load)
+			 */
+			size_t findBusiest(size_t cpuID, size_t& load) const;
+
+			/**
+			 * @fn Context* stealFrom(size_t victim, bool hot)
+			 * @brief Remove thread with largest virtual runtime from victim's queue (or return nullptr)
+			 * @details The virtual runtime of the returned thread is relative (see FairQueue::detach())
+			 * @param hot Cache-hot threads may be stolen if several threads are waiting
+			 * @warning Interrupts must be disabled and no lock of a run queue must be held
+			 */
+			Context* stealFrom(size_t victim, bool hot);
+
+			/**
+			 * @fn Context* steal(size_t cpuID)
+			 * @brief Steal thread from busiest CPU for idle CPU cpuID (or return nullptr)
+			 * @warning Interrupts must be disabled and no lock of a run queue must be held
+			 */
+			Context* steal(size_t cpuID);
+
+			/**
+			 * @fn void balance(size_t cpuID)
+			 * @brief Pull thread from busiest CPU into run queue of CPU cpuID (if imbalanced)
+			 * @warning Interrupts must be disabled and no lock of a run queue must be held
+			 */
+			void balance(size_t cpuID);
+
+			/**
+			 * @fn void kickIdle(size_t cpuID)
+			 * @brief Wake up an idle CPU with stopped tick if threads of CPU cpuID are waiting
+			 */
+			void kickIdle(size_t cpuID);
+
+			/**
+			 * @fn void sleep(Context* thread)
+			 * @brief Start sleep timer of descheduled thread on current CPU
+			 * @warning Interrupts must be disabled
+			 */
+			void sleep(Context* thread);
+
+			/**
+			 * @fn static void wakeup(time::timer_head* timer)
+			 * @brief Make sleeping thread runnable once its wakeup time expired (sleep timer)
+			 */
+			static void wakeup(time::timer_head* timer);
+
+			/**
+			 * @fn void schedule()
+			 * @brief Switch to next thread of local run queue (requeueing running thread)
+			 * @warning Interrupts must be disabled
+			 */
+			void schedule();
+
+		public:
+			/**
+			 * @struct Statistics
+			 * @brief Per-CPU statistics
+			 */
+			struct Statistics {
+				uint64_t now;        /**< System counter when statistics were taken */
+				uint64_t frequency;  /**< Frequency of system counter */
+				uint64_t idleTime;   /**< Time (system counter) spent in idle thread */
+				size_t length;       /**< Number of READY threads */
+				size_t switches;     /**< Number of context switches */
+				size_t steals;       /**< Number of threads stolen while idle */
+				size_t migrations;   /**< Number of threads pulled by periodic balancing */
+				size_t ticksAvoided; /**< Number of timer ticks not delivered to idle CPU */
+			};
+
+			/**
+			 * @fn Scheduler()
+			 * @brief Create scheduler with empty run queues
+			 */
+			Scheduler();
+
+			Scheduler(const Scheduler& other) = delete;
+
+			Scheduler(Scheduler&& other) = delete;
+
+			Scheduler& operator=(const Scheduler& other) = delete;
+
+			Scheduler& operator=(Scheduler&& other) = delete;
+
+			/**
+			 * @fn int init()
+			 * @brief Charge running threads on timer tick (on all CPUs)
+			 * @warning This function must be called after initializing the timer wheel
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int init();
+
+			/**
+			 * @fn size_t allocateID()
+			 * @brief Get unique thread ID
+			 */
+			size_t allocateID();
+
+			/**
+			 * @fn void ready(Context* thread)
+			 * @brief Make CREATED or WAITING thread runnable
+			 */
+			void ready(Context* thread);
+
+			/**
+			 * @fn void start()
+			 * @brief Start scheduling on current CPU
+			 * @warning This function must be called once per CPU (after initializing its idle thread)
+			 */
+			[[noreturn]] void start();
+
+			/**
+			 * @fn void yield()
+			 * @brief Reschedule running thread (which continues if it is still the most eligible thread)
+			 * @warning This function must not be called within an epilogue or with disabled preemption
+			 */
+			void yield();
+
+			/**
+			 * @fn void exit()
+			 * @brief Terminate running thread
+			 * @warning This function must not be called within an epilogue or with disabled preemption
+			 */
+			[[noreturn]] void exit();
+
+			/**
+			 * @fn void requestReschedule()
+			 * @brief Reschedule on next return from interrupt (e.g. yield from system call)
+			 */
+			void requestReschedule();
+
+			/**
+			 * @fn void requestExit()
+			 * @brief Terminate running thread on next return from interrupt (e.g. exit from system call)
+			 */
+			void requestExit();
+
+			/**
+			 * @fn void requestSleep(uint64_t until)
+			 * @brief Let running thread wait until system counter reaches until (on next return from interrupt)
+			 * @details Sleeping threads are woken up by the tick of their CPU.
+			 */
+			void requestSleep(uint64_t until);
+
+			/**
+			 * @fn int tick()
+			 * @brief Charge running thread of current CPU (request reschedule if its share is used up)
+			 * @return
+			 *
+			 *	-  0 - Success
+			 */
+			int tick();
+
+			/**
+			 * @fn void preempt(bool user)
+			 * @brief Perform requested reschedule on return from interrupt
+			 * @param user Interrupt returns to user mode
+			 * @warning Interrupts must be disabled
+			 */
+			void preempt(bool user);
+
+			/**
+			 * @fn void disablePreemption()
+			 * @brief Don't preempt running thread (in kernel mode) on current CPU
+			 */
+			void disablePreemption();
+
+			/**
+			 * @fn void enablePreemption()
+			 * @brief Undo disablePreemption()
+			 */
+			void enablePreemption();
+
+			/**
+			 * @fn int setNice(int nice)
+			 * @brief Set nice level (and therefore the weight) of running thread
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int setNice(int nice);
+
+			/**
+			 * @fn int setPolicy(Policy policy, int priority)
+			 * @brief Set scheduling policy and real-time priority (0 for NORMAL) of running thread
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int setPolicy(Policy policy, int priority);
+
+			/**
+			 * @fn int getNice()
+			 * @brief Get nice level of running thread
+			 */
+			int getNice();
+
+			/**
+			 * @fn Context* current()
+			 * @brief Get running thread of current CPU
+			 */
+			Context* current();
+
+			/**
+			 * @fn Statistics getStatistics(size_t cpuID) const
+			 * @brief Get statistics of CPU cpuID
+			 * @warning cpuID must be less than MAX_NUM_CPUS
+			 */
+			Statistics getStatistics(size_t cpuID) const;
+	};
+
+	/**
+	 * @var scheduler
+	 * @brief Global scheduler
+	 */
+	extern Scheduler scheduler;
+
+	/**
+	 * @class preempt_guard
+	 * @brief Disable preemption for lifetime of guard
+	 */
+	class preempt_guard {
+		public:
+			/**
+			 * @fn preempt_guard()
+			 * @brief Disable preemption
+			 */
+			preempt_guard() {
+				scheduler.disablePreemption();
+			}
+
+			/**
+			 * @fn ~preempt_guard()
+			 * @brief Enable preemption
+			 */
+			~preempt_guard() {
+				scheduler.enablePreemption();
+			}
+
+			preempt_guard(const preempt_guard& other) = delete;
+
+			preempt_guard(preempt_guard&& other) = delete;
+
+			preempt_guard& operator=(const preempt_guard& other) = delete;
+
+			preempt_guard& operator=(preempt_guard&& other) = delete;
+	};
+
+} /* namespace thread */
+
+#endif /* ifndef _INC_KERNEL_THREAD_SCHEDULER_H_ */
@@ -0,0 +1,281 @@
+#ifndef _INC_KERNEL_TIME_TIMER_WHEEL_H_
+#define _INC_KERNEL_TIME_TIMER_WHEEL_H_
+
+#include <cstddef.h>
+#include <cstdint.h>
+#include <functional.h>
+#include <kernel/cpu_local.h>
+#include <kernel/lock/rcu.h>
+#include <kernel/lock/spinlock.h>
+
+/**
+ * @file kernel/time/timer_wheel.h
+ * @brief Per-CPU hierarchical timing wheel
+ * @details
+ * Timers expire on timer ticks (see driver::Timer) and are kept in the wheel
+ * of the CPU they were added on. A wheel consists of LEVELS levels with SLOTS
+ * slots each. Level 0 holds timers expiring within the next SLOTS ticks (one
+ * slot per tick), each further level covers SLOTS times the range of its
+ * predecessor. Whenever all lower levels wrapped around, the current slot of a
+ * level is cascaded (i.e. its timers are distributed among the lower levels).
+ * Hence adding, cancelling and expiring a timer takes O(1) (each timer is
+ * cascaded at most LEVELS - 1 times).
+ *
+ * Deferrable timers (e.g. periodic housekeeping) are kept in a separate wheel
+ * and don't prevent an idle CPU from stopping its tick (see nextExpiry()). They
+ * are expired once the CPU processes its ticks again.
+ *
+ * Each wheel is protected by its own lock, callbacks are executed without
+ * holding it (within an RCU read-side critical section).
+ */
+
+namespace time {
+
+	/**
+	 * @struct timer_head
+	 * @brief Timer (embedded into object, zero-initialized)
+	 */
+	struct timer_head {
+		timer_head* next;                /**< Next timer of slot */
+		timer_head** pprev;              /**< Link pointing to timer (nullptr if not pending) */
+		uint64_t expires;                /**< Tick of expiry */
+		size_t period;                   /**< Period (in ticks) of periodic timer (or 0) */
+		size_t cpu;                      /**< CPU of wheel (while pending) */
+		bool deferrable;                 /**< Idle CPU isn't woken up for timer */
+		void (*func)(timer_head* timer); /**< Function called on expiry */
+		void* data;                      /**< Data of func */
+	};
+
+	/**
+	 * @class TimerWheel
+	 * @brief Per-CPU hierarchical timing wheels
+	 */
+	class TimerWheel {
+		private:
+			/**
+			 * @var LEVEL_BITS
+			 * @brief Number of bits of tick resolved by a level
+			 */
+			static const size_t LEVEL_BITS = 6;
+
+			/**
+			 * @var SLOTS
+			 * @brief Number of slots per level
+			 */
+			static const size_t SLOTS = 1 << LEVEL_BITS;
+
+			/**
+			 * @var LEVELS
+			 * @brief Number of levels
+			 */
+			static const size_t LEVELS = 4;
+
+			/**
+			 * @var MAX_DELTA
+			 * @brief Range of wheel (in ticks, later timers are cascaded again)
+			 */
+			static const uint64_t MAX_DELTA = static_cast<uint64_t>(1) << (LEVELS * LEVEL_BITS);
+
+			/**
+			 * @var MAX_FUNCTIONS
+			 * @brief Number of registable functions
+			 */
+			static const size_t MAX_FUNCTIONS = 10;
+
+			/**
+			 * @struct Wheel
+			 * @brief Slots of all levels
+			 */
+			struct Wheel {
+				timer_head* slots[LEVELS][SLOTS]; /**< Pending timers */
+				uint64_t pending[LEVELS];         /**< Bitmap of non-empty slots */
+			};
+
+			/**
+			 * @struct Base
+			 * @brief Timers of a single CPU (on its own cache line)
+			 */
+			struct alignas(64) Base {
+				lock::spinlock lock; /**< Lock of timers */
+				uint64_t clk;        /**< Next tick to be processed */
+				timer_head* expired; /**< Expired timers of tick being processed */
+				Wheel wheels[2];     /**< Timers (index 1 for deferrable timers) */
+			};
+
+			/**
+			 * @struct Function
+			 * @brief Registered function (freed after a grace period, see lock::RCU)
+			 */
+			struct Function : public lock::rcu_head {
+				lib::function<int(void)> function;   /**< Actual callback */
+				timer_head timers[MAX_NUM_CPUS];     /**< Periodic timer of each CPU */
+			};
+
+			/**
+			 * @var bases
+			 * @brief Per-CPU timers
+			 */
+			cpu_local<Base> bases;
+
+			/**
+			 * @var functions
+			 * @brief Registered functions
+			 */
+			Function* functions[MAX_FUNCTIONS];
+
+			/**
+			 * @var functionsLock
+			 * @brief Lock of functions
+			 */
+			lock::spinlock functionsLock;
+
+			/**
+			 * @fn void enqueue(Base& base, timer_head* timer)
+			 * @brief Insert timer into slot according to its expiry
+			 * @warning Lock of base must be held
+			 */
+			void enqueue(Base& base, timer_head* timer);
+
+			/**
+			 * @fn void unlink(Base& base, timer_head* timer)
+			 * @brief Remove pending timer from its slot (or list of expired timers)
+			 * @warning Lock of base must be held
+			 */
+			void unlink(Base& base, timer_head* timer);
+
+			/**
+			 * @fn bool isEmpty(const Base& base) const
+			 * @brief Check if no timer is pending in base
+			 * @warning Lock of base must be held
+			 */
+			bool isEmpty(const Base& base) const;
+
+			/**
+			 * @fn void cascade(Base& base, Wheel& wheel, size_t level, size_t slot)
+			 * @brief Redistribute timers of slot among lower levels
+			 * @warning Lock of base must be held
+			 */
+			void cascade(Base& base, Wheel& wheel, size_t level, size_t slot);
+
+			/**
+			 * @fn void advance(Base& base, Wheel& wheel)
+			 * @brief Cascade wheel and move timers expiring on base.clk to expired timers
+			 * @warning Lock of base must be held
+			 */
+			void advance(Base& base, Wheel& wheel);
+
+			/**
+			 * @fn static void callFunction(timer_head* timer)
+			 * @brief Execute registered function
+			 */
+			static void callFunction(timer_head* timer);
+
+		public:
+			/**
+			 * @fn TimerWheel()
+			 * @brief Create wheels without timers
+			 */
+			TimerWheel();
+
+			TimerWheel(const TimerWheel& other) = delete;
+
+			TimerWheel(TimerWheel&& other) = delete;
+
+			TimerWheel& operator=(const TimerWheel& other) = delete;
+
+			TimerWheel& operator=(TimerWheel&& other) = delete;
+
+			/**
+			 * @fn int init()
+			 * @brief Process wheels of CPUs ticked by the RESCHEDULE IPI
+			 * @warning This function must be called after initializing the timer and IPI driver
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int init();
+
+			/**
+			 * @fn void add(timer_head* timer, size_t ticks, size_t period = 0)
+			 * @brief Start timer (func and data must be set) on current CPU
+			 * @details A pending timer is restarted.
+			 * @param ticks Number of ticks until expiry (timer expires on tick, 0 for next tick)
+			 * @param period Period of periodic timer in ticks (or 0 for one-shot timer)
+			 */
+			void add(timer_head* timer, size_t ticks, size_t period = 0);
+
+			/**
+			 * @fn void addOn(size_t cpuID, timer_head* timer, size_t ticks, size_t period = 0)
+			 * @brief Start timer on CPU cpuID (see add())
+			 * @warning A timer must not be started concurrently on several CPUs
+			 */
+			void addOn(size_t cpuID, timer_head* timer, size_t ticks, size_t period = 0);
+
+			/**
+			 * @fn bool cancel(timer_head* timer)
+			 * @brief Stop timer
+			 * @details The callback might still be executed concurrently on the CPU of the timer.
+			 * @return
+			 *
+			 *	- true  - Timer was pending
+			 *	- false - Timer wasn't pending
+			 */
+			bool cancel(timer_head* timer);
+
+			/**
+			 * @fn bool isPending(const timer_head* timer) const
+			 * @brief Check if timer is pending
+			 */
+			bool isPending(const timer_head* timer) const;
+
+			/**
+			 * @fn void run()
+			 * @brief Expire timers of current CPU up to current tick
+			 * @details Periodic timers are restarted before their callback is executed.
+			 */
+			void run();
+
+			/**
+			 * @fn uint64_t nextExpiry()
+			 * @brief Get system counter of next tick with expiring timer on current CPU (or 0)
+			 * @details Deferrable timers are ignored.
+			 */
+			uint64_t nextExpiry();
+
+			/**
+			 * @fn size_t toTicks(uint64_t counter) const
+			 * @brief Convert system counter ticks to timer ticks (rounded up)
+			 */
+			size_t toTicks(uint64_t counter) const;
+
+			/**
+			 * @fn int registerFunction(size_t ticks, lib::function<int(void)> callback)
+			 * @brief Execute callback every ticks ticks on each CPU (deferrable)
+			 * @return
+			 *
+			 *	- >=0 - ID of function
+			 *	- <0  - Failure (-errno)
+			 */
+			int registerFunction(size_t ticks, lib::function<int(void)> callback);
+
+			/**
+			 * @fn int unregisterFunction(int id)
+			 * @brief Unregister function (which might still be executed by concurrent timers)
+			 * @return
+			 *
+			 *	-  0 - Success
+			 *	- <0 - Failure (-errno)
+			 */
+			int unregisterFunction(int id);
+	};
+
+	/**
+	 * @var timerWheel
+	 * @brief Global timer wheels
+	 */
+	extern TimerWheel timerWheel;
+
+} /* namespace time */
+
+#endif /* ifndef _INC_KERNEL_TIME_TIMER_WHEEL_H_ */
@@ -110,17 +110,24 @@ namespace util {
 		return *static_cast<volatile T*>(ptr);
 	}
 
+	/**
+	 * @fn unsigned long long zeroExtend(T x)
+	 * @brief Zero-extend integral value to 64 bit
+	 */
+	template<typename T>
+	unsigned long long zeroExtend(T x) {
+		static_assert(sizeof(T) <= sizeof(unsigned long long), "T must not exceed 64 bit");
+
+		return static_cast<unsigned long long>(x) & (~0ULL >> (64 - sizeof(T) * 8));
+	}
+
 	/**
 	 * @fn int popcount(T x)
 	 * @brief Number of 1 bits
 	 */
 	template<typename T>
 	int popcount(T x) {
-		int ret = 0;
-		for (size_t i = 0; i < sizeof(x) * 8; i++) {
-			ret += x & (1L << i);
-		}
-		return ret;
+		return __builtin_popcountll(zeroExtend(x));
 	}
 
 	/**
@@ -129,12 +136,11 @@ namespace util {
 	 */
 	template<typename T>
 	int ffs(T x) {
-		for (size_t i = 0; i < sizeof(x) * 8; i++) {
-			 if (x & (1L << i))
-				 return i;
-		}
+		unsigned long long bits = zeroExtend(x);
+		if (bits == 0)
+			return -1;
 
-		return -1;
+		return __builtin_ctzll(bits);
 	}
 
 	/**
@@ -143,12 +149,11 @@ namespace util {
 	 */
 	template<typename T>
 	int fls(T x) {
-		for (int i = sizeof(x) * 8 - 1; i >= 0; i--) {
-			 if (x & (1L << i))
-				 return i;
-		}
+		unsigned long long bits = zeroExtend(x);
+		if (bits == 0)
+			return -1;
 
-		return -1;
+		return 63 - __builtin_clzll(bits);
 	}
 
 } /* namespace util */
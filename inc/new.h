@@ -21,4 +21,13 @@ void operator delete(void* p, size_t size);
 
 void operator delete [](void* p, size_t size);
 
+/**
+ * @fn void* operator new(size_t size, void* ptr)
+ * @brief Placement new
+ */
+inline void* operator new(size_t size, void* ptr) noexcept {
+	(void) size;
+	return ptr;
+}
+
 #endif /* ifndef _INC_NEW_H_ */
@@ -359,4 +359,8 @@
 #define SYS_FACCESSAT2               439
 #define SYS_PROCESS_MADVISE          440
 
+/* ARMOS specific system calls */
+#define SYS_SCHED_STATS              512
+#define SYS_SCHED_WAKEUP_LATENCY     513
+
 #endif /* ifndef _INC_SYS_SYSCALL_H_ */
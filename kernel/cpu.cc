@@ -1,4 +1,5 @@
 #include <kernel/cpu.h>
+#include <kernel/math.h>
 #include <hw/register/sctlr.h>
 #include <hw/register/daif.h>
 
@@ -48,19 +49,141 @@ void CPU::invalidatePage(void *vaddr) {
 		"tlbi vaae1is, %0\n\t"
 		"dsb ish\n\t"
 		"isb\n\t"
-		:: "r"(vaddr)
+		:: "r"(reinterpret_cast<uintptr_t>(vaddr) >> 12)
 	);
 }
 
+void CPU::invalidatePages(void *vaddr, size_t num) {
+	auto page = reinterpret_cast<uintptr_t>(vaddr) >> 12;
+
+	asm volatile("dsb ish" ::: "memory");
+	for (size_t i = 0; i < num; i++)
+		asm volatile("tlbi vaae1is, %0" :: "r"(page + i));
+	asm volatile("dsb ish\n\tisb" ::: "memory");
+}
+
+void CPU::invalidateLocalPages(void *vaddr, size_t num) {
+	auto page = reinterpret_cast<uintptr_t>(vaddr) >> 12;
+
+	asm volatile("dsb nsh" ::: "memory");
+	for (size_t i = 0; i < num; i++)
+		asm volatile("tlbi vaae1, %0" :: "r"(page + i));
+	asm volatile("dsb nsh\n\tisb" ::: "memory");
+}
+
 void CPU::invalidateTLB() {
 	asm(
 		"dsb ish\n\t"
-		"tlbi alle1is\n\t"
+		"tlbi vmalle1is\n\t"
+		"dsb ish\n\t"
+		"isb\n\t"
+	);
+}
+
+void CPU::invalidateLocalTLB() {
+	asm(
+		"dsb nsh\n\t"
+		"tlbi vmalle1\n\t"
+		"dsb nsh\n\t"
+		"isb\n\t"
+	);
+}
+
+void CPU::invalidateASID(size_t asid) {
+	asm(
+		"dsb ish\n\t"
+		"tlbi aside1is, %0\n\t"
 		"dsb ish\n\t"
 		"isb\n\t"
+		:: "r"(static_cast<uint64_t>(asid) << 48)
 	);
 }
 
+size_t CPU::getASIDBits() {
+	uint64_t mmfr0;
+	asm("mrs %0, ID_AA64MMFR0_EL1" : "=r"(mmfr0));
+	return ((mmfr0 >> 4) & 0xF) == 0b0010 ? 16 : 8;
+}
+
+void CPU::invalidateDataCache() {
+	/* Get level of coherency */
+	uint64_t clidr;
+	asm volatile("mrs %0, CLIDR_EL1" : "=r"(clidr));
+	size_t loc = (clidr >> 24) & 0x7;
+
+	for (size_t level = 0; level < loc; level++) {
+		/* Skip levels without data or unified cache */
+		auto ctype = (clidr >> (level * 3)) & 0x7;
+		if (ctype < 0b010)
+			continue;
+
+		/* Select cache level and read its geometry */
+		uint64_t ccsidr;
+		asm volatile(
+			"msr CSSELR_EL1, %1\n\t"
+			"isb\n\t"
+			"mrs %0, CCSIDR_EL1\n\t"
+			: "=r"(ccsidr) : "r"(level << 1)
+		);
+		size_t lineShift = (ccsidr & 0x7) + 4;
+		uint32_t ways = ((ccsidr >> 3) & 0x3FF) + 1;
+		uint32_t sets = ((ccsidr >> 13) & 0x7FFF) + 1;
+		size_t wayShift = (ways > 1) ? __builtin_clz(ways - 1) : 0;
+
+		for (uint64_t way = 0; way < ways; way++) {
+			for (uint64_t set = 0; set < sets; set++) {
+				uint64_t setWay = (way << wayShift) | (set << lineShift) | (level << 1);
+				asm volatile("dc isw, %0" :: "r"(setWay) : "memory");
+			}
+		}
+	}
+
+	asm(
+		"dsb sy\n\t"
+		"isb\n\t"
+	);
+}
+
+void CPU::invalidateInstrCache() {
+	asm(
+		"ic iallu\n\t"
+		"dsb nsh\n\t"
+		"isb\n\t"
+	);
+}
+
+/**
+ * @fn static size_t getDataCacheLineSize()
+ * @brief Get smallest data cache line size (in bytes)
+ */
+static size_t getDataCacheLineSize() {
+	uint64_t ctr;
+	asm("mrs %0, CTR_EL0" : "=r"(ctr));
+	return 4 << ((ctr >> 16) & 0xF);
+}
+
+void CPU::cleanDataCache(void* addr, size_t size) {
+	auto lineSize = getDataCacheLineSize();
+	auto start = math::roundDown(reinterpret_cast<uintptr_t>(addr), lineSize);
+	auto end = reinterpret_cast<uintptr_t>(addr) + size;
+
+	for (auto line = start; line < end; line += lineSize)
+		asm volatile("dc cvac, %0" :: "r"(line) : "memory");
+
+	asm("dsb sy");
+}
+
+void CPU::cleanInvalidateDataCache(void* addr, size_t size) {
+	auto lineSize = getDataCacheLineSize();
+	auto start = math::roundDown(reinterpret_cast<uintptr_t>(addr), lineSize);
+	auto end = reinterpret_cast<uintptr_t>(addr) + size;
+
+	for (auto line = start; line < end; line += lineSize)
+		asm volatile("dc civac, %0" :: "r"(line) : "memory");
+
+	asm("dsb sy");
+}
+
 size_t CPU::getProcessorID() {
 	uint64_t mpidr = 0;
 	asm("mrs %0, MPIDR_EL1" : "=r"(mpidr));
@@ -71,10 +194,37 @@ void CPU::setTranslationTable(void *addr) {
 	asm("msr TTBR0_EL1, %0" :: "r"(addr));
 }
 
+void CPU::setTranslationTable(void *addr, size_t asid) {
+	auto ttbr = reinterpret_cast<uint64_t>(addr) | (static_cast<uint64_t>(asid) << 48);
+	asm volatile(
+		"msr TTBR0_EL1, %0\n\t"
+		"isb\n\t"
+		:: "r"(ttbr) : "memory"
+	);
+}
+
 void* CPU::getTranslationTable() {
-	void* addr;
-	asm("mrs %0, TTBR0_EL1" : "=r"(addr));
-	return addr;
+	uint64_t ttbr;
+	asm("mrs %0, TTBR0_EL1" : "=r"(ttbr));
+
+	/* Strip ASID */
+	return reinterpret_cast<void*>(ttbr & ((static_cast<uint64_t>(1) << 48) - 1));
+}
+
+uint64_t CPU::getSystemCounter() {
+	uint64_t counter;
+	asm volatile(
+		"isb\n\t"
+		"mrs %0, CNTPCT_EL0\n\t"
+		: "=r"(counter)
+	);
+	return counter;
+}
+
+uint64_t CPU::getSystemCounterFrequency() {
+	uint64_t freq;
+	asm("mrs %0, CNTFRQ_EL0" : "=r"(freq));
+	return freq;
 }
 
 void CPU::halt() {
@@ -88,3 +238,7 @@ void CPU::wakeup() {
 void CPU::dataBarrier() {
 	asm("dsb sy");
 }
+
+void CPU::instrBarrier() {
+	asm("isb");
+}
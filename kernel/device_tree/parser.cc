@@ -49,9 +49,61 @@ NodeIt Parser::end() const {
 	return NodeIt(nullptr, reinterpret_cast<void*>(ptrStruct), reinterpret_cast<const char*>(ptrStrings));
 }
 
-driver::config Parser::findConfig(const driver::generic_driver& driver) const {
-	auto name = driver.getName();
+lib::pair<void*, size_t> Parser::findRegister(const Node& node) const {
+	/* Check if node has valid reg property */
+	auto regIt = node.findRegisterProperty("reg");
+	if (regIt.first == regIt.second)
+		return lib::pair(nullptr, 0);
+
+	/* Save range */
+	auto reg = *regIt.first;
+	void *configAddr = reg.first;
+	size_t configSize = reg.second;
+
+	/* Range fixup */
+	auto parent = node.getParent();
+	if (parent.isValid()) {
+		auto range = parent.findRangeProperty("ranges");
+		for (auto it = range.first; it != range.second; ++it) {
+			auto parentRange = *it;
+			auto childAddr = lib::get<0>(parentRange);
+			auto parentAddr = lib::get<1>(parentRange);
+			auto childSize = lib::get<2>(parentRange);
+
+			if (reinterpret_cast<uintptr_t>(configAddr) >= reinterpret_cast<uintptr_t>(childAddr) &&
+			   reinterpret_cast<uintptr_t>(configAddr) < reinterpret_cast<uintptr_t>(childAddr) + childSize){
+
+				auto offset = reinterpret_cast<uintptr_t>(configAddr) - reinterpret_cast<uintptr_t>(childAddr);
+				configAddr = reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(parentAddr) + offset);
+			}
+		}
+	}
+
+	return lib::pair(configAddr, configSize);
+}
+
+Node Parser::findInterruptParent(const Node& node) const {
+	/* Property is inherited from ancestors */
+	lib::pair<uint32_t, uint32_t> phandle(0, 0);
+	for (auto cur = node; cur.isValid() && phandle.second == 0; cur = cur.getParent())
+		phandle = cur.findIntegerProperty("interrupt-parent");
+
+	if (phandle.second == 0)
+		return Node();
 
+	for (auto other : *this) {
+		if (!other.isValid())
+			continue;
+
+		auto prop = other.findIntegerProperty("phandle");
+		if (prop.second != 0 && prop.first == phandle.first)
+			return other;
+	}
+
+	return Node();
+}
+
+driver::config Parser::findConfig(const driver::generic_driver& driver) const {
 	for (auto nodeIt = begin(); nodeIt != end(); ++nodeIt) {
 		auto node = *nodeIt;
 		if (!node.isValid())
@@ -62,42 +114,20 @@ driver::config Parser::findConfig(const driver::generic_driver& driver) const {
 		if (compatible.first == nullptr || compatible.second == 0)
 			continue;
 
-		/* Check if node is compatible with driver */
-		if (strcmp(name, compatible.first) != 0)
+		/* Check if node is compatible with driver (any entry of stringlist) */
+		bool found = false;
+		for (size_t off = 0; off < compatible.second && !found; off += strlen(&compatible.first[off]) + 1)
+			found = driver.isCompatible(&compatible.first[off]);
+
+		if (!found)
 			continue;
 
 		/******************************
 		 * Step 1: Check reg property *
 		 ******************************/
 
-		/* Check if node has valid reg property */
-		auto regIt = node.findRegisterProperty("reg");
-		if (regIt.first == regIt.second)
-			continue;
-
-		/* Save range */
-		auto reg = *regIt.first;
-		void *configAddr = reg.first;
-		size_t configSize = reg.second;
-
-		/* Range fixup */
-		auto parent = node.getParent();
-		if (parent.isValid()) {
-			auto range = parent.findRangeProperty("ranges");
-			for (auto it = range.first; it != range.second; ++it) {
-				auto parentRange = *it;
-				auto childAddr = lib::get<0>(parentRange);
-				auto parentAddr = lib::get<1>(parentRange);
-				auto childSize = lib::get<2>(parentRange);
-
-				if (reinterpret_cast<uintptr_t>(configAddr) >= reinterpret_cast<uintptr_t>(childAddr) &&
-				   reinterpret_cast<uintptr_t>(configAddr) < reinterpret_cast<uintptr_t>(childAddr) + childSize){
-
-					auto offset = reinterpret_cast<uintptr_t>(configAddr) - reinterpret_cast<uintptr_t>(childAddr);
-					configAddr = reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(parentAddr) + offset);
-				}
-			}
-		}
+		/* Range stays empty for devices accessed by system registers (e.g. architected timer) */
+		auto reg = findRegister(node);
 
 		/*************************************
 		 * Step 2: Check interrupts property *
@@ -113,14 +143,21 @@ driver::config Parser::findConfig(const driver::generic_driver& driver) const {
 			intSize = data.second;
 		}
 
+		/* Check for interrupt parent */
+		lib::pair<void*, size_t> intParent(nullptr, 0);
+		auto parentNode = findInterruptParent(node);
+		if (parentNode.isValid())
+			intParent = findRegister(parentNode);
+
 		/****************************
 		 * Finally: Generate config *
 		 ****************************/
 
 		/* Prepare config */
 		driver::config ret;
-		ret.setRange(configAddr, configSize);
+		ret.setRange(reg.first, reg.second);
 		ret.setInterruptRange(intAddr, intSize);
+		ret.setInterruptParent(intParent.first, intParent.second);
 
 		return ret;
 	}
@@ -137,19 +174,37 @@ lib::pair<void*, size_t> Parser::getConfigSpace() const {
 	return lib::pair(start, size);
 }
 
+lib::pair<void*, size_t> Parser::getReservedMemory(size_t idx) const {
+	auto hdr = reinterpret_cast<FDTHeader*>(ptr);
+
+	auto offRsvmap = util::bigEndianToHost(hdr->off_mem_rsvmap);
+	auto entries = reinterpret_cast<FDTResEnt*>(reinterpret_cast<uintptr_t>(hdr) + offRsvmap);
+
+	/* Memory reservation block is terminated by an entry with zero address and size */
+	for (size_t i = 0; i <= idx; i++) {
+		auto address = util::bigEndianToHost(entries[i].address);
+		auto size = util::bigEndianToHost(entries[i].size);
+		if (address == 0 && size == 0)
+			return lib::pair(nullptr, 0);
+
+		if (i == idx)
+			return lib::pair(reinterpret_cast<void*>(address), static_cast<size_t>(size));
+	}
+
+	return lib::pair(nullptr, 0);
+}
+
 int Parser::createMapping() const {
 	mm::Paging paging;
 
 	auto mapStart = math::roundDown(reinterpret_cast<uintptr_t>(ptr), PAGESIZE);
-	auto mapSize = math::roundUp(size, PAGESIZE);
+	auto mapSize = math::roundUp(reinterpret_cast<uintptr_t>(ptr) + size, PAGESIZE) - mapStart;
 
-	for (auto addr = mapStart; addr < mapStart + mapSize; addr += PAGESIZE) {
-		auto ret = paging.earlyMap(reinterpret_cast<void*>(addr), reinterpret_cast<void*>(addr),
-				mm::Paging::KERNEL_MAPPING, mm::Paging::WRITABLE, mm::Paging::DEVICE_ATTR);
+	auto ret = paging.earlyMapRange(reinterpret_cast<void*>(mapStart), reinterpret_cast<void*>(mapStart), mapSize,
+			mm::Paging::KERNEL_MAPPING, mm::Paging::WRITABLE, mm::Paging::DEVICE_ATTR);
 
-		if (isError(ret))
-			return castError<int, decltype(ret)>(ret);
-	}
+	if (isError(ret))
+		return castError<int, decltype(ret)>(ret);
 
 	for (auto node : *this) {
 		if (!node.isValid())
@@ -159,15 +214,13 @@ int Parser::createMapping() const {
 		for (auto rangeIt = rangeProp.first; rangeIt != rangeProp.second; ++rangeIt) {
 			auto range = *rangeIt;
 			auto mapAddr = math::roundDown(reinterpret_cast<uintptr_t>(lib::get<1>(range)), PAGESIZE);
-			auto mapSize = math::roundUp(lib::get<2>(range), PAGESIZE);
+			auto mapSize = math::roundUp(reinterpret_cast<uintptr_t>(lib::get<1>(range)) + lib::get<2>(range), PAGESIZE) - mapAddr;
 
-			for (uintptr_t addr = mapAddr; addr < mapAddr + mapSize; addr += PAGESIZE) {
-				auto ret = paging.earlyMap(reinterpret_cast<void*>(addr), reinterpret_cast<void*>(addr),
-						mm::Paging::KERNEL_MAPPING, mm::Paging::WRITABLE, mm::Paging::DEVICE_ATTR);
+			ret = paging.earlyMapRange(reinterpret_cast<void*>(mapAddr), reinterpret_cast<void*>(mapAddr), mapSize,
+					mm::Paging::KERNEL_MAPPING, mm::Paging::WRITABLE, mm::Paging::DEVICE_ATTR);
 
-				if (isError(ret))
-					return castError<int, decltype(ret)>(ret);
-			}
+			if (isError(ret))
+				return castError<int, decltype(ret)>(ret);
 		}
 	}
 
@@ -4,9 +4,11 @@
 #include <hw/register/esr.h>
 #include <kernel/error.h>
 #include <kernel/debug/panic.h>
+#include <kernel/lock/rcu.h>
 #include <kernel/lock/softirq.h>
 #include <kernel/irq/sync_handler.h>
 #include <kernel/irq/exception_handler.h>
+#include <kernel/thread/scheduler.h>
 
 extern "C" {
 
@@ -67,6 +69,9 @@ extern "C" {
 		const char* description = esr.getECString();
 		(void) description;
 
+		/* Idle CPU (with stopped tick) might be in extended quiescent state */
+		lock::rcu.irqEnter();
+
 		/* Implement me correctly */
 		auto driver = driver::intc.getHandler();
 		if (isError(driver))
@@ -75,6 +80,11 @@ extern "C" {
 		auto err = lock::softirq.execute(driver, saved_state);
 		if (isError(err))
 			debug::panic::generateFromIRQ("current_el_sp_elx_irq: Error during softirq!", saved_state);
+
+		lock::rcu.irqExit();
+
+		/* Reschedule (if requested and kernel code may be preempted) */
+		thread::scheduler.preempt(false);
 	}
 
 	void current_el_sp_elx_fiq(irq::ExceptionContext* saved_state) {
@@ -100,6 +110,9 @@ extern "C" {
 	void lower_el_aarch64_sync(irq::ExceptionContext* saved_state) {
 		(void) saved_state;
 
+		/* User mode holds no references to RCU protected data */
+		lock::rcu.quiescentState();
+
 		hw::reg::ESR esr;
 		const char* description = esr.getECString();
 
@@ -122,11 +135,17 @@ extern "C" {
 		auto err = lock::softirq.execute(driver, saved_state);
 		if (isError(err))
 			debug::panic::generateFromIRQ("lower_el_aarch64_sync: Error during softirq!", saved_state);
+
+		/* Reschedule (if requested) before returning to user mode */
+		thread::scheduler.preempt(true);
 	}
 
 	void lower_el_aarch64_irq(irq::ExceptionContext* saved_state) {
 		(void) saved_state;
 
+		/* User mode holds no references to RCU protected data */
+		lock::rcu.quiescentState();
+
 		hw::reg::ESR esr;
 		const char* description = esr.getECString();
 		(void) description;
@@ -138,6 +157,9 @@ extern "C" {
 		auto err = lock::softirq.execute(driver, saved_state);
 		if (isError(err))
 			debug::panic::generateFromIRQ("current_el_sp_elx_irq: Error during softirq!", saved_state);
+
+		/* Reschedule (if requested) before returning to user mode */
+		thread::scheduler.preempt(true);
 	}
 
 	void lower_el_aarch64_fiq(irq::ExceptionContext* saved_state) {
@@ -7,6 +7,7 @@
 #include <kernel/debug/panic.h>
 #include <kernel/irq/pagefault.h>
 #include <kernel/irq/exception_handler.h>
+#include <kernel/mm/address_space.h>
 
 using namespace irq;
 
@@ -15,6 +16,21 @@ PagefaultHandler::PagefaultHandler() {
 	num_ecs = 4;
 }
 
+bool PagefaultHandler::resolve(Actor actor, Operation operation) {
+	auto addressSpace = mm::AddressSpace::getActive();
+	if (addressSpace == nullptr)
+		return false;
+
+	auto access = mm::AddressSpace::Access::READ;
+	if (operation == Operation::WRITE)
+		access = mm::AddressSpace::Access::WRITE;
+	else if (operation == Operation::EXECUTE)
+		access = mm::AddressSpace::Access::EXECUTE;
+
+	hw::reg::FAR far;
+	return addressSpace->handleFault(far.getValue(), access, actor == Actor::USER) == 0;
+}
+
 void PagefaultHandler::panic(Actor actor, Operation operation, Cause cause, irq::ExceptionContext* context) {
 	lib::panic panic;
 	panic << "PANIC: ";
@@ -125,6 +141,10 @@ int PagefaultHandler::prologue_data_abort_elc(irq::ExceptionContext* context) {
 		cause = Cause::PERMISSION;
 	}
 
+	/* Populate demand-paged memory and retry */
+	if (cause == Cause::NON_PRESENT && resolve(actor, operation))
+		return 0;
+
 	/* PANIC */
 	panic(actor, operation, cause, context);
 	return -EINVAL;
@@ -205,6 +225,10 @@ int PagefaultHandler::prologue_instr_abort_elc(irq::ExceptionContext* context) {
 		cause = Cause::PERMISSION;
 	}
 
+	/* Populate demand-paged memory and retry */
+	if (cause == Cause::NON_PRESENT && resolve(actor, operation))
+		return 0;
+
 	/* PANIC */
 	panic(actor, operation, cause, context);
 	return -EINVAL;
@@ -1,20 +1,39 @@
 #include <cerrno.h>
 #include <cassert.h>
 #include <hw/register/esr.h>
+#include <kernel/lock/rcu.h>
+#include <kernel/lock/guard.h>
 #include <kernel/irq/sync_handler.h>
 
 using namespace irq;
 
 int SyncHandler::registerHandler(GenericSyncHandler* handler) {
+	lock::lock_guard guard(lock);
+
 	/* Check if all slots are unused */
 	for (auto it = handler->beginEC(); it != handler->endEC(); ++it) {
 		if (handlers[*it] != nullptr)
 			return -EINVAL;
 	}
 
-	/* Update slots */
+	/* Update slots (handler is completely initialized) */
+	for (auto it = handler->beginEC(); it != handler->endEC(); ++it)
+		lock::RCU::assign(handlers[*it], handler);
+
+	return 0;
+}
+
+int SyncHandler::unregisterHandler(GenericSyncHandler* handler) {
+	lock::lock_guard guard(lock);
+
+	/* Check if all slots are used by handler */
+	for (auto it = handler->beginEC(); it != handler->endEC(); ++it) {
+		if (handlers[*it] != handler)
+			return -EINVAL;
+	}
+
 	for (auto it = handler->beginEC(); it != handler->endEC(); ++it)
-		handlers[*it] = handler;
+		lock::RCU::assign(handlers[*it], static_cast<GenericSyncHandler*>(nullptr));
 
 	return 0;
 }
@@ -23,5 +42,5 @@ driver::generic_driver* SyncHandler::getHandler() {
 	hw::reg::ESR esr;
 	auto idx = esr.getEC();
 	assert(idx < NUM_HANDLERS);
-	return handlers[idx];
+	return lock::RCU::dereference(handlers[idx]);
 }
@@ -4,6 +4,7 @@
 #include <kernel/error.h>
 #include <kernel/debug/panic.h>
 #include <kernel/syscall/write.h>
+#include <kernel/syscall/sched.h>
 #include <kernel/irq/syscall.h>
 #include <kernel/irq/exception_handler.h>
 
@@ -17,6 +18,16 @@ SyscallHandler::SyscallHandler() {
 	/* Register handlers */
 	memset(&handlers, 0, sizeof(void*) * NUM_HANDLERS);
 	handlers[SYS_WRITE] = syscall::__write;
+	handlers[SYS_SCHED_YIELD] = syscall::__sched_yield;
+	handlers[SYS_NANOSLEEP] = syscall::__nanosleep;
+	handlers[SYS_CLONE] = syscall::__clone;
+	handlers[SYS_EXIT] = syscall::__exit;
+	handlers[SYS_GETPRIORITY] = syscall::__getpriority;
+	handlers[SYS_SETPRIORITY] = syscall::__setpriority;
+	handlers[SYS_SCHED_SETSCHEDULER] = syscall::__sched_setscheduler;
+	handlers[SYS_SCHED_GETSCHEDULER] = syscall::__sched_getscheduler;
+	handlers[SYS_SCHED_STATS] = syscall::__sched_stats;
+	handlers[SYS_SCHED_WAKEUP_LATENCY] = syscall::__sched_wakeup_latency;
 }
 
 int SyscallHandler::prologue(irq::ExceptionContext* context) {
@@ -24,7 +35,7 @@ int SyscallHandler::prologue(irq::ExceptionContext* context) {
 	auto num = reinterpret_cast<size_t>(context->x8);
 
 	/* Check for suitable handler */
-	if (handlers[num] == nullptr)
+	if (num >= NUM_HANDLERS || handlers[num] == nullptr)
 		return -EINVAL;
 
 	/* Save context for prologue */
@@ -0,0 +1,102 @@
+#include <ios.h>
+#include <ostream.h>
+#include <kernel/cpu.h>
+#include <kernel/lock/spinlock.h>
+#include <kernel/lock/benchmark.h>
+#include <driver/cpu.h>
+
+using namespace lock;
+
+/* Reference lock (spinning with test-and-set) */
+struct TestAndSetLock {
+	lib::atomic_flag flag;
+
+	TestAndSetLock() {
+		flag.flag = false;
+	}
+
+	void lock() {
+		while (flag.test_and_set());
+	}
+
+	void unlock() {
+		flag.clear();
+	}
+};
+
+/* Benchmarked locks */
+static TestAndSetLock tasLock;
+static spinlock ticketLock;
+
+Benchmark::Benchmark() : arrived(0), phase(0), stop(0), shared(0) {}
+
+void Benchmark::barrier() {
+	auto current = phase.load();
+
+	if (arrived.fetch_add(1) + 1 == driver::cpus.numCPUs()) {
+		arrived.store(0);
+		phase.fetch_add(1);
+		return;
+	}
+
+	while (phase.load() == current);
+}
+
+template<typename Lock>
+void Benchmark::measure(Lock& lock, const char* name, size_t participants) {
+	auto cpuID = CPU::getProcessorID();
+	auto& counter = counters.get().value;
+
+	counter = 0;
+	if (cpuID == 0) {
+		shared = 0;
+		stop.store(0);
+	}
+	barrier();
+
+	/* First CPU measures time and stops run */
+	auto ticks = CPU::getSystemCounterFrequency() / 1000 * DURATION_MS;
+	auto start = CPU::getSystemCounter();
+	if (cpuID < participants) {
+		while (stop.load(lib::memory_order_relaxed) == 0) {
+			lock.lock();
+			shared++;
+			lock.unlock();
+			counter++;
+
+			if (cpuID == 0 && counter % 64 == 0 && CPU::getSystemCounter() - start >= ticks)
+				stop.store(1);
+		}
+	}
+	barrier();
+
+	/* Report results (before counters are reset by next run) */
+	if (cpuID == 0)
+		report(name, participants);
+	barrier();
+}
+
+void Benchmark::report(const char* name, size_t participants) {
+	size_t total = 0;
+	size_t min = static_cast<size_t>(-1);
+	size_t max = 0;
+	for (size_t i = 0; i < participants; i++) {
+		auto value = counters.get(i).value;
+		total += value;
+		min = value < min ? value : min;
+		max = value > max ? value : max;
+	}
+
+	lib::ostream cout;
+	cout << "Lock Benchmark: " << name << " with " << participants << " CPUs: ";
+	cout << total / DURATION_MS << " acquisitions/ms, ";
+	cout << "min/max per CPU: " << min << "/" << max;
+	cout << (shared == total ? "" : " (lost updates!)") << lib::endl;
+}
+
+void Benchmark::run() {
+	for (size_t participants = 1; participants <= driver::cpus.numCPUs(); participants++) {
+		measure(tasLock, "test-and-set", participants);
+		measure(ticketLock, "ticket spinlock", participants);
+	}
+}
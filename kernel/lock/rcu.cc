@@ -0,0 +1,160 @@
+#include <cassert.h>
+#include <functional.h>
+#include <kernel/cpu.h>
+#include <kernel/config.h>
+#include <kernel/lock/rcu.h>
+#include <kernel/lock/guard.h>
+#include <driver/drivers.h>
+
+using namespace lock;
+
+RCU::RCU() : epoch(0) {
+	for (size_t i = 0; i < MAX_NUM_CPUS; i++) {
+		auto& state = states.get(i);
+		state.observed.store(BOOTING);
+		state.nesting = 0;
+		state.next = nullptr;
+		state.nextTail = &state.next;
+		state.wait = nullptr;
+		state.waitEpoch = 0;
+		state.irqNesting = 0;
+		state.idleIrq = false;
+	}
+}
+
+int RCU::init() {
+	auto tick = []() -> int {
+		return rcu.tick();
+	};
+
+	/* Timer wheel of each CPU ticks RCU */
+	int id = driver::timer.registerFunction(driver::timer.interval(), lib::function<int()>(tick));
+	return id < 0 ? id : 0;
+}
+
+void RCU::readLock() {
+	states.get().nesting++;
+}
+
+void RCU::readUnlock() {
+	assert(states.get().nesting > 0);
+	states.get().nesting--;
+}
+
+void RCU::publish(CPUState& state) {
+	bool idle = (state.observed.load(lib::memory_order_relaxed) == IDLE);
+
+	/* Earlier reads of RCU protected data must be completed before publishing */
+	state.observed.store(epoch.load(lib::memory_order_acquire), lib::memory_order_release);
+
+	/* Later reads must not be performed before grace periods see this CPU again */
+	if (idle)
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void RCU::quiescentState() {
+	auto& state = states.get();
+	assert(state.nesting == 0);
+
+	publish(state);
+}
+
+void RCU::enterIdle() {
+	auto& state = states.get();
+	assert(state.nesting == 0);
+
+	state.observed.store(IDLE, lib::memory_order_release);
+}
+
+void RCU::irqEnter() {
+	auto& state = states.get();
+	if (state.irqNesting++ > 0 || state.observed.load(lib::memory_order_relaxed) != IDLE)
+		return;
+
+	state.idleIrq = true;
+	publish(state);
+}
+
+void RCU::irqExit() {
+	auto& state = states.get();
+	assert(state.irqNesting > 0);
+	if (--state.irqNesting > 0 || !state.idleIrq)
+		return;
+
+	state.idleIrq = false;
+	enterIdle();
+}
+
+bool RCU::needsTick() {
+	irqsave irq;
+	auto& state = states.get();
+	return state.next != nullptr || state.wait != nullptr;
+}
+
+uint64_t RCU::startGracePeriod() {
+	return epoch.fetch_add(1) + 1;
+}
+
+bool RCU::isCompleted(uint64_t gracePeriod) const {
+	for (size_t i = 0; i < MAX_NUM_CPUS; i++) {
+		auto observed = states.get(i).observed.load(lib::memory_order_acquire);
+		if (observed != BOOTING && observed != IDLE && observed < gracePeriod)
+			return false;
+	}
+
+	return true;
+}
+
+void RCU::call(rcu_head* head, void (*func)(rcu_head* head)) {
+	head->next = nullptr;
+	head->func = func;
+
+	/* Batch is also used by timer tick of this CPU */
+	irqsave irq;
+
+	auto& state = states.get();
+	*state.nextTail = head;
+	state.nextTail = &head->next;
+}
+
+void RCU::synchronize() {
+	auto gracePeriod = startGracePeriod();
+
+	/* Current CPU doesn't hold any references */
+	quiescentState();
+
+	/* Other CPUs pass quiescent states on their own (at least once per tick) */
+	while (!isCompleted(gracePeriod));
+}
+
+int RCU::tick() {
+	rcu_head* done = nullptr;
+
+	{
+		irqsave irq;
+		auto& state = states.get();
+
+		/* Take batch of completed grace period */
+		if (state.wait != nullptr && isCompleted(state.waitEpoch)) {
+			done = state.wait;
+			state.wait = nullptr;
+		}
+
+		/* Hand over next batch to new grace period */
+		if (state.wait == nullptr && state.next != nullptr) {
+			state.wait = state.next;
+			state.next = nullptr;
+			state.nextTail = &state.next;
+			state.waitEpoch = startGracePeriod();
+		}
+	}
+
+	/* Release objects (with enabled interrupts) */
+	while (done != nullptr) {
+		auto next = done->next;
+		done->func(done);
+		done = next;
+	}
+
+	return 0;
+}
@@ -0,0 +1,44 @@
+#include <kernel/lock/rwlock.h>
+
+using namespace lock;
+
+rwlock::rwlock() : state(0) {}
+
+void rwlock::lock() {
+	/* Claim writer bit (keeps new readers out) */
+	auto current = state.load(lib::memory_order_relaxed);
+	while (true) {
+		if ((current & WRITER) != 0) {
+			current = state.load(lib::memory_order_relaxed);
+			continue;
+		}
+
+		if (state.compare_exchange_weak(current, current | WRITER, lib::memory_order_acquire, lib::memory_order_relaxed))
+			break;
+	}
+
+	/* Wait for active readers */
+	while (state.load(lib::memory_order_acquire) != WRITER);
+}
+
+void rwlock::unlock() {
+	/* Readers can't enter while writer bit is set */
+	state.store(0, lib::memory_order_release);
+}
+
+void rwlock::lockShared() {
+	auto current = state.load(lib::memory_order_relaxed);
+	while (true) {
+		if ((current & WRITER) != 0) {
+			current = state.load(lib::memory_order_relaxed);
+			continue;
+		}
+
+		if (state.compare_exchange_weak(current, current + 1, lib::memory_order_acquire, lib::memory_order_relaxed))
+			break;
+	}
+}
+
+void rwlock::unlockShared() {
+	state.fetch_sub(1, lib::memory_order_release);
+}
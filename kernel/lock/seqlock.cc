@@ -0,0 +1,34 @@
+#include <kernel/lock/seqlock.h>
+
+using namespace lock;
+
+seqlock::seqlock() : sequence(0) {}
+
+void seqlock::lock() {
+	writer.lock();
+
+	/* Mark write as active before modifying data */
+	sequence.store(sequence.load(lib::memory_order_relaxed) + 1, lib::memory_order_relaxed);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void seqlock::unlock() {
+	/* Publish modified data before marking write as finished */
+	sequence.store(sequence.load(lib::memory_order_relaxed) + 1, lib::memory_order_release);
+
+	writer.unlock();
+}
+
+uint32_t seqlock::readBegin() const {
+	uint32_t start;
+	while ((start = sequence.load(lib::memory_order_acquire)) & 1);
+
+	return start;
+}
+
+bool seqlock::readRetry(uint32_t start) const {
+	/* Complete reads of data before checking sequence again */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	return sequence.load(lib::memory_order_relaxed) != start;
+}
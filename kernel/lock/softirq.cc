@@ -5,6 +5,7 @@
 #include <kernel/cpu.h>
 #include <kernel/error.h>
 #include <kernel/lock/softirq.h>
+#include <kernel/debug/panic.h>
 #include <driver/cpu.h>
 #include <driver/drivers.h>
 #include <driver/generic_driver.h>
@@ -43,8 +44,11 @@ int Softirq::execute(driver::generic_driver* driver, irq::ExceptionContext* cont
 	/* Mark softirq layer as used (if possible) */
 	auto currentlyUsed = used.get().test_and_set();
 
-	/* If currently an epilogue is executed postpone driver (if necessary) */
-	if (currentlyUsed && retPrologue == 1) {
+	/* If currently an epilogue is executed (or epilogues are disabled) postpone driver (if necessary) */
+	if (currentlyUsed) {
+		if (retPrologue != 1)
+			return 0;
+
 		/* Check if driver is already pending */
 		auto alreadyPending = (drivers[cpuID * numDrivers + driverID] != nullptr);
 		/* Update driver */
@@ -67,6 +71,20 @@ int Softirq::execute(driver::generic_driver* driver, irq::ExceptionContext* cont
 	}
 
 	/* Execute postponed drivers */
+	auto retPending = executePending(cpuID);
+	if (isError(retPending)) {
+		/* Mark softirq as unused */
+		used.get().clear();
+		return retPending;
+	}
+
+	/* Mark softirq layer as unused */
+	used.get().clear();
+
+	return 0;
+}
+
+int Softirq::executePending(size_t cpuID) {
 	while (pendingDrivers.get() > 0) {
 		for (size_t i = 0; i < numDrivers; i++) {
 			driver::generic_driver* postponedDriver = nullptr;
@@ -81,18 +99,37 @@ int Softirq::execute(driver::generic_driver* driver, irq::ExceptionContext* cont
 				CPU::disableInterrupts();
 
 				/* Check for error condition */
-				if (isError(retEpilogue)) {
-					/* Mark softirq as unused */
-					used.get().clear();
+				if (isError(retEpilogue))
 					return retEpilogue;
-				}
 			}
 		}
 	}
 
+	return 0;
+}
+
+bool Softirq::disable() {
+	return used.get().test_and_set();
+}
+
+void Softirq::enable(bool wasDisabled) {
+	if (wasDisabled)
+		return;
+
+	/* Run postponed epilogues only if interrupts may be enabled */
+	if (CPU::areInterruptsEnabled()) {
+		CPU::disableInterrupts();
+		if (isError(executePending(CPU::getProcessorID())))
+			debug::panic::generate("Softirq: Error during postponed epilogue");
+		used.get().clear();
+		CPU::enableInterrupts();
+		return;
+	}
 
-	/* Mark softirq layer as unused */
 	used.get().clear();
+}
 
-	return 0;
+bool Softirq::isDisabled() {
+	/* Flag is only written by current CPU */
+	return __atomic_load_n(&used.get().flag, __ATOMIC_RELAXED);
 }
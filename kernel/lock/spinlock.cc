@@ -2,18 +2,50 @@
 
 using namespace lock;
 
+/* Next ticket is kept in upper half of tickets */
+static const uint32_t TICKET_SHIFT = 16;
+
 spinlock::spinlock() {
-	lock_flag.flag = false;
+	tickets = 0;
 }
 
 void spinlock::lock() {
-	while(lock_flag.test_and_set());
+	/* Take next ticket */
+	uint32_t old = __atomic_fetch_add(&tickets, static_cast<uint32_t>(1) << TICKET_SHIFT, __ATOMIC_ACQUIRE);
+	uint32_t ticket = old >> TICKET_SHIFT;
+	if ((old & 0xFFFF) == ticket)
+		return;
+
+	/* Wait for turn (the owner halfword is placed at the lower address) */
+	uint32_t owner, tmp;
+	asm volatile(
+		"sevl\n\t"
+		"1:\n\t"
+		"wfe\n\t"
+		"ldaxrh %w[owner], %[lock]\n\t"
+		"eor %w[tmp], %w[owner], %w[ticket]\n\t"
+		"cbnz %w[tmp], 1b\n\t"
+		: [owner] "=&r"(owner), [tmp] "=&r"(tmp)
+		: [lock] "Q"(tickets), [ticket] "r"(ticket)
+		: "memory"
+	);
 }
 
 bool spinlock::tryLock() {
-	return !lock_flag.test_and_set();
+	uint32_t old = __atomic_load_n(&tickets, __ATOMIC_RELAXED);
+	if ((old & 0xFFFF) != (old >> TICKET_SHIFT))
+		return false;
+
+	return __atomic_compare_exchange_n(&tickets, &old, old + (static_cast<uint32_t>(1) << TICKET_SHIFT), false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
 }
 
 void spinlock::unlock() {
-	lock_flag.clear();
+	/* Only the owner updates its halfword -> No atomic read-modify-write needed */
+	uint32_t owner = (__atomic_load_n(&tickets, __ATOMIC_RELAXED) + 1) & 0xFFFF;
+	asm volatile(
+		"stlrh %w[owner], %[lock]\n\t"
+		: [lock] "+Q"(tickets)
+		: [owner] "r"(owner)
+		: "memory"
+	);
 }
@@ -0,0 +1,70 @@
+#include <cerrno.h>
+#include <kernel/cpu.h>
+#include <kernel/lock/statistics.h>
+#include <hw/register/daif.h>
+
+using namespace lock;
+
+LockStatistics::LockStatistics() : ticksPerUS(0) {
+	for (size_t i = 0; i < MAX_NUM_CPUS; i++) {
+		auto& value = values.get(i);
+		value.maxHold = 0;
+		value.maxIrqOff = 0;
+		value.longHolds = 0;
+		value.longIrqOffs = 0;
+	}
+}
+
+int LockStatistics::init() {
+	ticksPerUS = CPU::getSystemCounterFrequency() / 1000000;
+	if (ticksPerUS == 0)
+		return -EINVAL;
+
+	return 0;
+}
+
+void LockStatistics::recordHold(uint64_t ticks) {
+	if (ticksPerUS == 0)
+		return;
+
+	/* Guards can't be used here (as they would record themselves) */
+	hw::reg::DAIF saved;
+	CPU::disableInterrupts();
+
+	auto& value = values.get();
+	if (ticks > value.maxHold)
+		value.maxHold = ticks;
+	if (ticks > HOLD_LIMIT_US * ticksPerUS)
+		value.longHolds++;
+
+	saved.restore();
+}
+
+void LockStatistics::recordIrqOff(uint64_t ticks) {
+	if (ticksPerUS == 0)
+		return;
+
+	hw::reg::DAIF saved;
+	CPU::disableInterrupts();
+
+	auto& value = values.get();
+	if (ticks > value.maxIrqOff)
+		value.maxIrqOff = ticks;
+	if (ticks > IRQ_OFF_LIMIT_US * ticksPerUS)
+		value.longIrqOffs++;
+
+	saved.restore();
+}
+
+LockStatistics::Statistics LockStatistics::get(size_t cpuID) const {
+	Statistics stats = {0, 0, 0, 0};
+	if (ticksPerUS == 0)
+		return stats;
+
+	auto& value = values.get(cpuID);
+	stats.maxHoldUS = value.maxHold / ticksPerUS;
+	stats.maxIrqOffUS = value.maxIrqOff / ticksPerUS;
+	stats.longHolds = value.longHolds;
+	stats.longIrqOffs = value.longIrqOffs;
+	return stats;
+}
@@ -0,0 +1,176 @@
+#include <cerrno.h>
+#include <cstring.h>
+#include <kernel/cpu.h>
+#include <kernel/error.h>
+#include <kernel/math.h>
+#include <kernel/cpu_local.h>
+#include <kernel/lock/guard.h>
+#include <kernel/mm/paging.h>
+#include <kernel/mm/address_space.h>
+#include <kernel/mm/asid_allocator.h>
+#include <kernel/mm/frame_allocator.h>
+
+using namespace mm;
+
+/* Nodes of all area trees */
+static ObjectCache<AddressSpace::AreaTree::RBNode> areaCache("AddressSpace::Area");
+
+/* Address space active on each CPU */
+static cpu_local<AddressSpace*> activeSpaces(nullptr);
+
+AddressSpace::AddressSpace() : tables(nullptr), context(0) {}
+
+AddressSpace::~AddressSpace() {
+	if (tables == nullptr)
+		return;
+
+	/* Release all areas */
+	while (!areas.empty()) {
+		auto node = areas.first();
+		areas.remove(node);
+		releaseArea(node->t);
+		areaCache.destroy(node);
+	}
+
+	asidAlloc.release(context);
+	Paging::destroyUserTables(tables);
+}
+
+void* AddressSpace::getTablesFor(uintptr_t vaddr) const {
+	return vaddr < Paging::USER_SPACE_START ? nullptr : tables;
+}
+
+void AddressSpace::releaseArea(const Area& area) {
+	for (auto vaddr = area.start; vaddr < area.end; vaddr += PAGESIZE) {
+		auto tables = getTablesFor(vaddr);
+		Paging paging = tables ? Paging(tables, &cpus) : Paging();
+
+		/* Skip pages, which were never populated */
+		void* frame = paging.unmap(reinterpret_cast<void*>(vaddr));
+		if (isError(frame))
+			continue;
+
+		frameAlloc.free(frame);
+	}
+}
+
+int AddressSpace::init() {
+	if (tables != nullptr)
+		return -EINVAL;
+
+	tables = Paging::createUserTables();
+	if (tables == nullptr)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void* AddressSpace::getTables() const {
+	return tables;
+}
+
+int AddressSpace::addArea(void* start, size_t size, Paging::priv_lvl_t priv, Paging::prot_t prot) {
+	auto first = reinterpret_cast<uintptr_t>(start);
+	auto last = first + size;
+	if (first % PAGESIZE != 0 || size % PAGESIZE != 0 || size == 0 || last <= first)
+		return -EINVAL;
+
+	/* Areas must not cross the boundary between kernel mapping and user address space */
+	if (first < Paging::USER_SPACE_START && last > Paging::USER_SPACE_START)
+		return -EINVAL;
+	if (last > Paging::USER_SPACE_END)
+		return -EINVAL;
+
+	auto node = areaCache.create();
+	if (node == nullptr)
+		return -ENOMEM;
+
+	node->t = Area{first, last, priv, prot};
+
+	{
+		lock::irqsave_guard guard(lock);
+
+		/* Reject overlapping areas */
+		auto prev = areas.floor(Area{last - 1, 0, priv, prot});
+		if (prev == nullptr || prev->t.end <= first) {
+			areas.insert(node);
+			return 0;
+		}
+	}
+
+	areaCache.destroy(node);
+	return -EEXIST;
+}
+
+int AddressSpace::removeArea(void* start) {
+	AreaTree::RBNode* node;
+	{
+		lock::irqsave_guard guard(lock);
+		node = areas.remove(Area{reinterpret_cast<uintptr_t>(start), 0, Paging::USER_MAPPING, Paging::READONLY});
+	}
+
+	if (node == nullptr)
+		return -EINVAL;
+
+	releaseArea(node->t);
+	areaCache.destroy(node);
+	return 0;
+}
+
+int AddressSpace::populate(uintptr_t vaddr, Access access, bool user) {
+	/* Find area containing vaddr */
+	auto node = areas.floor(Area{vaddr, 0, Paging::USER_MAPPING, Paging::READONLY});
+	if (node == nullptr || node->t.end <= vaddr)
+		return -EFAULT;
+
+	/* Check permissions */
+	auto& area = node->t;
+	if (user && area.priv != Paging::USER_MAPPING)
+		return -EACCES;
+	if (access == Access::WRITE && area.prot != Paging::WRITABLE)
+		return -EACCES;
+	if (access == Access::EXECUTE && area.prot != Paging::EXECUTABLE)
+		return -EACCES;
+
+	/* Page was already populated (e.g. by concurrent fault of other CPU) */
+	if (Paging::isReadableKernel(reinterpret_cast<void*>(vaddr)))
+		return 0;
+
+	/* Populate with zeroed page frame */
+	void* frame = frameAlloc.alloc();
+	if (frame == nullptr)
+		return -ENOMEM;
+	memset(frame, 0, PAGESIZE);
+
+	auto tables = getTablesFor(vaddr);
+	Paging paging = tables ? Paging(tables, &cpus) : Paging();
+	int err = paging.map(reinterpret_cast<void*>(vaddr), frame, area.priv, area.prot, Paging::DEFAULT_ATTR);
+	if (err < 0)
+		frameAlloc.free(frame);
+
+	return err;
+}
+
+int AddressSpace::handleFault(void* vaddr, Access access, bool user) {
+	lock::irqsave_guard guard(lock);
+	return populate(math::roundDown(reinterpret_cast<uintptr_t>(vaddr), PAGESIZE), access, user);
+}
+
+void AddressSpace::activate() {
+	lock::irqsave irq;
+
+	cpus.set(CPU::getProcessorID());
+	asidAlloc.activate(tables, context);
+	activeSpaces.get() = this;
+}
+
+void AddressSpace::activateKernel() {
+	lock::irqsave irq;
+
+	Paging::loadKernelMapping();
+	activeSpaces.get() = nullptr;
+}
+
+AddressSpace* AddressSpace::getActive() {
+	return activeSpaces.get();
+}
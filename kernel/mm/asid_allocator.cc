@@ -0,0 +1,180 @@
+#include <cerrno.h>
+#include <cstring.h>
+#include <kernel/cpu.h>
+#include <kernel/config.h>
+#include <kernel/lock/guard.h>
+#include <kernel/utility.h>
+#include <kernel/mm/asid_allocator.h>
+
+using namespace mm;
+
+ASIDAllocator::ASIDAllocator() : bits(8), generation(0), next(1), rollovers(0), reserved(0), flushPending(false) {
+	memset(used, 0, sizeof(used));
+}
+
+size_t ASIDAllocator::getASID(uint64_t context) const {
+	return context & ((static_cast<uint64_t>(1) << bits) - 1);
+}
+
+bool ASIDAllocator::isCurrent(uint64_t context) const {
+	return ((context ^ generation.load(lib::memory_order_relaxed)) >> bits) == 0;
+}
+
+void ASIDAllocator::setUsed(size_t asid) {
+	used[asid / 64] |= static_cast<uint64_t>(1) << (asid % 64);
+}
+
+bool ASIDAllocator::isUsed(size_t asid) const {
+	return (used[asid / 64] >> (asid % 64)) & 1;
+}
+
+size_t ASIDAllocator::findFree(size_t start) const {
+	size_t num = static_cast<size_t>(1) << bits;
+
+	for (size_t i = start / 64; i < num / 64; i++) {
+		auto free = ~used[i];
+		if (i == start / 64)
+			free &= ~((static_cast<uint64_t>(1) << (start % 64)) - 1);
+
+		if (free != 0)
+			return i * 64 + util::ffs(free);
+	}
+
+	return 0;
+}
+
+void ASIDAllocator::rollover() {
+	generation.fetch_add(static_cast<uint64_t>(1) << bits, lib::memory_order_relaxed);
+
+	/* Release all ASIDs (except the reserved one of the kernel mapping) */
+	memset(used, 0, sizeof(used));
+	setUsed(0);
+
+	for (size_t cpuID = 0; cpuID < MAX_NUM_CPUS; cpuID++) {
+		/* Keep ASIDs active on any CPU */
+		auto context = active.get(cpuID).exchange(0, lib::memory_order_relaxed);
+
+		/* CPU didn't switch address space since last rollover */
+		if (context == 0)
+			context = reserved.get(cpuID);
+
+		if (context != 0)
+			setUsed(getASID(context));
+
+		reserved.get(cpuID) = context;
+		flushPending.get(cpuID) = true;
+	}
+
+	next = 1;
+	rollovers++;
+}
+
+bool ASIDAllocator::updateReserved(uint64_t context, uint64_t newContext) {
+	bool hit = false;
+
+	for (size_t cpuID = 0; cpuID < MAX_NUM_CPUS; cpuID++) {
+		if (reserved.get(cpuID) == context) {
+			reserved.get(cpuID) = newContext;
+			hit = true;
+		}
+	}
+
+	return hit;
+}
+
+uint64_t ASIDAllocator::newContext(uint64_t context) {
+	auto gen = generation.load(lib::memory_order_relaxed);
+
+	if (context != 0) {
+		auto asid = getASID(context);
+		auto updated = gen | asid;
+
+		/* ASID was active during last rollover */
+		if (updateReserved(context, updated))
+			return updated;
+
+		/* Keep ASID if it is still free */
+		if (!isUsed(asid)) {
+			setUsed(asid);
+			return updated;
+		}
+	}
+
+	/* Allocate new ASID */
+	auto asid = findFree(next);
+	if (asid == 0) {
+		rollover();
+		gen = generation.load(lib::memory_order_relaxed);
+		asid = findFree(next);
+	}
+
+	setUsed(asid);
+	next = asid + 1;
+	return gen | asid;
+}
+
+int ASIDAllocator::init(size_t bits) {
+	if (bits != 8 && bits != 16)
+		return -EINVAL;
+
+	this->bits = bits;
+	generation.store(static_cast<uint64_t>(1) << bits);
+
+	/* ASID 0 is reserved for the kernel mapping */
+	memset(used, 0, sizeof(used));
+	setUsed(0);
+	next = 1;
+
+	for (size_t cpuID = 0; cpuID < MAX_NUM_CPUS; cpuID++)
+		active.get(cpuID).store(0);
+
+	return 0;
+}
+
+void ASIDAllocator::activate(void* tables, lib::atomic<uint64_t>& context) {
+	auto cpuID = CPU::getProcessorID();
+	auto& cpuActive = active.get(cpuID);
+
+	/* Fast path: Context ID of current generation (and no concurrent rollover) */
+	auto ctx = context.load(lib::memory_order_relaxed);
+	auto old = cpuActive.load(lib::memory_order_relaxed);
+	if (old != 0 && isCurrent(ctx) && cpuActive.compare_exchange_strong(old, ctx, lib::memory_order_relaxed)) {
+		CPU::setTranslationTable(tables, getASID(ctx));
+		return;
+	}
+
+	{
+		/* Interrupts are already disabled by caller */
+		lock::lock_guard guard(lock);
+
+		/* Get context ID of current generation */
+		ctx = context.load(lib::memory_order_relaxed);
+		if (!isCurrent(ctx)) {
+			ctx = newContext(ctx);
+			context.store(ctx, lib::memory_order_relaxed);
+		}
+
+		/* Drop entries of released ASIDs after rollover */
+		if (flushPending.get(cpuID)) {
+			flushPending.get(cpuID) = false;
+			CPU::invalidateLocalTLB();
+		}
+
+		cpuActive.store(ctx, lib::memory_order_relaxed);
+	}
+
+	CPU::setTranslationTable(tables, getASID(ctx));
+}
+
+void ASIDAllocator::release(lib::atomic<uint64_t>& context) {
+	/* Lock is also taken with disabled interrupts (see activate) */
+	lock::irqsave_guard guard(lock);
+
+	auto ctx = context.exchange(0, lib::memory_order_relaxed);
+	if (ctx != 0)
+		CPU::invalidateASID(getASID(ctx));
+}
+
+size_t ASIDAllocator::getRollovers() const {
+	return rollovers;
+}
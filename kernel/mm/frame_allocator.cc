@@ -1,61 +1,452 @@
 #include <cerrno.h>
 #include <cstdint.h>
+#include <cstring.h>
+#include <kernel/cpu.h>
+#include <kernel/math.h>
+#include <kernel/linker.h>
+#include <kernel/lock/guard.h>
+#include <kernel/symbols.h>
+#include <kernel/utility.h>
 #include <kernel/mm/frame_allocator.h>
 
 using namespace mm;
 
-FrameAllocator::FrameAllocator() {}
+FrameAllocator::FrameAllocator() : base(0), numFrames(0), frames(nullptr), freeMask(0), freeFrames(0), numRanges(0), magazines(Magazine()) {
+	for (size_t i = 0; i < NUM_ORDERS; i++)
+		freeLists[i] = nullptr;
+}
 
-void FrameAllocator::init() {
-	head = reinterpret_cast<FrameLink*>(&frames);
+size_t FrameAllocator::toIndex(const void* addr) const {
+	return (reinterpret_cast<uintptr_t>(addr) - base) / PAGESIZE;
+}
 
-	for (size_t i = 0; i < NUM_FRAMES - 1; i++) {
-		auto entry = reinterpret_cast<FrameLink*>(&frames[i * PAGESIZE]);
-		entry->next = reinterpret_cast<FrameLink*>(&frames[(i + 1) * PAGESIZE]);
-	}
+void* FrameAllocator::toAddress(size_t idx) const {
+	return reinterpret_cast<void*>(base + idx * PAGESIZE);
+}
+
+void FrameAllocator::pushFree(size_t idx, size_t order) {
+	auto link = reinterpret_cast<FrameLink*>(toAddress(idx));
+	link->prev = nullptr;
+	link->next = freeLists[order];
+	if (link->next != nullptr)
+		link->next->prev = link;
 
-	auto entry = reinterpret_cast<FrameLink*>(&frames[PAGESIZE * (NUM_FRAMES - 1)]);
-	entry->next = nullptr;
+	freeLists[order] = link;
+	freeMask |= (1UL << order);
+
+	frames[idx].order = order;
+	frames[idx].state = FRAME_FREE;
+	freeFrames += (1UL << order);
 }
 
-void* FrameAllocator::earlyAlloc() {
-	if (head == nullptr)
+void FrameAllocator::removeFree(size_t idx, size_t order) {
+	auto link = reinterpret_cast<FrameLink*>(toAddress(idx));
+	if (link->prev != nullptr)
+		link->prev->next = link->next;
+	else
+		freeLists[order] = link->next;
+
+	if (link->next != nullptr)
+		link->next->prev = link->prev;
+
+	if (freeLists[order] == nullptr)
+		freeMask &= ~(1UL << order);
+
+	frames[idx].state = FRAME_RESERVED;
+	freeFrames -= (1UL << order);
+}
+
+void* FrameAllocator::allocBlock(size_t order) {
+	if (order >= NUM_ORDERS)
+		return nullptr;
+
+	/* Find smallest non-empty free list with sufficient order */
+	auto candidates = freeMask & ~((1UL << order) - 1);
+	if (candidates == 0)
 		return nullptr;
+	size_t current = util::ffs(candidates);
 
-	auto ret = head;
-	head = head->next;
+	/* Take first block */
+	auto idx = toIndex(freeLists[current]);
+	removeFree(idx, current);
 
-	return ret;
+	/* Split block and return upper halves to the free lists */
+	while (current > order) {
+		current--;
+		pushFree(idx + (1UL << current), current);
+	}
+
+	frames[idx].order = order;
+	frames[idx].state = FRAME_USED;
+	frames[idx].count = 0;
+
+	return toAddress(idx);
 }
 
-int FrameAllocator::earlyFree(void *page) {
-	if (reinterpret_cast<uintptr_t>(page) < reinterpret_cast<uintptr_t>(frames))
+int FrameAllocator::freeBlock(void* addr) {
+	if (reinterpret_cast<uintptr_t>(addr) < base || reinterpret_cast<uintptr_t>(addr) % PAGESIZE != 0)
 		return -EINVAL;
 
-	if (reinterpret_cast<uintptr_t>(page) >= reinterpret_cast<uintptr_t>(frames) + SIZE)
+	auto idx = toIndex(addr);
+	if (idx >= numFrames || frames[idx].state != FRAME_USED)
 		return -EINVAL;
 
-	if (reinterpret_cast<uintptr_t>(page) % PAGESIZE != 0)
-		return -EINVAL;
+	size_t order = frames[idx].order;
+	frames[idx].state = FRAME_RESERVED;
+
+	/* Merge with free buddies */
+	while (order < NUM_ORDERS - 1) {
+		auto buddy = idx ^ (1UL << order);
+		if (buddy >= numFrames || frames[buddy].state != FRAME_FREE || frames[buddy].order != order)
+			break;
 
-	auto entry = reinterpret_cast<FrameLink*>(page);
-	entry->next = head;
+		removeFree(buddy, order);
+		idx = (idx < buddy) ? idx : buddy;
+		order++;
+	}
 
-	head = entry;
+	pushFree(idx, order);
 
 	return 0;
 }
 
+void FrameAllocator::addRange(uintptr_t start, uintptr_t end) {
+	while (start < end) {
+		/* Use largest naturally aligned block fitting into range */
+		auto idx = toIndex(reinterpret_cast<void*>(start));
+		size_t order = NUM_ORDERS - 1;
+		while (order > 0 && ((idx % (1UL << order)) != 0 || start + (PAGESIZE << order) > end))
+			order--;
+
+		frames[idx].order = order;
+		frames[idx].state = FRAME_USED;
+		freeBlock(reinterpret_cast<void*>(start));
+
+		start += PAGESIZE << order;
+	}
+}
+
+int FrameAllocator::init(const DeviceTree::Parser& dtp) {
+	using range_t = lib::pair<uintptr_t, uintptr_t>;
+
+	/*******************************
+	 * Step 1: Find reserved areas *
+	 *******************************/
+	range_t reserved[MAX_RESERVED];
+	size_t numReserved = 0;
+	bool overflow = false;
+	auto reserve = [&](uintptr_t start, size_t size) {
+		if (size == 0)
+			return;
+
+		auto first = math::roundDown(start, PAGESIZE);
+		auto last = math::roundUp(start + size, PAGESIZE);
+
+		/* Merge with overlapping or adjacent area */
+		for (size_t i = 0; i < numReserved; i++) {
+			if (first > reserved[i].second || last < reserved[i].first)
+				continue;
+
+			reserved[i].first = (first < reserved[i].first) ? first : reserved[i].first;
+			reserved[i].second = (last > reserved[i].second) ? last : reserved[i].second;
+			return;
+		}
+
+		/* Unrecorded area would be handed out as free memory */
+		if (numReserved == MAX_RESERVED) {
+			overflow = true;
+			return;
+		}
+
+		reserved[numReserved++] = range_t(first, last);
+	};
+
+	/* Memory reservation block */
+	for (size_t i = 0; ; i++) {
+		auto entry = dtp.getReservedMemory(i);
+		if (entry.first == nullptr && entry.second == 0)
+			break;
+
+		reserve(reinterpret_cast<uintptr_t>(entry.first), entry.second);
+	}
+
+	/* Kernel image (text up to the end of the symbol map) */
+	auto text = linker::getTextSegment();
+	auto symMap = symbols.getRange();
+	auto imageStart = reinterpret_cast<uintptr_t>(text.first);
+	auto imageEnd = reinterpret_cast<uintptr_t>(symMap.first) + symMap.second;
+	reserve(imageStart, imageEnd - imageStart);
+
+	/* Device tree blob */
+	auto fdt = dtp.getConfigSpace();
+	reserve(reinterpret_cast<uintptr_t>(fdt.first), fdt.second);
+
+	/* Device ranges */
+	for (auto node : dtp) {
+		if (!node.isValid())
+			continue;
+
+		auto rangeProp = node.findRangeProperty("ranges");
+		for (auto rangeIt = rangeProp.first; rangeIt != rangeProp.second; ++rangeIt) {
+			auto range = *rangeIt;
+			reserve(reinterpret_cast<uintptr_t>(lib::get<1>(range)), lib::get<2>(range));
+		}
+	}
+
+	if (overflow)
+		return -ENOMEM;
+
+	/* Sort reserved areas by start address */
+	for (size_t i = 1; i < numReserved; i++) {
+		for (size_t j = i; j > 0 && reserved[j - 1].first > reserved[j].first; j--) {
+			auto tmp = reserved[j];
+			reserved[j] = reserved[j - 1];
+			reserved[j - 1] = tmp;
+		}
+	}
+
+	/***************************************
+	 * Step 2: Find available memory areas *
+	 ***************************************/
+	uintptr_t lowest = ~static_cast<uintptr_t>(0);
+	uintptr_t highest = 0;
+	numRanges = 0;
+	for (auto node : dtp) {
+		if (!node.isValid())
+			continue;
+
+		/* Memory nodes are named "memory" or "memory@<address>" */
+		auto name = node.getName();
+		if (strncmp("memory", name, 6) != 0 || (name[6] != '\0' && name[6] != '@'))
+			continue;
+
+		auto regProp = node.findRegisterProperty("reg");
+		for (auto regIt = regProp.first; regIt != regProp.second; ++regIt) {
+			auto reg = *regIt;
+			auto start = math::roundUp(reinterpret_cast<uintptr_t>(reg.first), PAGESIZE);
+			auto end = math::roundDown(reinterpret_cast<uintptr_t>(reg.first) + reg.second, PAGESIZE);
+			if (start >= end)
+				continue;
+
+			lowest = (start < lowest) ? start : lowest;
+			highest = (end > highest) ? end : highest;
+
+			/* Subtract reserved areas */
+			for (size_t i = 0; i < numReserved && start < end; i++) {
+				if (reserved[i].second <= start)
+					continue;
+
+				if (reserved[i].first >= end)
+					break;
+
+				if (reserved[i].first > start) {
+					if (numRanges == MAX_RANGES)
+						return -ENOMEM;
+
+					ranges[numRanges++] = lib::pair(reinterpret_cast<void*>(start), reserved[i].first - start);
+				}
+
+				start = reserved[i].second;
+			}
+
+			if (start < end) {
+				if (numRanges == MAX_RANGES)
+					return -ENOMEM;
+
+				ranges[numRanges++] = lib::pair(reinterpret_cast<void*>(start), end - start);
+			}
+		}
+	}
+
+	if (numRanges == 0)
+		return -ENOMEM;
+
+	/***********************************
+	 * Step 3: Place frame descriptors *
+	 ***********************************/
+	base = math::roundDown(lowest, PAGESIZE << (NUM_ORDERS - 1));
+	numFrames = (highest - base) / PAGESIZE;
+	auto descSize = math::roundUp(numFrames * sizeof(Frame), PAGESIZE);
+
+	/* Range of frame descriptors is recorded, too (see Step 4) */
+	if (numRanges == MAX_RANGES)
+		return -ENOMEM;
+
+	frames = nullptr;
+	for (size_t i = 0; i < numRanges; i++) {
+		if (ranges[i].second < descSize)
+			continue;
+
+		frames = reinterpret_cast<Frame*>(ranges[i].first);
+		ranges[i].first = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(ranges[i].first) + descSize);
+		ranges[i].second -= descSize;
+		break;
+	}
+
+	if (frames == nullptr)
+		return -ENOMEM;
+
+	for (size_t i = 0; i < numFrames; i++) {
+		frames[i].order = 0;
+		frames[i].state = FRAME_RESERVED;
+		frames[i].count = 0;
+	}
+
+	/*****************************
+	 * Step 4: Fill buddy system *
+	 *****************************/
+	for (size_t i = 0; i < numRanges; i++) {
+		auto start = reinterpret_cast<uintptr_t>(ranges[i].first);
+		addRange(start, start + ranges[i].second);
+	}
+
+	/* Frame descriptors are managed memory, too (and need to be mapped) */
+	ranges[numRanges++] = lib::pair(reinterpret_cast<void*>(frames), descSize);
+
+	return 0;
+}
+
+bool FrameAllocator::isFrame(void* page) const {
+	if (reinterpret_cast<uintptr_t>(page) < base || reinterpret_cast<uintptr_t>(page) % PAGESIZE != 0)
+		return false;
+
+	auto idx = toIndex(page);
+	if (idx >= numFrames)
+		return false;
+
+	return frames[idx].state == FRAME_USED && frames[idx].order == 0;
+}
+
+void* FrameAllocator::earlyAlloc() {
+	return allocBlock(0);
+}
+
+int FrameAllocator::earlyFree(void *page) {
+	if (!isFrame(page))
+		return -EINVAL;
+
+	return freeBlock(page);
+}
+
+void FrameAllocator::refill(Magazine& magazine) {
+	{
+		lock::lock_guard guard(lock);
+		while (magazine.count < MAGAZINE_BATCH) {
+			void* frame = allocBlock(0);
+			if (frame == nullptr)
+				break;
+
+			magazine.frames[magazine.count++] = frame;
+		}
+	}
+
+	magazine.stats.refills++;
+}
+
+void FrameAllocator::drain(Magazine& magazine) {
+	{
+		lock::lock_guard guard(lock);
+		for (size_t i = 0; i < MAGAZINE_BATCH; i++)
+			freeBlock(magazine.frames[--magazine.count]);
+	}
+
+	magazine.stats.drains++;
+}
+
 void* FrameAllocator::alloc() {
-	lock.lock();
-	void* ret = earlyAlloc();
-	lock.unlock();
+	/* Magazine is also used by interrupt handlers of this CPU */
+	lock::irqsave irq;
+
+	auto& magazine = magazines.get();
+	magazine.stats.allocs++;
+
+	if (magazine.count == 0) {
+		refill(magazine);
+	} else {
+		magazine.stats.allocHits++;
+	}
+
+	void* ret = nullptr;
+	if (magazine.count > 0)
+		ret = magazine.frames[--magazine.count];
+
 	return ret;
 }
 
 int FrameAllocator::free(void* page) {
-	lock.lock();
-	int ret = earlyFree(page);
-	lock.unlock();
-	return ret;
+	if (!isFrame(page))
+		return -EINVAL;
+
+	/* Magazine is also used by interrupt handlers of this CPU */
+	lock::irqsave irq;
+
+	auto& magazine = magazines.get();
+	magazine.stats.frees++;
+
+	/* Frames in magazines are still allocated, so reset usage counter here */
+	frames[toIndex(page)].count = 0;
+
+	if (magazine.count == MAGAZINE_SIZE) {
+		drain(magazine);
+	} else {
+		magazine.stats.freeHits++;
+	}
+
+	magazine.frames[magazine.count++] = page;
+
+	return 0;
+}
+
+void* FrameAllocator::allocPages(size_t order) {
+	/* Lock is also taken with disabled interrupts (see refill) */
+	lock::irqsave_guard guard(lock);
+	return allocBlock(order);
+}
+
+int FrameAllocator::freePages(void* pages) {
+	if (pages == nullptr)
+		return -EINVAL;
+
+	lock::irqsave_guard guard(lock);
+	return freeBlock(pages);
+}
+
+size_t FrameAllocator::sizeToOrder(size_t size) {
+	size_t order = 0;
+	while ((static_cast<size_t>(PAGESIZE) << order) < size)
+		order++;
+
+	return order;
+}
+
+FrameAllocator::Statistics FrameAllocator::getStatistics(size_t cpuID) const {
+	return magazines.get(cpuID).stats;
+}
+
+size_t FrameAllocator::getUseCount(const void* page) const {
+	auto idx = toIndex(page);
+	if (idx >= numFrames)
+		return 0;
+
+	return frames[idx].count;
+}
+
+void FrameAllocator::setUseCount(const void* page, size_t count) {
+	auto idx = toIndex(page);
+	if (idx >= numFrames)
+		return;
+
+	frames[idx].count = count;
+}
+
+size_t FrameAllocator::getFreeFrames() const {
+	return freeFrames;
+}
+
+FrameAllocator::iterator FrameAllocator::begin() const {
+	return &ranges[0];
+}
+
+FrameAllocator::iterator FrameAllocator::end() const {
+	return &ranges[numRanges];
 }
@@ -3,8 +3,10 @@
 #include <kernel/math.h>
 #include <kernel/error.h>
 #include <kernel/linker.h>
+#include <kernel/lock/guard.h>
 #include <kernel/symbols.h>
 #include <kernel/mm/paging.h>
+#include <kernel/mm/tlb_shootdown.h>
 #include <kernel/mm/frame_allocator.h>
 #include <kernel/mm/translation_table.h>
 
@@ -12,186 +14,403 @@ using namespace mm;
 
 lock::spinlock Paging::lock;
 
-void* Paging::tables = nullptr;
+void* Paging::kernelTables = nullptr;
 
-Paging::Paging() {
-	tables = CPU::getTranslationTable();
+Paging::Paging() : tables(kernelTables), cpus(nullptr) {}
+
+Paging::Paging(void* tables, const cpu_mask* cpus) : tables(tables), cpus(cpus) {}
+
+size_t Paging::getOffset(void* addr, size_t level) {
+	return (reinterpret_cast<uintptr_t>(addr) >> (39 - 9 * level)) % TranslationTable::NUM_ENTRIES;
+}
+
+size_t Paging::getLevelSize(size_t level) {
+	return static_cast<size_t>(1) << (39 - 9 * level);
 }
 
-template<size_t level>
-size_t Paging::getOffset(void* addr) {
-	static_assert(level < NUM_TABLES, "level should be less than number of NUM_TABLES");
+int Paging::setProtection(TranslationTable& tt, size_t entry, priv_lvl_t priv, prot_t prot, mem_attr_t attr) {
+	TranslationTable::access_t access;
+	if (priv == KERNEL_MAPPING && prot == READONLY) {
+		access = TranslationTable::ELX_RO_EL0_NONE;
+		tt.setExecuteNeverBitUser(entry, true);
+		tt.setExecuteNeverBitKernel(entry, prot != EXECUTABLE);
+
+	} else if (priv == KERNEL_MAPPING && prot == WRITABLE) {
+		access = TranslationTable::ELX_RW_EL0_NONE;
+		tt.setExecuteNeverBitUser(entry, true);
+		tt.setExecuteNeverBitKernel(entry, prot != EXECUTABLE);
+
+	} else if (priv == KERNEL_MAPPING && prot == EXECUTABLE) {
+		access = TranslationTable::ELX_RO_EL0_NONE;
+		tt.setExecuteNeverBitUser(entry, true);
+		tt.setExecuteNeverBitKernel(entry, prot != EXECUTABLE);
+
+	} else if (priv == USER_MAPPING && prot == READONLY) {
+		access = TranslationTable::ELX_RO_EL0_RO;
+		tt.setExecuteNeverBitUser(entry, prot != EXECUTABLE);
+		tt.setExecuteNeverBitKernel(entry, true);
 
-	if constexpr (level == 3) {
-		return (reinterpret_cast<uintptr_t>(addr) >> 12) % TranslationTable::NUM_ENTRIES;
+	} else if (priv == USER_MAPPING && prot == WRITABLE) {
+		access = TranslationTable::ELX_RW_EL0_RW;
+		tt.setExecuteNeverBitUser(entry, prot != EXECUTABLE);
+		tt.setExecuteNeverBitKernel(entry, true);
 
-	} else if constexpr(level == 2) {
-		return (reinterpret_cast<uintptr_t>(addr) >> 21) % TranslationTable::NUM_ENTRIES;
+	} else if (priv == USER_MAPPING && prot == EXECUTABLE) {
+		access = TranslationTable::ELX_RO_EL0_RO;
+		tt.setExecuteNeverBitUser(entry, prot != EXECUTABLE);
+		tt.setExecuteNeverBitKernel(entry, true);
 
-	} else if constexpr (level == 1) {
-		return (reinterpret_cast<uintptr_t>(addr) >> 30) % TranslationTable::NUM_ENTRIES;
+	} else {
+		return -EINVAL;
 	}
+	tt.setAccessControl(entry, access);
+
+	/* Set memory attribute */
+	tt.setAttrIndex(entry, attr);
 
-	return (reinterpret_cast<uintptr_t>(addr) >> 39) % TranslationTable::NUM_ENTRIES;
+	return 0;
 }
 
-void Paging::getOffsets(void* addr, size_t offsets[4]) {
-	offsets[0] = getOffset<0>(addr);
-	offsets[1] = getOffset<1>(addr);
-	offsets[2] = getOffset<2>(addr);
-	offsets[3] = getOffset<3>(addr);
+template<bool earlyBoot>
+void* Paging::allocTT() {
+	void* page = nullptr;
+	if constexpr (earlyBoot) {
+		page = frameAlloc.earlyAlloc();
+	} else {
+		page = frameAlloc.alloc();
+	}
+
+	if (page != nullptr)
+		TranslationTable(page).setDefault();
+
+	return page;
+}
+
+bool Paging::isEmpty(const TranslationTable& tt) {
+	return frameAlloc.getUseCount(tt.getFrame()) == 0;
+}
+
+void Paging::setPresent(TranslationTable& tt, size_t entry, bool present) {
+	if ((tt.getPresentBit(entry) == 1) == present)
+		return;
+
+	tt.setPresentBit(entry, present);
+
+	/* Update number of live entries */
+	auto count = frameAlloc.getUseCount(tt.getFrame());
+	frameAlloc.setUseCount(tt.getFrame(), present ? count + 1 : count - 1);
+}
+
+void Paging::invalidateRange(void* vaddr, size_t size) const {
+	tlbShootdown.invalidate(cpus, vaddr, size);
 }
 
 template<bool earlyBoot>
-int Paging::genTTs(void* vaddr) {
-	size_t offsets[NUM_TABLES];
-	getOffsets(vaddr, offsets);
-
-	void* drag = tables;
-	for (size_t i = 0; i < NUM_TABLES - 1; i++) {
-		TranslationTable tt(drag);
-
-		/* Check if next level is accessable */
-		if (!tt.getPresentBit(offsets[i])) {
-			void* page = nullptr;
-			/* Allocate new page */
-			if constexpr (earlyBoot) {
-				page = frameAlloc.earlyAlloc();
-			} else {
-				page = frameAlloc.alloc();
-			}
+int Paging::splitBlock(TranslationTable& tt, size_t entry, size_t level, void* vaddr) {
+	/* Block of live kernel mapping (global) might hold stacks or translation tables in use */
+	if (!earlyBoot && tt.getNotGlobalBit(entry) == 0)
+		return -EBUSY;
+
+	/* Allocate new page */
+	void* page = allocTT<earlyBoot>();
+	if (page == nullptr)
+		return -ENOMEM;
+
+	/* Describe same range with entries of next level (inheriting all attributes) */
+	TranslationTable ttNext(page);
+	auto descriptor = tt.getDescriptor(entry);
+	auto base = reinterpret_cast<uintptr_t>(tt.getAddress(entry));
+	auto size = getLevelSize(level + 1);
+	for (size_t i = 0; i < TranslationTable::NUM_ENTRIES; i++) {
+		ttNext.setDescriptor(i, descriptor);
+		ttNext.setAddress(i, reinterpret_cast<void*>(base + i * size));
+		ttNext.setBlockBit(i, level + 1 < NUM_TABLES - 1);
+	}
+	frameAlloc.setUseCount(page, TranslationTable::NUM_ENTRIES);
+
+	/* Break-before-make: Remove block (and its TLB entries) before linking next level */
+	setPresent(tt, entry, false);
+	CPU::invalidatePage(reinterpret_cast<void*>(math::roundDown(reinterpret_cast<uintptr_t>(vaddr), getLevelSize(level))));
+
+	tt.setDefault(entry);
+	tt.setAddress(entry, page);
+	setPresent(tt, entry, true);
+	CPU::dataBarrier();
+
+	return 0;
+}
+
+Paging::Cursor::Cursor(void* root) : depth(1) {
+	tts[0] = TranslationTable(root);
+	bases[0] = 0;
+}
+
+template<bool earlyBoot>
+int Paging::Cursor::walk(void* vaddr, bool create) {
+	auto addr = reinterpret_cast<uintptr_t>(vaddr);
+
+	/* Keep translation tables, which also describe vaddr */
+	while (depth > 1 && bases[depth - 1] != math::roundDown(addr, getLevelSize(depth - 2)))
+		depth--;
 
+	/* Walk remaining levels */
+	for (; depth < NUM_TABLES; depth++) {
+		auto& tt = tts[depth - 1];
+		auto entry = getOffset(vaddr, depth - 1);
+
+		if (!tt.getPresentBit(entry)) {
+			if (!create)
+				return -EINVAL;
+
+			/* Create next level */
+			void* page = allocTT<earlyBoot>();
 			if (page == nullptr)
 				return -ENOMEM;
 
-			/* Prepare next level */
-			TranslationTable ttNext(page);
-			ttNext.setDefault();
+			tt.setAddress(entry, page);
+			setPresent(tt, entry, true);
 
-			/* Link next level */
-			tt.setAddress(offsets[i], page);
-			tt.setPresentBit(offsets[i], true);
+		} else if (tt.getBlockBit(entry)) {
+			/* Split block on demand */
+			int err = splitBlock<earlyBoot>(tt, entry, depth - 1, vaddr);
+			if (err < 0)
+				return err;
 		}
 
-		drag = tt.getAddress(offsets[i]);
+		tts[depth] = TranslationTable(tt.getAddress(entry));
+		bases[depth] = math::roundDown(addr, getLevelSize(depth - 1));
 	}
 
 	return 0;
 }
 
-int Paging::getTTs(void *vaddr, TranslationTable tt[4]) const {
-	size_t offsets[NUM_TABLES];
-	getOffsets(vaddr, offsets);
+TranslationTable& Paging::Cursor::getTable(size_t level) {
+	return tts[level];
+}
 
-	void* drag = tables;
-	void* tts[NUM_TABLES] = {drag, nullptr, nullptr, nullptr};
-	for (size_t i = 0; i < NUM_TABLES - 1; i++) {
-		TranslationTable tt(drag);
+int Paging::internalProtect(void *vaddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr) {
+	/* Get translation tables (and split blocks containing vaddr) */
+	Cursor cursor(tables);
+	int err = cursor.walk(vaddr, false);
+	if (err < 0)
+		return err;
 
-		/* Check if next level is accessable */
-		if (tt.getPresentBit(offsets[i]) == 0)
-			return -EINVAL;
+	auto& tt = cursor.getTable(NUM_TABLES - 1);
+	auto entry = getOffset(vaddr, NUM_TABLES - 1);
+	if (tt.getPresentBit(entry) == 0)
+		return -ENXIO;
 
-		drag = tt.getAddress(offsets[i]);
-		tts[i + 1] = tt.getAddress(offsets[i]);
-	}
+	/* Update protection */
+	return setProtection(tt, entry, priv, prot, attr);
+}
 
-	tt[0] = TranslationTable(tts[0]);
-	tt[1] = TranslationTable(tts[1]);
-	tt[2] = TranslationTable(tts[2]);
-	tt[3] = TranslationTable(tts[3]);
+template<bool earlyBoot>
+int Paging::internalMap(void* vaddr, void* paddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr) {
+	/* Get (or generate) translation tables */
+	Cursor cursor(tables);
+	int err = cursor.walk<earlyBoot>(vaddr, true);
+	if (err < 0)
+		return err;
+
+	auto& tt = cursor.getTable(NUM_TABLES - 1);
+	auto entry = getOffset(vaddr, NUM_TABLES - 1);
+
+	/* Set address */
+	setPresent(tt, entry, false);
+	tt.setDefault(entry);
+	tt.setAddress(entry, paddr);
+	tt.setNotGlobalBit(entry, tables != kernelTables);
+
+	/* Update protection */
+	err = setProtection(tt, entry, priv, prot, attr);
+	if (err < 0)
+		return err;
 
+	setPresent(tt, entry, true);
 	return 0;
 }
 
-int Paging::internalProtect(void *vaddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr) {
-	/* Get translation tables */
-	TranslationTable tts[NUM_TABLES];
-	if (getTTs(vaddr, tts))
-		return -EINVAL;
+template<bool earlyBoot>
+int Paging::mapLevel(TranslationTable tt, size_t level, uintptr_t vaddr, uintptr_t end, uintptr_t paddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr) {
+	auto levelSize = getLevelSize(level);
+
+	while (vaddr < end) {
+		auto next = math::roundDown(vaddr, levelSize) + levelSize;
+		if (next > end || next == 0)
+			next = end;
+
+		auto entry = getOffset(reinterpret_cast<void*>(vaddr), level);
+		bool present = tt.getPresentBit(entry);
+		bool table = present && level < NUM_TABLES - 1 && !tt.getBlockBit(entry);
+
+		/* Use page or block (level 1: 1 GiB, level 2: 2 MiB) if it covers the whole entry */
+		bool leaf = level == NUM_TABLES - 1 || (level > 0 && !table &&
+				next - vaddr == levelSize && paddr % levelSize == 0);
+
+		if (leaf) {
+			setPresent(tt, entry, false);
+			tt.setDefault(entry);
+			tt.setAddress(entry, reinterpret_cast<void*>(paddr));
+			tt.setBlockBit(entry, level < NUM_TABLES - 1);
+			tt.setNotGlobalBit(entry, tables != kernelTables);
+
+			int err = setProtection(tt, entry, priv, prot, attr);
+			if (err < 0)
+				return err;
+
+			setPresent(tt, entry, true);
+
+		} else {
+			if (!present) {
+				/* Create next level */
+				void* page = allocTT<earlyBoot>();
+				if (page == nullptr)
+					return -ENOMEM;
+
+				tt.setAddress(entry, page);
+				setPresent(tt, entry, true);
+
+			} else if (!table) {
+				/* Split block on demand */
+				int err = splitBlock<earlyBoot>(tt, entry, level, reinterpret_cast<void*>(vaddr));
+				if (err < 0)
+					return err;
+			}
 
-	/* Prepare offsets */
-	size_t offs[NUM_TABLES];
-	getOffsets(vaddr, offs);
+			int err = mapLevel<earlyBoot>(TranslationTable(tt.getAddress(entry)), level + 1, vaddr, next, paddr, priv, prot, attr);
+			if (err < 0)
+				return err;
+		}
 
-	if (tts[3].getPresentBit(offs[3]) == 0)
-		return -ENXIO;
+		paddr += next - vaddr;
+		vaddr = next;
+	}
 
-	/* Update protection */
-	TranslationTable::access_t access;
-	if (priv == KERNEL_MAPPING && prot == READONLY) {
-		access = TranslationTable::ELX_RO_EL0_NONE;
-		tts[3].setExecuteNeverBitUser(offs[3], true);
-		tts[3].setExecuteNeverBitKernel(offs[3], prot != EXECUTABLE);
+	return 0;
+}
 
-	} else if (priv == KERNEL_MAPPING && prot == WRITABLE) {
-		access = TranslationTable::ELX_RW_EL0_NONE;
-		tts[3].setExecuteNeverBitUser(offs[3], true);
-		tts[3].setExecuteNeverBitKernel(offs[3], prot != EXECUTABLE);
+int Paging::unmapLevel(TranslationTable tt, size_t level, uintptr_t vaddr, uintptr_t end) {
+	auto levelSize = getLevelSize(level);
 
-	} else if (priv == KERNEL_MAPPING && prot == EXECUTABLE) {
-		access = TranslationTable::ELX_RO_EL0_NONE;
-		tts[3].setExecuteNeverBitUser(offs[3], true);
-		tts[3].setExecuteNeverBitKernel(offs[3], prot != EXECUTABLE);
+	while (vaddr < end) {
+		auto start = math::roundDown(vaddr, levelSize);
+		auto next = start + levelSize;
+		if (next > end || next == 0)
+			next = end;
 
-	} else if (priv == USER_MAPPING && prot == READONLY) {
-		access = TranslationTable::ELX_RO_EL0_RO;
-		tts[3].setExecuteNeverBitUser(offs[3], prot != EXECUTABLE);
-		tts[3].setExecuteNeverBitKernel(offs[3], true);
+		auto entry = getOffset(reinterpret_cast<void*>(vaddr), level);
+		if (tt.getPresentBit(entry)) {
+			bool leaf = level == NUM_TABLES - 1 || tt.getBlockBit(entry);
 
-	} else if (priv == USER_MAPPING && prot == WRITABLE) {
-		access = TranslationTable::ELX_RW_EL0_RW;
-		tts[3].setExecuteNeverBitUser(offs[3], prot != EXECUTABLE);
-		tts[3].setExecuteNeverBitKernel(offs[3], true);
+			if (leaf && next - vaddr == levelSize) {
+				/* Remove whole page or block */
+				setPresent(tt, entry, false);
 
-	} else if (priv == USER_MAPPING && prot == EXECUTABLE) {
-		access = TranslationTable::ELX_RO_EL0_RO;
-		tts[3].setExecuteNeverBitUser(offs[3], prot != EXECUTABLE);
-		tts[3].setExecuteNeverBitKernel(offs[3], true);
+			} else {
+				/* Split block on demand */
+				if (leaf) {
+					int err = splitBlock<false>(tt, entry, level, reinterpret_cast<void*>(vaddr));
+					if (err < 0)
+						return err;
+				}
+
+				TranslationTable ttNext(tt.getAddress(entry));
+				int err = unmapLevel(ttNext, level + 1, vaddr, next);
+				if (err < 0)
+					return err;
+
+				/* Release empty translation table (after removing it from TLB and walk caches) */
+				if (isEmpty(ttNext)) {
+					setPresent(tt, entry, false);
+					CPU::invalidatePage(reinterpret_cast<void*>(start));
+					frameAlloc.free(ttNext.getFrame());
+				}
+			}
+		}
 
-	} else {
-		lock.unlock();
-		return -EINVAL;
+		vaddr = next;
 	}
-	tts[3].setAccessControl(offs[3], access);
 
-	/* Set memory attribute */
-	tts[3].setAttrIndex(offs[3], attr);
+	return 0;
+}
+
+int Paging::protectLevel(TranslationTable tt, size_t level, uintptr_t vaddr, uintptr_t end, priv_lvl_t priv, prot_t prot, mem_attr_t attr) {
+	auto levelSize = getLevelSize(level);
+
+	while (vaddr < end) {
+		auto next = math::roundDown(vaddr, levelSize) + levelSize;
+		if (next > end || next == 0)
+			next = end;
+
+		auto entry = getOffset(reinterpret_cast<void*>(vaddr), level);
+		if (!tt.getPresentBit(entry))
+			return -ENXIO;
+
+		bool leaf = level == NUM_TABLES - 1 || tt.getBlockBit(entry);
+		if (leaf && next - vaddr == levelSize) {
+			/* Update whole page or block */
+			int err = setProtection(tt, entry, priv, prot, attr);
+			if (err < 0)
+				return err;
+
+		} else {
+			/* Split block on demand */
+			if (leaf) {
+				int err = splitBlock<false>(tt, entry, level, reinterpret_cast<void*>(vaddr));
+				if (err < 0)
+					return err;
+			}
+
+			int err = protectLevel(TranslationTable(tt.getAddress(entry)), level + 1, vaddr, next, priv, prot, attr);
+			if (err < 0)
+				return err;
+		}
+
+		vaddr = next;
+	}
 
 	return 0;
 }
 
-template<bool earlyBoot>
-int Paging::internalMap(void* vaddr, void* paddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr) {
-	/* Generate translation tables */
-	int err = genTTs<earlyBoot>(vaddr);
-	if (err < 0)
-		return err;
+bool Paging::isValidRange(void* vaddr, size_t size) const {
+	auto start = reinterpret_cast<uintptr_t>(vaddr);
 
-	/* Get translation tables */
-	TranslationTable tts[NUM_TABLES];
-	err = getTTs(vaddr, tts);
-	if (err)
-		return -EINVAL;
+	if (start % PAGESIZE != 0 || size % PAGESIZE != 0 || size == 0)
+		return false;
 
-	/* Prepare offsets */
-	size_t offs[NUM_TABLES];
-	getOffsets(vaddr, offs);
+	/* Reject overflowing ranges */
+	if (start + size <= start)
+		return false;
 
-	/* Set address */
-	tts[3].setAddress(offs[3], paddr);
-	tts[3].setPresentBit(offs[3], true);
+	return isInAddressSpace(start, start + size);
+}
 
-	/* Update protection */
-	err = internalProtect(vaddr, priv, prot, attr);
+bool Paging::isInAddressSpace(uintptr_t start, uintptr_t end) const {
+	if (tables == kernelTables)
+		return end <= USER_SPACE_START;
 
-	return err;
+	return start >= USER_SPACE_START && end <= USER_SPACE_END;
 }
 
 int Paging::earlyMap(void* vaddr, void* paddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr) {
 	return internalMap<true>(vaddr, paddr, priv, prot, attr);
 }
 
+int Paging::earlyMapRange(void* vaddr, void* paddr, size_t size, priv_lvl_t priv, prot_t prot, mem_attr_t attr) {
+	if (!isValidRange(vaddr, size) || reinterpret_cast<uintptr_t>(paddr) % PAGESIZE != 0)
+		return -EINVAL;
+
+	auto start = reinterpret_cast<uintptr_t>(vaddr);
+	return mapLevel<true>(TranslationTable(tables), 0, start, start + size, reinterpret_cast<uintptr_t>(paddr), priv, prot, attr);
+}
+
+int Paging::earlyMapSegment(void* start, size_t size, priv_lvl_t priv, prot_t prot) {
+	auto mapStart = math::roundDown(reinterpret_cast<uintptr_t>(start), PAGESIZE);
+	auto mapEnd = math::roundUp(reinterpret_cast<uintptr_t>(start) + size, PAGESIZE);
+
+	return earlyMapRange(reinterpret_cast<void*>(mapStart), reinterpret_cast<void*>(mapStart), mapEnd - mapStart, priv, prot, DEFAULT_ATTR);
+}
+
 int Paging::createEarlyKernelMapping() {
 	/* Create translation table level 0 */
 	void* frame = frameAlloc.earlyAlloc();
@@ -199,96 +418,52 @@ int Paging::createEarlyKernelMapping() {
 	tt.setDefault();
 
 	/* Create translation tables */
+	kernelTables = frame;
 	Paging paging;
-	paging.tables = frame;
 	auto text = linker::getTextSegment();
-	for (uintptr_t addr = reinterpret_cast<uintptr_t>(text.first);
-			addr < math::roundUp(reinterpret_cast<uintptr_t>(text.first) + text.second, PAGESIZE);
-			addr += PAGESIZE) {
-
-		auto ret = paging.earlyMap(reinterpret_cast<void*>(addr), reinterpret_cast<void*>(addr), KERNEL_MAPPING, EXECUTABLE, NORMAL_ATTR);
-		if (isError(ret))
-			return castError<int, decltype(ret)>(ret);
-	}
+	int err = paging.earlyMapSegment(text.first, text.second, KERNEL_MAPPING, EXECUTABLE);
+	if (err < 0)
+		return err;
 
 	auto data = linker::getDataSegment();
-	for (uintptr_t addr = reinterpret_cast<uintptr_t>(data.first);
-			addr < math::roundUp(reinterpret_cast<uintptr_t>(data.first) + data.second, PAGESIZE);
-			addr += PAGESIZE) {
-
-		auto ret = paging.earlyMap(reinterpret_cast<void*>(addr), reinterpret_cast<void*>(addr), KERNEL_MAPPING, WRITABLE, NORMAL_ATTR);
-		if (isError(ret))
-			return castError<int, decltype(ret)>(ret);
-	}
+	err = paging.earlyMapSegment(data.first, data.second, KERNEL_MAPPING, WRITABLE);
+	if (err < 0)
+		return err;
 
 	auto rodata = linker::getRODataSegment();
-	for (uintptr_t addr = reinterpret_cast<uintptr_t>(rodata.first);
-			addr < math::roundUp(reinterpret_cast<uintptr_t>(rodata.first) + rodata.second, PAGESIZE);
-			addr += PAGESIZE) {
-
-		auto ret = paging.earlyMap(reinterpret_cast<void*>(addr), reinterpret_cast<void*>(addr), KERNEL_MAPPING, READONLY, NORMAL_ATTR);
-		if (isError(ret))
-			return castError<int, decltype(ret)>(ret);
-	}
+	err = paging.earlyMapSegment(rodata.first, rodata.second, KERNEL_MAPPING, READONLY);
+	if (err < 0)
+		return err;
 
 	auto bss = linker::getBSSSegment();
-	for (uintptr_t addr = reinterpret_cast<uintptr_t>(bss.first);
-			addr < math::roundUp(reinterpret_cast<uintptr_t>(bss.first) + bss.second, PAGESIZE);
-			addr += PAGESIZE) {
-
-		auto ret = paging.earlyMap(reinterpret_cast<void*>(addr), reinterpret_cast<void*>(addr), KERNEL_MAPPING, WRITABLE, NORMAL_ATTR);
-		if (isError(ret))
-			return castError<int, decltype(ret)>(ret);
-	}
-
-    auto sym_map = symbols.getRange();
-	for (uintptr_t addr = reinterpret_cast<uintptr_t>(sym_map.first);
-			addr < math::roundUp(reinterpret_cast<uintptr_t>(sym_map.first) + sym_map.second, PAGESIZE);
-			addr += PAGESIZE) {
+	err = paging.earlyMapSegment(bss.first, bss.second, KERNEL_MAPPING, WRITABLE);
+	if (err < 0)
+		return err;
 
-		auto ret = paging.earlyMap(reinterpret_cast<void*>(addr), reinterpret_cast<void*>(addr), KERNEL_MAPPING, WRITABLE, NORMAL_ATTR);
-		if (isError(ret))
-			return castError<int, decltype(ret)>(ret);
-	}
+	auto sym_map = symbols.getRange();
+	err = paging.earlyMapSegment(sym_map.first, sym_map.second, KERNEL_MAPPING, WRITABLE);
+	if (err < 0)
+		return err;
 
 	auto textApp = linker::getAppTextSegment();
-	for (uintptr_t addr = reinterpret_cast<uintptr_t>(textApp.first);
-			addr < math::roundUp(reinterpret_cast<uintptr_t>(textApp.first) + textApp.second, PAGESIZE);
-			addr += PAGESIZE) {
-
-		auto ret = paging.earlyMap(reinterpret_cast<void*>(addr), reinterpret_cast<void*>(addr), USER_MAPPING, EXECUTABLE, NORMAL_ATTR);
-		if (isError(ret))
-			return castError<int, decltype(ret)>(ret);
-	}
+	err = paging.earlyMapSegment(textApp.first, textApp.second, USER_MAPPING, EXECUTABLE);
+	if (err < 0)
+		return err;
 
 	auto dataApp = linker::getAppDataSegment();
-	for (uintptr_t addr = reinterpret_cast<uintptr_t>(dataApp.first);
-			addr < math::roundUp(reinterpret_cast<uintptr_t>(dataApp.first) + dataApp.second, PAGESIZE);
-			addr += PAGESIZE) {
-
-		auto ret = paging.earlyMap(reinterpret_cast<void*>(addr), reinterpret_cast<void*>(addr), USER_MAPPING, WRITABLE, NORMAL_ATTR);
-		if (isError(ret))
-			return castError<int, decltype(ret)>(ret);
-	}
+	err = paging.earlyMapSegment(dataApp.first, dataApp.second, USER_MAPPING, WRITABLE);
+	if (err < 0)
+		return err;
 
 	auto rodataApp = linker::getAppRODataSegment();
-	for (uintptr_t addr = reinterpret_cast<uintptr_t>(rodataApp.first);
-			addr < math::roundUp(reinterpret_cast<uintptr_t>(rodataApp.first) + rodataApp.second, PAGESIZE);
-			addr += PAGESIZE) {
-
-		auto ret = paging.earlyMap(reinterpret_cast<void*>(addr), reinterpret_cast<void*>(addr), USER_MAPPING, READONLY, NORMAL_ATTR);
-		if (isError(ret))
-			return castError<int, decltype(ret)>(ret);
-	}
-
-	auto bssApp = linker::getAppBSSSegment();
-	for (uintptr_t addr = reinterpret_cast<uintptr_t>(bssApp.first);
-			addr < math::roundUp(reinterpret_cast<uintptr_t>(bssApp.first) + bssApp.second, PAGESIZE);
-			addr += PAGESIZE) {
+	err = paging.earlyMapSegment(rodataApp.first, rodataApp.second, USER_MAPPING, READONLY);
+	if (err < 0)
+		return err;
 
-		auto ret = paging.earlyMap(reinterpret_cast<void*>(addr), reinterpret_cast<void*>(addr), USER_MAPPING, WRITABLE, NORMAL_ATTR);
-		if (isError(ret))
-			return castError<int, decltype(ret)>(ret);
+	for (auto range : frameAlloc) {
+		err = paging.earlyMapSegment(range.first, range.second, KERNEL_MAPPING, WRITABLE);
+		if (err < 0)
+			return err;
 	}
 
 	/* Update TTBR0 */
@@ -297,73 +472,147 @@ int Paging::createEarlyKernelMapping() {
 }
 
 int Paging::loadKernelMapping() {
-	if (!tables)
+	if (!kernelTables)
 		return -EINVAL;
 
-	TranslationTable tt(tables);
-	tt.updateTTBR0();
-
+	CPU::setTranslationTable(kernelTables, 0);
 	return 0;
 }
 
+void* Paging::createUserTables() {
+	void* page = allocTT();
+	if (page == nullptr)
+		return nullptr;
+
+	/* Share kernel mapping (all global) */
+	TranslationTable tt(page);
+	TranslationTable kernelTT(kernelTables);
+	tt.setDescriptor(0, kernelTT.getDescriptor(0));
+	frameAlloc.setUseCount(page, 1);
+
+	return page;
+}
+
+int Paging::destroyUserTables(void* tables) {
+	if (tables == nullptr || tables == kernelTables)
+		return -EINVAL;
+
+	/* Release all translation tables of user address space (but keep shared kernel mapping) */
+	Paging paging(tables);
+	int err = paging.unmapRange(reinterpret_cast<void*>(USER_SPACE_START), USER_SPACE_END - USER_SPACE_START);
+	if (err < 0)
+		return err;
+
+	return frameAlloc.free(tables);
+}
+
 int Paging::map(void* vaddr, void* paddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr) {
-	lock.lock();
-	auto ret = internalMap<false>(vaddr, paddr, priv, prot, attr);
-	lock.unlock();
-	return ret;
+	auto addr = reinterpret_cast<uintptr_t>(vaddr);
+	if (!isInAddressSpace(addr, addr + PAGESIZE))
+		return -EINVAL;
+
+	lock::softirq_guard guard(lock);
+	return internalMap<false>(vaddr, paddr, priv, prot, attr);
 }
 
-void* Paging::unmap(void* vaddr) {
-	lock.lock();
+int Paging::mapRange(void* vaddr, void* paddr, size_t size, priv_lvl_t priv, prot_t prot, mem_attr_t attr) {
+	if (!isValidRange(vaddr, size) || reinterpret_cast<uintptr_t>(paddr) % PAGESIZE != 0)
+		return -EINVAL;
 
-	/* Get translation table wrapper */
-	TranslationTable tts[NUM_TABLES];
-	if (getTTs(vaddr, tts)) {
-		lock.unlock();
-		return makeError<void*>(EINVAL);
+	int err;
+	{
+		lock::softirq_guard guard(lock);
+		auto start = reinterpret_cast<uintptr_t>(vaddr);
+		err = mapLevel<false>(TranslationTable(tables), 0, start, start + size, reinterpret_cast<uintptr_t>(paddr), priv, prot, attr);
 	}
 
-	/* Get offsets in translation tables */
-	size_t offs[NUM_TABLES];
-	getOffsets(vaddr, offs);
+	/* Drop stale entries of replaced mappings (outside of lock, as other CPUs might be waited for) */
+	invalidateRange(vaddr, size);
+	return err;
+}
 
-	/* Save address of page frame */
-	void* ret = makeError<void*>(ENXIO);
-	if (tts[3].getPresentBit(offs[3])) {
-		ret = tts[3].getAddress(offs[3]);
+int Paging::unmapRange(void* vaddr, size_t size) {
+	if (!isValidRange(vaddr, size))
+		return -EINVAL;
+
+	int err;
+	{
+		lock::softirq_guard guard(lock);
+		auto start = reinterpret_cast<uintptr_t>(vaddr);
+		err = unmapLevel(TranslationTable(tables), 0, start, start + size);
 	}
 
-	for (size_t i = 3; i >= 1; i--) {
-		/* Set corrosponding entry as non-present */
-		tts[i].setPresentBit(offs[i], false);
+	invalidateRange(vaddr, size);
+	return err;
+}
+
+int Paging::protectRange(void* vaddr, size_t size, priv_lvl_t priv, prot_t prot, mem_attr_t attr) {
+	if (!isValidRange(vaddr, size))
+		return -EINVAL;
 
-		/* Check if translation table is empty */
-		for (size_t entry = 0; entry < TranslationTable::NUM_ENTRIES; entry++) {
-			/* Translation Table contains other entries -> Exit */
-			if (tts[i].getPresentBit(entry) == 1) {
-				lock.unlock();
-				return ret;
-			}
+	int err;
+	{
+		lock::softirq_guard guard(lock);
+		auto start = reinterpret_cast<uintptr_t>(vaddr);
+		err = protectLevel(TranslationTable(tables), 0, start, start + size, priv, prot, attr);
+	}
+
+	invalidateRange(vaddr, size);
+	return err;
+}
+
+void* Paging::unmap(void* vaddr) {
+	auto addr = reinterpret_cast<uintptr_t>(vaddr);
+	if (!isInAddressSpace(addr, addr + PAGESIZE))
+		return makeError<void*>(EINVAL);
+
+	void* ret = makeError<void*>(ENXIO);
+	{
+		lock::softirq_guard guard(lock);
+
+		/* Get translation tables (and split blocks containing vaddr) */
+		Cursor cursor(tables);
+		int err = cursor.walk(vaddr, false);
+		if (err < 0)
+			return makeError<void*>(err);
+
+		/* Save address of page frame */
+		auto& tt = cursor.getTable(NUM_TABLES - 1);
+		auto entry = getOffset(vaddr, NUM_TABLES - 1);
+		if (tt.getPresentBit(entry)) {
+			ret = tt.getAddress(entry);
+			setPresent(tt, entry, false);
 		}
 
-		/* Mark entry in translation table above as non present */
-		tts[i - 1].setPresentBit(offs[i - 1], false);
+		/* Release empty translation tables (after removing them from TLB and walk caches) */
+		for (size_t i = NUM_TABLES - 1; i >= 1; i--) {
+			if (!isEmpty(cursor.getTable(i)))
+				break;
 
-		/* Free frame */
-		frameAlloc.free(tts[i].getFrame());
+			setPresent(cursor.getTable(i - 1), getOffset(vaddr, i - 1), false);
+			CPU::invalidatePage(vaddr);
+			frameAlloc.free(cursor.getTable(i).getFrame());
+		}
 	}
 
-	lock.unlock();
+	if (!isError(ret))
+		invalidateRange(vaddr, PAGESIZE);
 	return ret;
 }
 
 int Paging::protect(void* vaddr, priv_lvl_t priv, prot_t prot, mem_attr_t attr) {
-	lock.lock();
+	auto addr = reinterpret_cast<uintptr_t>(vaddr);
+	if (!isInAddressSpace(addr, addr + PAGESIZE))
+		return -EINVAL;
 
-	/* Get translation table wrapper */
-	int err = internalProtect(vaddr, priv, prot, attr);
+	int err;
+	{
+		lock::softirq_guard guard(lock);
+		err = internalProtect(vaddr, priv, prot, attr);
+	}
 
-	lock.unlock();
+	if (err == 0)
+		invalidateRange(vaddr, PAGESIZE);
 	return err;
 }
 
@@ -0,0 +1,133 @@
+#include <cstdint.h>
+#include <climits.h>
+#include <kernel/cpu.h>
+#include <kernel/math.h>
+#include <kernel/lock/guard.h>
+#include <kernel/mm/slab.h>
+#include <kernel/mm/frame_allocator.h>
+
+using namespace mm;
+
+SlabCache::SlabCache(const char* name, size_t size, size_t align) : name(name), head(nullptr), slabs(0), cpuCaches(CPUCache()) {
+	/* Free objects have to hold an ObjectLink */
+	size = (size < sizeof(ObjectLink)) ? sizeof(ObjectLink) : size;
+	align = (align < alignof(ObjectLink)) ? alignof(ObjectLink) : align;
+	objSize = math::roundUp(size, align);
+
+	/* Use slabs with at least 8 objects */
+	slabOrder = FrameAllocator::sizeToOrder(objSize * 8);
+}
+
+bool SlabCache::grow() {
+	char* slab = reinterpret_cast<char*>(frameAlloc.allocPages(slabOrder));
+	if (slab == nullptr)
+		return false;
+
+	size_t numObjects = (static_cast<size_t>(PAGESIZE) << slabOrder) / objSize;
+	for (size_t i = 0; i < numObjects; i++) {
+		auto link = reinterpret_cast<ObjectLink*>(&slab[i * objSize]);
+		link->next = head;
+		head = link;
+	}
+
+	slabs++;
+	return true;
+}
+
+void SlabCache::refill(CPUCache& cache) {
+	{
+		lock::lock_guard guard(lock);
+		while (cache.count < CPU_CACHE_BATCH) {
+			if (head == nullptr && !grow())
+				break;
+
+			auto link = head;
+			head = head->next;
+
+			link->next = cache.head;
+			cache.head = link;
+			cache.count++;
+		}
+	}
+
+	cache.refills++;
+}
+
+void SlabCache::drain(CPUCache& cache) {
+	{
+		lock::lock_guard guard(lock);
+		for (size_t i = 0; i < CPU_CACHE_BATCH; i++) {
+			auto link = cache.head;
+			cache.head = link->next;
+			cache.count--;
+
+			link->next = head;
+			head = link;
+		}
+	}
+
+	cache.drains++;
+}
+
+void* SlabCache::alloc() {
+	/* Per-CPU free list is also used by interrupt handlers of this CPU */
+	lock::irqsave irq;
+
+	auto& cache = cpuCaches.get();
+	cache.allocs++;
+
+	if (cache.head == nullptr) {
+		refill(cache);
+	} else {
+		cache.hits++;
+	}
+
+	void* ret = nullptr;
+	if (cache.head != nullptr) {
+		ret = cache.head;
+		cache.head = cache.head->next;
+		cache.count--;
+	}
+
+	return ret;
+}
+
+void SlabCache::free(void* obj) {
+	if (obj == nullptr)
+		return;
+
+	/* Per-CPU free list is also used by interrupt handlers of this CPU */
+	lock::irqsave irq;
+
+	auto& cache = cpuCaches.get();
+	cache.frees++;
+
+	if (cache.count == CPU_CACHE_SIZE)
+		drain(cache);
+
+	auto link = reinterpret_cast<ObjectLink*>(obj);
+	link->next = cache.head;
+	cache.head = link;
+	cache.count++;
+}
+
+const char* SlabCache::getName() const {
+	return name;
+}
+
+SlabCache::Statistics SlabCache::getStatistics() const {
+	Statistics ret = {};
+	for (size_t i = 0; i < MAX_NUM_CPUS; i++) {
+		auto& cache = cpuCaches.get(i);
+		ret.allocs += cache.allocs;
+		ret.frees += cache.frees;
+		ret.hits += cache.hits;
+		ret.refills += cache.refills;
+		ret.drains += cache.drains;
+	}
+
+	ret.slabs = slabs;
+	ret.objects = slabs * ((static_cast<size_t>(PAGESIZE) << slabOrder) / objSize);
+
+	return ret;
+}
@@ -0,0 +1,212 @@
+#include <functional.h>
+#include <kernel/cpu.h>
+#include <kernel/config.h>
+#include <kernel/lock/guard.h>
+#include <kernel/mm/paging.h>
+#include <kernel/mm/tlb_shootdown.h>
+#include <kernel/thread/smp.h>
+#include <driver/drivers.h>
+
+using namespace mm;
+
+TLBShootdown::TLBShootdown() : useIPIs(TLB_SHOOTDOWN_IPI), shootdowns(0), local(0), broadcasts(0), ipis(0), coalesced(0), overflows(0) {
+	for (size_t i = 0; i < MAX_NUM_CPUS; i++) {
+		auto& queue = queues.get(i);
+		queue.count = 0;
+		queue.flushAll = false;
+		queue.pending = false;
+		queue.requested = 0;
+		queue.completed.store(0);
+	}
+}
+
+int TLBShootdown::init() {
+	if (!useIPIs)
+		return 0;
+
+	auto handler = []() -> int {
+		return tlbShootdown.process();
+	};
+
+	return driver::ipi.registerHandler(driver::IPI::IPI_MSG::TLB_SHOOTDOWN, lib::function<int()>(handler));
+}
+
+void TLBShootdown::invalidateLocal(uintptr_t start, size_t pages) {
+	if (pages > Paging::TLBI_THRESHOLD)
+		CPU::invalidateLocalTLB();
+	else
+		CPU::invalidateLocalPages(reinterpret_cast<void*>(start), pages);
+}
+
+void TLBShootdown::invalidateBroadcast(uintptr_t start, size_t pages) {
+	if (pages > Paging::TLBI_THRESHOLD)
+		CPU::invalidateTLB();
+	else
+		CPU::invalidatePages(reinterpret_cast<void*>(start), pages);
+}
+
+uint64_t TLBShootdown::enqueue(size_t cpuID, uintptr_t start, size_t pages, bool& sendIPI) {
+	auto& queue = queues.get(cpuID);
+
+	uint64_t ticket;
+	{
+		/* Queue is also locked by IPI handler */
+		lock::irqsave_guard guard(queue.lock);
+
+		if (!queue.flushAll) {
+			/* Merge with queued range if they overlap or touch */
+			bool merged = false;
+			for (size_t i = 0; i < queue.count && !merged; i++) {
+				auto& range = queue.ranges[i];
+				auto end = range.start + range.pages * PAGESIZE;
+				if (start > end || start + pages * PAGESIZE < range.start)
+					continue;
+
+				auto newStart = start < range.start ? start : range.start;
+				auto newEnd = start + pages * PAGESIZE > end ? start + pages * PAGESIZE : end;
+				range.start = newStart;
+				range.pages = (newEnd - newStart) / PAGESIZE;
+				merged = true;
+			}
+
+			/* Invalidate whole TLB if queue is full */
+			if (!merged && queue.count == QUEUE_SIZE) {
+				queue.flushAll = true;
+				queue.count = 0;
+				overflows.fetch_add(1, lib::memory_order_relaxed);
+
+			} else if (!merged) {
+				queue.ranges[queue.count++] = Range{start, pages};
+			}
+		}
+
+		ticket = ++queue.requested;
+
+		/* Piggyback on pending IPI */
+		sendIPI = !queue.pending;
+		queue.pending = true;
+	}
+
+	if (!sendIPI)
+		coalesced.fetch_add(1, lib::memory_order_relaxed);
+
+	return ticket;
+}
+
+void TLBShootdown::invalidate(const cpu_mask* cpus, void* vaddr, size_t size) {
+	auto start = reinterpret_cast<uintptr_t>(vaddr);
+	size_t pages = size / PAGESIZE;
+	if (pages == 0)
+		return;
+
+	shootdowns.fetch_add(1, lib::memory_order_relaxed);
+
+	bool enabled = CPU::areInterruptsEnabled();
+	CPU::disableInterrupts();
+
+	/* Check if other CPUs may cache translations of range */
+	auto cpuID = CPU::getProcessorID();
+	auto numCPUs = thread::smp.getRegisteredCPUS() + 1;
+	bool remote = false;
+	for (size_t i = 0; i < numCPUs && !remote; i++)
+		remote = i != cpuID && (cpus == nullptr || cpus->test(i));
+
+	if (!remote) {
+		invalidateLocal(start, pages);
+		local.fetch_add(1, lib::memory_order_relaxed);
+
+		if (enabled)
+			CPU::enableInterrupts();
+		return;
+	}
+
+	/* Waiting for other CPUs with disabled interrupts could deadlock */
+	if (!useIPIs || !enabled) {
+		invalidateBroadcast(start, pages);
+		broadcasts.fetch_add(1, lib::memory_order_relaxed);
+
+		if (enabled)
+			CPU::enableInterrupts();
+		return;
+	}
+
+	/* Invalidate locally */
+	if (cpus == nullptr || cpus->test(cpuID))
+		invalidateLocal(start, pages);
+
+	/* Sending IPIs requires enabled interrupts (mailbox waits for receiver) */
+	CPU::enableInterrupts();
+
+	/* Queue range for other CPUs (and send a single IPI per CPU) */
+	uint64_t tickets[MAX_NUM_CPUS];
+	for (size_t i = 0; i < numCPUs; i++) {
+		tickets[i] = 0;
+		if (i == cpuID || (cpus != nullptr && !cpus->test(i)))
+			continue;
+
+		bool sendIPI = false;
+		tickets[i] = enqueue(i, start, pages, sendIPI);
+		if (sendIPI) {
+			driver::ipi.sendIPI(i, driver::IPI::IPI_MSG::TLB_SHOOTDOWN);
+			ipis.fetch_add(1, lib::memory_order_relaxed);
+		}
+	}
+
+	/* Wait for other CPUs (while handling own queue, whose IPI might be postponed) */
+	for (size_t i = 0; i < numCPUs; i++) {
+		while (queues.get(i).completed.load() < tickets[i])
+			process();
+	}
+
+	if (!enabled)
+		CPU::disableInterrupts();
+}
+
+int TLBShootdown::process() {
+	lock::irqsave irq;
+
+	auto& queue = queues.get();
+
+	/* Take all queued ranges */
+	Range ranges[QUEUE_SIZE];
+	size_t count;
+	bool flushAll;
+	uint64_t ticket;
+	{
+		lock::lock_guard guard(queue.lock);
+
+		count = queue.count;
+		flushAll = queue.flushAll;
+		for (size_t i = 0; i < count; i++)
+			ranges[i] = queue.ranges[i];
+		ticket = queue.requested;
+
+		queue.count = 0;
+		queue.flushAll = false;
+		queue.pending = false;
+	}
+
+	/* Invalidate them locally */
+	if (flushAll) {
+		CPU::invalidateLocalTLB();
+
+	} else {
+		for (size_t i = 0; i < count; i++)
+			invalidateLocal(ranges[i].start, ranges[i].pages);
+	}
+
+	queue.completed.store(ticket);
+
+	return 0;
+}
+
+TLBShootdown::Statistics TLBShootdown::getStatistics() const {
+	Statistics stats;
+	stats.shootdowns = shootdowns.load(lib::memory_order_relaxed);
+	stats.local = local.load(lib::memory_order_relaxed);
+	stats.broadcasts = broadcasts.load(lib::memory_order_relaxed);
+	stats.ipis = ipis.load(lib::memory_order_relaxed);
+	stats.coalesced = coalesced.load(lib::memory_order_relaxed);
+	stats.overflows = overflows.load(lib::memory_order_relaxed);
+	return stats;
+}
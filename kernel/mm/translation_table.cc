@@ -50,9 +50,10 @@ int TranslationTable::reset(size_t entry) {
 void TranslationTable::setDefault() {
 	for (size_t i = 0; i < NUM_ENTRIES; i++) {
 		addr[i].value = 0;
-		addr[i].one = 1;
+		addr[i].type = 1;
 		addr[i].attrIndex = 1;
 		addr[i].ap = 1;
+		addr[i].sh = INNER_SHAREABLE;
 		addr[i].aF = 1;
 	}
 }
@@ -62,9 +63,10 @@ int TranslationTable::setDefault(size_t entry) {
 		return -EINVAL;
 
 	addr[entry].value = 0;
-	addr[entry].one = 1;
+	addr[entry].type = 1;
 	addr[entry].attrIndex = 1;
 	addr[entry].ap = 1;
+	addr[entry].sh = INNER_SHAREABLE;
 	addr[entry].aF = 1;
 	return 0;
 }
@@ -84,6 +86,36 @@ int TranslationTable::setPresentBit(size_t entry, bool present) {
 	return 0;
 }
 
+int TranslationTable::getBlockBit(size_t entry) const {
+	if (entry >= NUM_ENTRIES)
+		return -EINVAL;
+
+	return addr[entry].type ? 0 : 1;
+}
+
+int TranslationTable::setBlockBit(size_t entry, bool block) {
+	if (entry >= NUM_ENTRIES)
+		return -EINVAL;
+
+	addr[entry].type = block ? 0 : 1;
+	return 0;
+}
+
+uint64_t TranslationTable::getDescriptor(size_t entry) const {
+	if (entry >= NUM_ENTRIES)
+		return 0;
+
+	return addr[entry].value;
+}
+
+int TranslationTable::setDescriptor(size_t entry, uint64_t descriptor) {
+	if (entry >= NUM_ENTRIES)
+		return -EINVAL;
+
+	addr[entry].value = descriptor;
+	return 0;
+}
+
 int TranslationTable::getAttrIndex(size_t entry) const {
 	if (entry >= NUM_ENTRIES)
 		return -EINVAL;
@@ -0,0 +1,48 @@
+#include <cerrno.h>
+#include <kernel/config.h>
+#include <kernel/percpu.h>
+
+/* Per-CPU areas (zeroed like the rest of .bss) */
+alignas(4096) static uint8_t areas[MAX_NUM_CPUS][percpu::AREA_SIZE] __attribute__((section(".bss.percpu")));
+
+/* Number of allocated bytes per CPU (constant initialized, as slots are allocated by global constructors) */
+static size_t used = 0;
+
+/* Slots didn't fit into areas */
+static bool exhausted = false;
+
+size_t percpu::allocate(size_t size, size_t align) {
+	if (align < SLOT_ALIGN)
+		align = SLOT_ALIGN;
+
+	/* Round up offset and size to alignment (no other data shares a cache line with slot) */
+	size_t offset = (used + align - 1) & ~(align - 1);
+	size = (size + SLOT_ALIGN - 1) & ~(SLOT_ALIGN - 1);
+
+	if (offset + size > AREA_SIZE) {
+		exhausted = true;
+		return 0;
+	}
+
+	used = offset + size;
+	return offset;
+}
+
+uintptr_t percpu::getArea(size_t cpuID) {
+	return reinterpret_cast<uintptr_t>(areas[cpuID]);
+}
+
+void percpu::setBase(size_t cpuID) {
+	asm volatile("msr TPIDR_EL1, %0" :: "r"(getArea(cpuID)) : "memory");
+}
+
+int percpu::init() {
+	if (exhausted)
+		return -ENOMEM;
+
+	return 0;
+}
+
+size_t percpu::getUsed() {
+	return used;
+}
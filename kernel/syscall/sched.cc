@@ -0,0 +1,250 @@
+#include <cerrno.h>
+#include <kernel/error.h>
+#include <kernel/cpu.h>
+#include <kernel/config.h>
+#include <kernel/mm/paging.h>
+#include <kernel/mm/frame_allocator.h>
+#include <kernel/mm/address_space.h>
+#include <kernel/thread/context.h>
+#include <kernel/thread/scheduler.h>
+#include <kernel/syscall/sched.h>
+#include <kernel/syscall/syscall.h>
+#include <driver/cpu.h>
+#include <driver/drivers.h>
+
+long syscall::clone(void (*entry)()) {
+	auto addressSpace = thread::scheduler.current()->getAddressSpace();
+	if (addressSpace == nullptr)
+		return -EINVAL;
+
+	/* Entry must be accessible by user */
+	if (!isReadable(reinterpret_cast<void*>(entry), sizeof(uint32_t)))
+		return -EFAULT;
+
+	auto id = thread::scheduler.allocateID();
+	auto offset = (2 * id + 1) * STACK_SIZE;
+	if (offset > mm::Paging::USER_SPACE_END - mm::Paging::USER_SPACE_START)
+		return -ENOMEM;
+
+	/* User stack is populated on demand */
+	void* userStack = reinterpret_cast<void*>(mm::Paging::USER_SPACE_END - offset);
+	if (isError(addressSpace->addArea(userStack, STACK_SIZE, mm::Paging::USER_MAPPING, mm::Paging::WRITABLE)))
+		return -ENOMEM;
+
+	void* kernelStack = mm::frameAlloc.allocPages(mm::FrameAllocator::sizeToOrder(STACK_SIZE));
+	if (kernelStack == nullptr) {
+		addressSpace->removeArea(userStack);
+		return -ENOMEM;
+	}
+
+	auto thread = new thread::Context;
+	if (thread == nullptr) {
+		mm::frameAlloc.freePages(kernelStack);
+		addressSpace->removeArea(userStack);
+		return -ENOMEM;
+	}
+
+	thread->init(id, kernelStack, userStack, false, reinterpret_cast<void*>(entry));
+	thread->setAddressSpace(addressSpace);
+	thread::scheduler.ready(thread);
+
+	return static_cast<long>(id);
+}
+
+void syscall::__clone(irq::ExceptionContext* irq) {
+	/* Get values */
+	auto entry = syscall::getSyscallArg<0, void (*)()>(irq);
+
+	/* Save return value */
+	syscall::setSyscallRetValue(irq, clone(entry));
+}
+
+void syscall::exit() {
+	auto thread = thread::scheduler.current();
+
+	/* User stack isn't used any more (thread continues on its kernel stack) */
+	auto addressSpace = thread->getAddressSpace();
+	if (addressSpace != nullptr)
+		addressSpace->removeArea(thread->getUserStack());
+
+	thread::scheduler.requestExit();
+}
+
+void syscall::__exit(irq::ExceptionContext* irq) {
+	(void) irq;
+
+	exit();
+}
+
+void syscall::__sched_yield(irq::ExceptionContext* irq) {
+	thread::scheduler.requestReschedule();
+
+	/* Save return value */
+	syscall::setSyscallRetValue(irq, 0);
+}
+
+long syscall::nanosleep(const timespec* req) {
+	if (req->tv_sec < 0 || req->tv_nsec < 0 || req->tv_nsec >= 1000000000)
+		return -EINVAL;
+
+	/* Convert to system counter ticks */
+	auto frequency = CPU::getSystemCounterFrequency();
+	auto ticks = static_cast<uint64_t>(req->tv_sec) * frequency;
+	ticks += static_cast<uint64_t>(req->tv_nsec) * (frequency / 1000) / 1000000;
+
+	if (ticks == 0)
+		return 0;
+
+	thread::scheduler.requestSleep(CPU::getSystemCounter() + ticks);
+	return 0;
+}
+
+void syscall::__nanosleep(irq::ExceptionContext* irq) {
+	/* Get values */
+	auto req = syscall::getSyscallArg<0, const timespec*>(irq);
+
+	/* Check permissions */
+	long ret = -EFAULT;
+	if (syscall::isReadable(req, sizeof(*req)))
+		ret = nanosleep(req);
+
+	/* Save return value */
+	syscall::setSyscallRetValue(irq, ret);
+}
+
+long syscall::getpriority(int which, size_t who) {
+	if (which != PRIO_PROCESS)
+		return -EINVAL;
+
+	/* Only the calling thread is supported */
+	if (who != 0 && who != thread::scheduler.current()->getID())
+		return -ESRCH;
+
+	return 20 - thread::scheduler.getNice();
+}
+
+void syscall::__getpriority(irq::ExceptionContext* irq) {
+	/* Get values */
+	auto which = syscall::getSyscallArg<0, int>(irq);
+	auto who = syscall::getSyscallArg<1, size_t>(irq);
+
+	/* Save return value */
+	syscall::setSyscallRetValue(irq, getpriority(which, who));
+}
+
+long syscall::setpriority(int which, size_t who, int nice) {
+	if (which != PRIO_PROCESS)
+		return -EINVAL;
+
+	/* Only the calling thread is supported */
+	if (who != 0 && who != thread::scheduler.current()->getID())
+		return -ESRCH;
+
+	/* Out of range values are clamped (like Linux) */
+	if (nice < thread::FairQueue::NICE_MIN)
+		nice = thread::FairQueue::NICE_MIN;
+	if (nice > thread::FairQueue::NICE_MAX)
+		nice = thread::FairQueue::NICE_MAX;
+
+	return thread::scheduler.setNice(nice);
+}
+
+void syscall::__setpriority(irq::ExceptionContext* irq) {
+	/* Get values */
+	auto which = syscall::getSyscallArg<0, int>(irq);
+	auto who = syscall::getSyscallArg<1, size_t>(irq);
+	auto nice = syscall::getSyscallArg<2, int>(irq);
+
+	/* Save return value */
+	syscall::setSyscallRetValue(irq, setpriority(which, who, nice));
+}
+
+long syscall::sched_setscheduler(size_t pid, int policy, const sched_param* param) {
+	/* Only the calling thread is supported */
+	if (pid != 0 && pid != thread::scheduler.current()->getID())
+		return -ESRCH;
+
+	if (policy != static_cast<int>(thread::Policy::NORMAL) && policy != static_cast<int>(thread::Policy::FIFO) &&
+			policy != static_cast<int>(thread::Policy::RR))
+		return -EINVAL;
+
+	return thread::scheduler.setPolicy(static_cast<thread::Policy>(policy), param->sched_priority);
+}
+
+void syscall::__sched_setscheduler(irq::ExceptionContext* irq) {
+	/* Get values */
+	auto pid = syscall::getSyscallArg<0, size_t>(irq);
+	auto policy = syscall::getSyscallArg<1, int>(irq);
+	auto param = syscall::getSyscallArg<2, const sched_param*>(irq);
+
+	/* Check permissions */
+	long ret = -EFAULT;
+	if (syscall::isReadable(param, sizeof(*param)))
+		ret = sched_setscheduler(pid, policy, param);
+
+	/* Save return value */
+	syscall::setSyscallRetValue(irq, ret);
+}
+
+long syscall::sched_getscheduler(size_t pid) {
+	auto thread = thread::scheduler.current();
+
+	/* Only the calling thread is supported */
+	if (pid != 0 && pid != thread->getID())
+		return -ESRCH;
+
+	return static_cast<long>(thread->getPolicy());
+}
+
+void syscall::__sched_getscheduler(irq::ExceptionContext* irq) {
+	/* Get values */
+	auto pid = syscall::getSyscallArg<0, size_t>(irq);
+
+	/* Save return value */
+	syscall::setSyscallRetValue(irq, sched_getscheduler(pid));
+}
+
+long syscall::sched_stats(size_t cpuID, thread::Scheduler::Statistics* stats) {
+	if (cpuID >= driver::cpus.numCPUs())
+		return -EINVAL;
+
+	*stats = thread::scheduler.getStatistics(cpuID);
+	return 0;
+}
+
+void syscall::__sched_stats(irq::ExceptionContext* irq) {
+	/* Get values */
+	auto cpuID = syscall::getSyscallArg<0, size_t>(irq);
+	auto stats = syscall::getSyscallArg<1, thread::Scheduler::Statistics*>(irq);
+
+	/* Check permissions */
+	long ret = -EFAULT;
+	if (syscall::isWritable(stats, sizeof(*stats)))
+		ret = sched_stats(cpuID, stats);
+
+	/* Save return value */
+	syscall::setSyscallRetValue(irq, ret);
+}
+
+long syscall::sched_wakeup_latency(int which) {
+	auto current = thread::scheduler.current();
+
+	switch (which) {
+		case WAKEUP_LATENCY_DEADLINE:
+			return static_cast<long>(current->getDeadlineLatency());
+
+		case WAKEUP_LATENCY_READY:
+			return static_cast<long>(current->getWakeLatency());
+
+		default:
+			return -EINVAL;
+	}
+}
+
+void syscall::__sched_wakeup_latency(irq::ExceptionContext* irq) {
+	/* Get values */
+	auto which = syscall::getSyscallArg<0, int>(irq);
+
+	/* Save return value */
+	syscall::setSyscallRetValue(irq, sched_wakeup_latency(which));
+}
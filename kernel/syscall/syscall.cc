@@ -1,6 +1,7 @@
 #include <climits.h>
 #include <kernel/math.h>
 #include <kernel/mm/paging.h>
+#include <kernel/mm/address_space.h>
 #include <kernel/syscall/syscall.h>
 
 bool syscall::isReadable(const void* buf, size_t size) {
@@ -12,7 +13,41 @@ bool syscall::isReadable(const void* buf, size_t size) {
 
 	/* Check pagewise if readable */
 	for (auto i = start; i < stop; i += PAGESIZE) {
-		if (!mm::Paging::isReadableUser(reinterpret_cast<void*>(i)))
+		if (mm::Paging::isReadableUser(reinterpret_cast<void*>(i)))
+			continue;
+
+		/* Populate demand-paged memory (which was not touched by user yet) */
+		auto addressSpace = mm::AddressSpace::getActive();
+		if (addressSpace == nullptr)
+			return false;
+
+		auto page = reinterpret_cast<void*>(i);
+		if (addressSpace->handleFault(page, mm::AddressSpace::Access::READ, true) != 0 || !mm::Paging::isReadableUser(page))
+			return false;
+	}
+
+	return true;
+}
+
+bool syscall::isWritable(void* buf, size_t size) {
+	/* Get start and stop */
+	auto start = (uintptr_t) buf;
+	auto stop = start + size;
+	start = math::roundDown(start, PAGESIZE);
+	stop = math::roundUp(stop, PAGESIZE);
+
+	/* Check pagewise if writable */
+	for (auto i = start; i < stop; i += PAGESIZE) {
+		if (mm::Paging::isWritableUser(reinterpret_cast<void*>(i)))
+			continue;
+
+		/* Populate demand-paged memory (which was not touched by user yet) */
+		auto addressSpace = mm::AddressSpace::getActive();
+		if (addressSpace == nullptr)
+			return false;
+
+		auto page = reinterpret_cast<void*>(i);
+		if (addressSpace->handleFault(page, mm::AddressSpace::Access::WRITE, true) != 0 || !mm::Paging::isWritableUser(page))
 			return false;
 	}
 
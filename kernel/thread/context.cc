@@ -2,6 +2,8 @@
 #include <cstring.h>
 #include <kernel/math.h>
 #include <kernel/config.h>
+#include <kernel/lock/rcu.h>
+#include <kernel/mm/frame_allocator.h>
 #include <kernel/thread/context.h>
 #include <kernel/irq/exception_handler.h>
 
@@ -10,7 +12,7 @@ using namespace thread;
 extern "C" void __context_switch(SavedContext* old, SavedContext* next);
 extern "C" void restore_current_el_sp_el0_sync_entry();
 
-Context::Context() : id(0), kernelStack(nullptr), userStack(nullptr), state(State::INVALID) { }
+Context::Context() : id(0), kernelStack(nullptr), userStack(nullptr), state(State::INVALID), savedContext(), exceptionContext(nullptr), addressSpace(nullptr), cpu(0), fairNode(), nice(0), weight(FairQueue::NICE_0_WEIGHT), execStart(0), runStart(0), policy(Policy::NORMAL), rtPriority(0), rtNext(nullptr), rtPrev(nullptr), rtSlice(0), yielded(false), sleepTimer(), wakeAt(0), wakeTime(0), wakeLatency(0), wakeDeadline(0), deadlineLatency(0), lastRun(0) { }
 
 void Context::init(size_t id, void* kernelStack, void* userStack, bool kernel, void* retAddr) {
 	this->id = id;
@@ -55,8 +57,7 @@ void Context::init(size_t id, void* kernelStack, void* userStack, bool kernel, v
 }
 
 Context::~Context() {
-	lib::free(kernelStack);
-	lib::free(userStack);
+	mm::frameAlloc.freePages(kernelStack);
 }
 
 
@@ -64,6 +65,26 @@ size_t Context::getID() const {
 	return id;
 }
 
+void* Context::getUserStack() const {
+	return userStack;
+}
+
+Policy Context::getPolicy() const {
+	return policy;
+}
+
+int Context::getPriority() const {
+	return rtPriority;
+}
+
+uint64_t Context::getWakeLatency() const {
+	return wakeLatency;
+}
+
+uint64_t Context::getDeadlineLatency() const {
+	return deadlineLatency;
+}
+
 void Context::setState(State state) {
 	this->state = state;
 }
@@ -80,6 +101,29 @@ irq::ExceptionContext* Context::getExceptionContext() const {
 	return exceptionContext;
 }
 
+void Context::setAddressSpace(mm::AddressSpace* addressSpace) {
+	this->addressSpace = addressSpace;
+}
+
+mm::AddressSpace* Context::getAddressSpace() const {
+	return addressSpace;
+}
+
 void Context::switching(Context* old, Context* next) {
+	/* References to RCU protected data must not be kept across context switches */
+	lock::rcu.quiescentState();
+
+	/* Only a write of TTBR0 (user mappings are tagged with ASIDs) */
+	if (old->addressSpace != next->addressSpace) {
+		if (next->addressSpace != nullptr)
+			next->addressSpace->activate();
+		else
+			mm::AddressSpace::activateKernel();
+	}
+
+	/* Next thread might still be saved by the CPU which executed it before */
+	while (__atomic_load_n(&next->savedContext.onCPU, __ATOMIC_ACQUIRE) != 0);
+	next->savedContext.onCPU = 1;
+
 	__context_switch(&old->savedContext, &next->savedContext);
 }
@@ -0,0 +1,108 @@
+#include <cassert.h>
+#include <kernel/thread/context.h>
+#include <kernel/thread/fair_queue.h>
+
+using namespace thread;
+
+/* Weights of nice levels -20 to 19 (a level differs by a factor of ~1.25) */
+static const uint32_t weights[] = {
+	/* -20 */ 88761, 71755, 56483, 46273, 36291,
+	/* -15 */ 29154, 23254, 18705, 14949, 11916,
+	/* -10 */  9548,  7620,  6100,  4904,  3906,
+	/*  -5 */  3121,  2501,  1991,  1586,  1277,
+	/*   0 */  1024,   820,   655,   526,   423,
+	/*   5 */   335,   272,   215,   172,   137,
+	/*  10 */   110,    87,    70,    56,    45,
+	/*  15 */    36,    29,    23,    18,    15,
+};
+
+FairQueue::FairQueue() : minVruntime(0), totalWeight(0) { }
+
+uint32_t FairQueue::niceToWeight(int nice) {
+	assert(nice >= NICE_MIN && nice <= NICE_MAX);
+	return weights[nice - NICE_MIN];
+}
+
+void FairQueue::charge(Context* thread, uint64_t delta) {
+	if (thread->weight == NICE_0_WEIGHT)
+		thread->fairNode.t.vruntime += delta;
+	else
+		thread->fairNode.t.vruntime += delta * NICE_0_WEIGHT / thread->weight;
+}
+
+void FairQueue::enqueue(Context* thread) {
+	thread->fairNode.t.thread = thread;
+	tree.insert(&thread->fairNode);
+	totalWeight += thread->weight;
+}
+
+void FairQueue::dequeue(Context* thread) {
+	tree.remove(&thread->fairNode);
+	totalWeight -= thread->weight;
+}
+
+Context* FairQueue::first() {
+	auto node = tree.first();
+	return node != nullptr ? node->t.thread : nullptr;
+}
+
+Context* FairQueue::last() {
+	auto node = tree.last();
+	return node != nullptr ? node->t.thread : nullptr;
+}
+
+Context* FairQueue::prev(Context* thread) {
+	auto node = thread->fairNode.prev();
+	return node != nullptr ? node->t.thread : nullptr;
+}
+
+void FairQueue::update(Context* current) {
+	auto vruntime = minVruntime;
+	bool valid = false;
+
+	if (current != nullptr) {
+		vruntime = current->fairNode.t.vruntime;
+		valid = true;
+	}
+
+	auto leftmost = tree.first();
+	if (leftmost != nullptr) {
+		if (!valid || static_cast<int64_t>(leftmost->t.vruntime - vruntime) < 0)
+			vruntime = leftmost->t.vruntime;
+		valid = true;
+	}
+
+	/* Never move backwards (otherwise threads placed meanwhile would gain) */
+	if (valid && static_cast<int64_t>(vruntime - minVruntime) > 0)
+		minVruntime = vruntime;
+}
+
+void FairQueue::place(Context* thread, bool wakeup, uint64_t credit) {
+	auto earliest = minVruntime;
+	if (wakeup)
+		earliest -= credit;
+
+	auto& vruntime = thread->fairNode.t.vruntime;
+	if (static_cast<int64_t>(vruntime - earliest) < 0)
+		vruntime = earliest;
+}
+
+void FairQueue::detach(Context* thread) {
+	thread->fairNode.t.vruntime -= minVruntime;
+}
+
+void FairQueue::attach(Context* thread) {
+	thread->fairNode.t.vruntime += minVruntime;
+}
+
+uint64_t FairQueue::getMinVruntime() const {
+	return minVruntime;
+}
+
+size_t FairQueue::size() const {
+	return tree.size();
+}
+
+uint64_t FairQueue::getTotalWeight() const {
+	return totalWeight;
+}
@@ -2,17 +2,37 @@
 #include <cstdlib.h>
 #include <kernel/cpu.h>
 #include <kernel/config.h>
+#include <kernel/lock/rcu.h>
+#include <kernel/mm/frame_allocator.h>
 #include <kernel/thread/idle.h>
+#include <kernel/time/timer_wheel.h>
+#include <driver/drivers.h>
 
 using namespace thread;
 
 extern "C" void thread::idle() {
-	while(1)
+	while(1) {
+		/* Idle loop holds no references to RCU protected data */
+		lock::rcu.quiescentState();
+
+#if NO_HZ
+		/* Stop tick until next timer expires (restarted when leaving the idle thread) */
+		CPU::disableInterrupts();
+		if (lock::rcu.needsTick()) {
+			driver::timer.restartTick();
+		} else {
+			driver::timer.stopTick(time::timerWheel.nextExpiry());
+			lock::rcu.enterIdle();
+		}
+		CPU::enableInterrupts();
+#endif
+
 		CPU::halt();
+	}
 }
 
 int IdleThreads::init() {
-	char** stacks = (char**) new char[STACK_SIZE];
+	void* stacks = mm::frameAlloc.allocPages(mm::FrameAllocator::sizeToOrder(STACK_SIZE));
 	if (stacks == nullptr)
 		return -ENOMEM;
 
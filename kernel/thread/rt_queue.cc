@@ -0,0 +1,96 @@
+#include <cassert.h>
+#include <kernel/utility.h>
+#include <kernel/thread/context.h>
+#include <kernel/thread/rt_queue.h>
+
+using namespace thread;
+
+RtQueue::RtQueue() : count(0) {
+	for (size_t i = 0; i < NUM_WORDS; i++)
+		bitmap[i] = 0;
+
+	for (size_t i = 0; i < NUM_PRIORITIES; i++) {
+		heads[i] = nullptr;
+		tails[i] = nullptr;
+	}
+}
+
+void RtQueue::enqueue(Context* thread, bool head) {
+	auto prio = thread->rtPriority;
+	assert(prio >= MIN_PRIORITY && prio <= MAX_PRIORITY);
+
+	if (heads[prio] == nullptr) {
+		thread->rtNext = nullptr;
+		thread->rtPrev = nullptr;
+		heads[prio] = thread;
+		tails[prio] = thread;
+		bitmap[prio / 64] |= static_cast<uint64_t>(1) << (prio % 64);
+	} else if (head) {
+		thread->rtNext = heads[prio];
+		thread->rtPrev = nullptr;
+		heads[prio]->rtPrev = thread;
+		heads[prio] = thread;
+	} else {
+		thread->rtNext = nullptr;
+		thread->rtPrev = tails[prio];
+		tails[prio]->rtNext = thread;
+		tails[prio] = thread;
+	}
+
+	count++;
+}
+
+void RtQueue::dequeue(Context* thread) {
+	auto prio = thread->rtPriority;
+
+	if (thread->rtPrev == nullptr)
+		heads[prio] = thread->rtNext;
+	else
+		thread->rtPrev->rtNext = thread->rtNext;
+
+	if (thread->rtNext == nullptr)
+		tails[prio] = thread->rtPrev;
+	else
+		thread->rtNext->rtPrev = thread->rtPrev;
+
+	thread->rtNext = nullptr;
+	thread->rtPrev = nullptr;
+
+	if (heads[prio] == nullptr)
+		bitmap[prio / 64] &= ~(static_cast<uint64_t>(1) << (prio % 64));
+
+	assert(count > 0);
+	count--;
+}
+
+int RtQueue::highestPriority() const {
+	for (size_t i = NUM_WORDS; i > 0; i--) {
+		if (bitmap[i - 1] != 0)
+			return static_cast<int>((i - 1) * 64) + util::fls(bitmap[i - 1]);
+	}
+
+	return -1;
+}
+
+int RtQueue::lowestPriority() const {
+	for (size_t i = 0; i < NUM_WORDS; i++) {
+		if (bitmap[i] != 0)
+			return static_cast<int>(i * 64) + util::ffs(bitmap[i]);
+	}
+
+	return -1;
+}
+
+Context* RtQueue::first() const {
+	auto prio = highestPriority();
+	return prio >= 0 ? heads[prio] : nullptr;
+}
+
+Context* RtQueue::last() const {
+	auto prio = lowestPriority();
+	return prio >= 0 ? tails[prio] : nullptr;
+}
+
+size_t RtQueue::size() const {
+	return count;
+}
@@ -0,0 +1,667 @@
+#include <cerrno.h>
+#include <cassert.h>
+#include <functional.h>
+#include <kernel/cpu.h>
+#include <kernel/config.h>
+#include <kernel/debug/panic.h>
+#include <kernel/lock/guard.h>
+#include <kernel/lock/softirq.h>
+#include <kernel/thread/idle.h>
+#include <kernel/thread/scheduler.h>
+#include <driver/cpu.h>
+#include <driver/drivers.h>
+
+using namespace thread;
+
+Scheduler::Scheduler() : latency(0), minGranularity(0), wakeupGranularity(0), rrTimeslice(0), migrationCost(0), nextID(1) {
+	for (size_t i = 0; i < MAX_NUM_CPUS; i++) {
+		auto& queue = queues.get(i);
+		queue.length.store(0);
+		queue.current = nullptr;
+		queue.priority.store(0);
+		queue.idle = nullptr;
+		queue.dead = nullptr;
+		queue.needResched = false;
+		queue.preemptCount = 0;
+		queue.ticks = 0;
+		queue.idleStart = 0;
+		queue.idleTime = 0;
+		queue.switches = 0;
+		queue.steals = 0;
+		queue.migrations = 0;
+	}
+}
+
+int Scheduler::init() {
+	auto interval = driver::timer.interval();
+	if (interval == 0)
+		return -EINVAL;
+
+	auto ticksPerUs = CPU::getSystemCounterFrequency() / 1000000;
+	latency = LATENCY_US * ticksPerUs;
+	minGranularity = MIN_GRANULARITY_US * ticksPerUs;
+	wakeupGranularity = WAKEUP_GRANULARITY_US * ticksPerUs;
+	rrTimeslice = RR_TIMESLICE_US * ticksPerUs;
+	migrationCost = MIGRATION_COST_US * ticksPerUs;
+
+	auto tick = []() -> int {
+		return scheduler.tick();
+	};
+
+	/* Timer wheel of each CPU ticks scheduler */
+	int id = driver::timer.registerFunction(interval, lib::function<int()>(tick));
+	return id < 0 ? id : 0;
+}
+
+size_t Scheduler::allocateID() {
+	return nextID.fetch_add(1);
+}
+
+int Scheduler::rank(const RunQueue& queue, const Context* thread) {
+	if (thread == nullptr || thread == queue.idle)
+		return 0;
+
+	return thread->policy == Policy::NORMAL ? 1 : 1 + thread->rtPriority;
+}
+
+void Scheduler::enqueue(RunQueue& queue, Context* thread, bool head) {
+	if (thread->policy == Policy::NORMAL)
+		queue.fair.enqueue(thread);
+	else
+		queue.rt.enqueue(thread, head);
+
+	queue.length.fetch_add(1, lib::memory_order_relaxed);
+}
+
+Context* Scheduler::dequeue(RunQueue& queue) {
+	/* Real-time threads run before all fair-share threads */
+	auto thread = queue.rt.first();
+	if (thread != nullptr) {
+		queue.rt.dequeue(thread);
+	} else {
+		thread = queue.fair.first();
+		if (thread == nullptr)
+			return nullptr;
+
+		queue.fair.dequeue(thread);
+	}
+
+	queue.length.fetch_sub(1, lib::memory_order_relaxed);
+	return thread;
+}
+
+void Scheduler::updateCurrent(RunQueue& queue, uint64_t now) {
+	auto current = queue.current;
+	if (current == nullptr || current == queue.idle) {
+		queue.fair.update(nullptr);
+		return;
+	}
+
+	auto delta = now - current->execStart;
+	current->execStart = now;
+
+	/* Real-time threads don't gain virtual runtime, RR threads use up their time slice */
+	if (current->policy == Policy::NORMAL) {
+		FairQueue::charge(current, delta);
+		queue.fair.update(current);
+		return;
+	}
+
+	if (current->policy == Policy::RR)
+		current->rtSlice = delta < current->rtSlice ? current->rtSlice - delta : 0;
+	queue.fair.update(nullptr);
+}
+
+uint64_t Scheduler::idealRuntime(RunQueue& queue, Context* thread) const {
+	auto running = queue.fair.size() + 1;
+
+	/* Period is stretched if threads would run less than minGranularity */
+	auto period = latency;
+	if (running * minGranularity > period)
+		period = running * minGranularity;
+
+	return period * thread->weight / (queue.fair.getTotalWeight() + thread->weight);
+}
+
+size_t Scheduler::getLoad(size_t cpuID) const {
+	auto& queue = queues.get(cpuID);
+
+	/* Running thread (except the idle thread) counts as load */
+	auto current = __atomic_load_n(&queue.current, __ATOMIC_RELAXED);
+	auto load = queue.length.load(lib::memory_order_relaxed);
+	if (current != nullptr && current != queue.idle)
+		load++;
+
+	return load;
+}
+
+size_t Scheduler::selectCPU(const Context* thread) const {
+	auto numCPUs = driver::cpus.numCPUs();
+	auto local = CPU::getProcessorID();
+
+	/* Real-time threads prefer the CPU running the least important thread (then the lowest load) */
+	bool realtime = (thread->policy != Policy::NORMAL);
+
+	/* Prefer local CPU on ties (starting with its queue) */
+	size_t best = local;
+	int bestRank = 0;
+	size_t bestLoad = ~static_cast<size_t>(0);
+	for (size_t i = 0; i < numCPUs; i++) {
+		auto cpuID = (local + i) % numCPUs;
+		auto load = getLoad(cpuID);
+		auto rank = realtime ? queues.get(cpuID).priority.load(lib::memory_order_relaxed) : 0;
+		if (bestLoad == ~static_cast<size_t>(0) || rank < bestRank || (rank == bestRank && load < bestLoad)) {
+			best = cpuID;
+			bestRank = rank;
+			bestLoad = load;
+		}
+	}
+
+	return best;
+}
+
+size_t Scheduler::findBusiest(size_t cpuID, size_t& load) const {
+	auto numCPUs = driver::cpus.numCPUs();
+
+	/* Loads are read without locks (a stale value only misguides a single attempt) */
+	size_t busiest = cpuID;
+	load = 0;
+	for (size_t i = 1; i < numCPUs; i++) {
+		auto victim = (cpuID + i) % numCPUs;
+		auto victimLoad = getLoad(victim);
+		if (victimLoad > load) {
+			busiest = victim;
+			load = victimLoad;
+		}
+	}
+
+	return busiest;
+}
+
+Context* Scheduler::stealFrom(size_t victim, bool hot) {
+	auto& queue = queues.get(victim);
+	auto now = CPU::getSystemCounter();
+
+	lock::lock_guard guard(queue.lock);
+
+	/* Cache-hot threads are only taken from queues with several waiting threads */
+	bool takeHot = hot && queue.length.load(lib::memory_order_relaxed) > 1;
+
+	/* Real-time threads waiting behind a running one are taken by idle CPUs first (regardless of cache) */
+	auto thread = hot ? queue.rt.last() : nullptr;
+	if (thread != nullptr) {
+		queue.rt.dequeue(thread);
+	} else {
+		/* Search from largest virtual runtime (leftmost thread stays) for a cache-cold thread */
+		thread = queue.fair.last();
+		while (thread != nullptr && !takeHot && now - thread->lastRun < migrationCost)
+			thread = queue.fair.prev(thread);
+
+		if (thread == nullptr)
+			return nullptr;
+
+		queue.fair.dequeue(thread);
+	}
+
+	queue.fair.detach(thread);
+	queue.length.fetch_sub(1, lib::memory_order_relaxed);
+	return thread;
+}
+
+Context* Scheduler::steal(size_t cpuID) {
+	size_t load;
+	auto victim = findBusiest(cpuID, load);
+
+	/* Only threads waiting in a run queue can be stolen */
+	if (victim == cpuID || queues.get(victim).length.load(lib::memory_order_relaxed) == 0)
+		return nullptr;
+
+	auto thread = stealFrom(victim, true);
+	if (thread != nullptr)
+		queues.get(cpuID).steals++;
+
+	return thread;
+}
+
+void Scheduler::balance(size_t cpuID) {
+	size_t load;
+	auto victim = findBusiest(cpuID, load);
+
+	/* Moving a thread must reduce the imbalance */
+	if (victim == cpuID || load < getLoad(cpuID) + 2)
+		return;
+
+	auto thread = stealFrom(victim, false);
+	if (thread == nullptr)
+		return;
+
+	auto& queue = queues.get(cpuID);
+	lock::lock_guard guard(queue.lock);
+	thread->cpu = cpuID;
+	queue.fair.attach(thread);
+	enqueue(queue, thread);
+	queue.migrations++;
+
+	if (queue.current == queue.idle)
+		queue.needResched = true;
+}
+
+void Scheduler::kickIdle(size_t cpuID) {
+	if (queues.get(cpuID).length.load(lib::memory_order_relaxed) == 0)
+		return;
+
+	/* Idle CPUs with a stopped tick don't steal on their own (a single one is woken up) */
+	auto numCPUs = driver::cpus.numCPUs();
+	for (size_t i = 1; i < numCPUs; i++) {
+		auto victim = (cpuID + i) % numCPUs;
+		if (driver::timer.isTickStopped(victim)) {
+			driver::ipi.sendIPI(victim, driver::IPI::IPI_MSG::RESCHEDULE);
+			return;
+		}
+	}
+}
+
+void Scheduler::ready(Context* thread) {
+	assert(thread->state == State::CREATED || thread->state == State::WAITING);
+
+	auto cpuID = selectCPU(thread);
+	auto& queue = queues.get(cpuID);
+	auto now = CPU::getSystemCounter();
+
+	bool preempt = false;
+	{
+		lock::irqsave_guard guard(queue.lock);
+
+		/* Virtual runtime of new and waiting threads is relative */
+		bool wakeup = (thread->state == State::WAITING);
+		queue.fair.attach(thread);
+		queue.fair.place(thread, wakeup, latency / 2);
+
+		thread->cpu = cpuID;
+		thread->state = State::READY;
+		thread->wakeTime = now;
+		enqueue(queue, thread);
+
+		/* Current thread is updated under lock, hence an idle CPU can't miss thread */
+		auto current = queue.current;
+		if (current == queue.idle) {
+			preempt = true;
+		} else if (current != nullptr && thread->policy != Policy::NORMAL) {
+			/* Real-time threads preempt less important threads immediately */
+			preempt = (rank(queue, thread) > rank(queue, current));
+		} else if (current != nullptr && current->policy == Policy::NORMAL) {
+			/* Preempt if thread received considerably less (weighted) service */
+			updateCurrent(queue, now);
+			auto granularity = wakeupGranularity * FairQueue::NICE_0_WEIGHT / thread->weight;
+			auto delta = static_cast<int64_t>(current->fairNode.t.vruntime - thread->fairNode.t.vruntime);
+			preempt = (delta > static_cast<int64_t>(granularity));
+		}
+
+		if (preempt)
+			queue.needResched = true;
+	}
+
+	/* Reschedule is performed on return from the interrupt sent to a remote CPU */
+	if (preempt && cpuID != CPU::getProcessorID())
+		driver::ipi.sendIPI(cpuID, driver::IPI::IPI_MSG::RESCHEDULE);
+}
+
+void Scheduler::sleep(Context* thread) {
+	/* Timer of current CPU (expires after thread left the CPU) */
+	auto now = CPU::getSystemCounter();
+	size_t ticks = thread->wakeAt > now ? time::timerWheel.toTicks(thread->wakeAt - now) : 0;
+
+	thread->sleepTimer.func = wakeup;
+	thread->sleepTimer.data = thread;
+	time::timerWheel.add(&thread->sleepTimer, ticks);
+}
+
+void Scheduler::wakeup(time::timer_head* timer) {
+	auto thread = static_cast<Context*>(timer->data);
+
+	/* Ticks aren't aligned to the system counter (tick might precede wakeup time) */
+	if (CPU::getSystemCounter() < thread->wakeAt) {
+		time::timerWheel.add(timer, 1);
+		return;
+	}
+
+	thread->wakeDeadline = thread->wakeAt;
+	thread->wakeAt = 0;
+	scheduler.ready(thread);
+}
+
+void Scheduler::schedule() {
+	assert(CPU::areInterruptsEnabled() == false);
+
+	auto cpuID = CPU::getProcessorID();
+	auto& queue = queues.get();
+
+	/* Thread terminated before last switch doesn't use its stack any more */
+	if (queue.dead != nullptr) {
+		delete queue.dead;
+		queue.dead = nullptr;
+	}
+
+	auto now = CPU::getSystemCounter();
+	auto prev = queue.current;
+	Context* next;
+	{
+		lock::lock_guard guard(queue.lock);
+
+		/* Running thread is requeued (the idle thread is never queued) */
+		updateCurrent(queue, now);
+		prev->lastRun = now;
+		if (prev->state == State::RUNNING) {
+			/* Preempted real-time threads stay in front of their priority */
+			prev->state = State::READY;
+			if (prev != queue.idle)
+				enqueue(queue, prev, prev->policy != Policy::NORMAL && !prev->yielded);
+		} else if (prev->state == State::WAITING) {
+			/* Waiting thread might be woken up on another CPU */
+			queue.fair.detach(prev);
+
+			/* Thread is only woken up after it left the CPU */
+			if (prev->wakeAt != 0)
+				sleep(prev);
+		}
+		prev->yielded = false;
+
+		next = dequeue(queue);
+	}
+
+	/* Steal from other CPUs before becoming idle (without holding own lock) */
+	if (next == nullptr) {
+		next = steal(cpuID);
+		if (next != nullptr) {
+			lock::lock_guard guard(queue.lock);
+			queue.fair.attach(next);
+		}
+	}
+
+	{
+		lock::lock_guard guard(queue.lock);
+
+		/* Thread might have been placed on this CPU while stealing */
+		if (next == nullptr)
+			next = dequeue(queue);
+		if (next == nullptr)
+			next = queue.idle;
+
+		next->state = State::RUNNING;
+		next->cpu = cpuID;
+		next->execStart = now;
+		next->runStart = now;
+		if (next->wakeTime != 0) {
+			auto running = CPU::getSystemCounter();
+			next->wakeLatency = running - next->wakeTime;
+			next->wakeTime = 0;
+
+			/* Sleepers also account the delay until their timer expired */
+			next->deadlineLatency = next->wakeDeadline != 0 ? running - next->wakeDeadline : next->wakeLatency;
+			next->wakeDeadline = 0;
+		}
+		if (next->policy == Policy::RR && next->rtSlice == 0)
+			next->rtSlice = rrTimeslice;
+		queue.current = next;
+		queue.priority.store(rank(queue, next), lib::memory_order_relaxed);
+		queue.needResched = false;
+		queue.fair.update(next != queue.idle && next->policy == Policy::NORMAL ? next : nullptr);
+	}
+
+	if (prev->state == State::TERMINATED)
+		queue.dead = prev;
+
+	if (prev == next)
+		return;
+
+	/* Account idle time (tick might have been stopped while idle) */
+	if (prev == queue.idle) {
+		queue.idleTime += now - queue.idleStart;
+		driver::timer.restartTick();
+	}
+	if (next == queue.idle)
+		queue.idleStart = now;
+
+	queue.switches++;
+	Context::switching(prev, next);
+}
+
+void Scheduler::start() {
+	CPU::disableInterrupts();
+
+	auto& queue = queues.get();
+	queue.idle = &idleThreads.get();
+
+	/* Context of boot code is never resumed */
+	Context boot;
+	boot.setState(State::WAITING);
+	{
+		lock::lock_guard guard(queue.lock);
+		boot.execStart = CPU::getSystemCounter();
+		queue.current = &boot;
+	}
+
+	schedule();
+
+	debug::panic::generate("Scheduler: Boot context resumed");
+}
+
+void Scheduler::yield() {
+	assert(!lock::softirq.isDisabled());
+
+	lock::irqsave irq;
+	assert(queues.get().preemptCount == 0);
+	queues.get().current->yielded = true;
+	schedule();
+}
+
+void Scheduler::exit() {
+	assert(!lock::softirq.isDisabled());
+
+	CPU::disableInterrupts();
+	assert(queues.get().preemptCount == 0);
+
+	queues.get().current->state = State::TERMINATED;
+	schedule();
+
+	debug::panic::generate("Scheduler: Terminated thread resumed");
+}
+
+void Scheduler::requestReschedule() {
+	lock::irqsave irq;
+	auto& queue = queues.get();
+	queue.current->yielded = true;
+	queue.needResched = true;
+}
+
+void Scheduler::requestSleep(uint64_t until) {
+	lock::irqsave irq;
+	auto& queue = queues.get();
+
+	/* Sleep timer is started once thread left the CPU (see schedule()) */
+	queue.current->state = State::WAITING;
+	queue.current->wakeAt = until != 0 ? until : 1;
+	queue.needResched = true;
+}
+
+void Scheduler::requestExit() {
+	lock::irqsave irq;
+	auto& queue = queues.get();
+	queue.current->state = State::TERMINATED;
+	queue.needResched = true;
+}
+
+int Scheduler::tick() {
+	lock::irqsave irq;
+	auto cpuID = CPU::getProcessorID();
+	auto& queue = queues.get();
+
+	auto current = queue.current;
+	if (current == nullptr)
+		return 0;
+
+	/* Idle CPUs steal on each tick, busy CPUs balance periodically */
+	queue.ticks++;
+	if (current == queue.idle) {
+		if (queue.length.load(lib::memory_order_relaxed) == 0) {
+			auto thread = steal(cpuID);
+			if (thread != nullptr) {
+				lock::lock_guard guard(queue.lock);
+				thread->cpu = cpuID;
+				queue.fair.attach(thread);
+				enqueue(queue, thread);
+			}
+		}
+	} else if (queue.ticks % BALANCE_INTERVAL == 0) {
+		balance(cpuID);
+		kickIdle(cpuID);
+	}
+
+	/* Idle thread is left as soon as a thread is runnable */
+	if (current == queue.idle) {
+		queue.needResched = (queue.length.load(lib::memory_order_relaxed) > 0);
+		return 0;
+	}
+
+	lock::lock_guard guard(queue.lock);
+	auto now = CPU::getSystemCounter();
+	updateCurrent(queue, now);
+
+	/* Real-time threads are only preempted by more important threads (see ready()) or their time slice */
+	if (current->policy != Policy::NORMAL) {
+		if (current->policy == Policy::RR && current->rtSlice == 0) {
+			if (queue.rt.highestPriority() == current->rtPriority) {
+				current->yielded = true;
+				queue.needResched = true;
+			} else {
+				current->rtSlice = rrTimeslice;
+			}
+		}
+
+		return 0;
+	}
+
+	/* Real-time threads might have been stolen by this CPU */
+	if (queue.rt.size() > 0) {
+		queue.needResched = true;
+		return 0;
+	}
+
+	if (queue.fair.size() == 0)
+		return 0;
+
+	/* Preempt after share of period, or earlier if another thread has fallen far behind */
+	auto ideal = idealRuntime(queue, current);
+	auto ran = now - current->runStart;
+	if (ran > ideal) {
+		queue.needResched = true;
+	} else if (ran >= minGranularity) {
+		/* Waiting threads might have been stolen meanwhile */
+		auto leftmost = queue.fair.first();
+		if (leftmost != nullptr) {
+			auto delta = static_cast<int64_t>(current->fairNode.t.vruntime - leftmost->fairNode.t.vruntime);
+			if (delta > static_cast<int64_t>(ideal))
+				queue.needResched = true;
+		}
+	}
+
+	return 0;
+}
+
+void Scheduler::preempt(bool user) {
+	auto& queue = queues.get();
+	if (!queue.needResched || queue.current == nullptr)
+		return;
+
+	/* Kernel code is only preempted outside of epilogues and preempt_guard */
+	if (!user && (queue.preemptCount > 0 || lock::softirq.isDisabled()))
+		return;
+
+	schedule();
+}
+
+void Scheduler::disablePreemption() {
+	lock::irqsave irq;
+	queues.get().preemptCount++;
+}
+
+void Scheduler::enablePreemption() {
+	lock::irqsave irq;
+	assert(queues.get().preemptCount > 0);
+	queues.get().preemptCount--;
+}
+
+int Scheduler::setNice(int nice) {
+	if (nice < FairQueue::NICE_MIN || nice > FairQueue::NICE_MAX)
+		return -EINVAL;
+
+	lock::irqsave irq;
+	auto& queue = queues.get();
+	lock::lock_guard guard(queue.lock);
+
+	/* Runtime so far is charged with the old weight */
+	updateCurrent(queue, CPU::getSystemCounter());
+	queue.current->nice = nice;
+	queue.current->weight = FairQueue::niceToWeight(nice);
+
+	return 0;
+}
+
+int Scheduler::setPolicy(Policy policy, int priority) {
+	if (policy == Policy::NORMAL && priority != 0)
+		return -EINVAL;
+	if (policy != Policy::NORMAL && (priority < RtQueue::MIN_PRIORITY || priority > RtQueue::MAX_PRIORITY))
+		return -EINVAL;
+
+	lock::irqsave irq;
+	auto& queue = queues.get();
+	lock::lock_guard guard(queue.lock);
+
+	auto current = queue.current;
+	updateCurrent(queue, CPU::getSystemCounter());
+
+	/* Virtual runtime was frozen while thread was a real-time thread */
+	if (current->policy != Policy::NORMAL && policy == Policy::NORMAL)
+		queue.fair.place(current, false, 0);
+
+	current->policy = policy;
+	current->rtPriority = priority;
+	current->rtSlice = rrTimeslice;
+	queue.priority.store(rank(queue, current), lib::memory_order_relaxed);
+
+	/* More important threads might be waiting now */
+	queue.needResched = true;
+	return 0;
+}
+
+int Scheduler::getNice() {
+	lock::irqsave irq;
+	return queues.get().current->nice;
+}
+
+Context* Scheduler::current() {
+	lock::irqsave irq;
+	return queues.get().current;
+}
+
+Scheduler::Statistics Scheduler::getStatistics(size_t cpuID) const {
+	auto& queue = queues.get(cpuID);
+
+	Statistics stats;
+	stats.now = CPU::getSystemCounter();
+	stats.frequency = CPU::getSystemCounterFrequency();
+	stats.length = queue.length.load(lib::memory_order_relaxed);
+	stats.switches = __atomic_load_n(&queue.switches, __ATOMIC_RELAXED);
+	stats.steals = __atomic_load_n(&queue.steals, __ATOMIC_RELAXED);
+	stats.migrations = __atomic_load_n(&queue.migrations, __ATOMIC_RELAXED);
+	stats.ticksAvoided = driver::timer.getTicksAvoided(cpuID);
+
+	/* Include current idle period (values are read without lock and may be slightly off) */
+	stats.idleTime = __atomic_load_n(&queue.idleTime, __ATOMIC_RELAXED);
+	auto current = __atomic_load_n(&queue.current, __ATOMIC_RELAXED);
+	auto idleStart = __atomic_load_n(&queue.idleStart, __ATOMIC_RELAXED);
+	if (current != nullptr && current == queue.idle && stats.now > idleStart)
+		stats.idleTime += stats.now - idleStart;
+
+	return stats;
+}
@@ -6,6 +6,7 @@
 #include <kernel/math.h>
 #include <kernel/utility.h>
 #include <kernel/thread/smp.h>
+#include <kernel/mm/frame_allocator.h>
 #include <driver/cpu.h>
 #include <driver/drivers.h>
 
@@ -23,16 +24,6 @@ SMP::SMP() {
 }
 
 int SMP::start() {
-	/* Get number of CPUs */
-	auto numCPUS = driver::cpus.numCPUs();
-	char* stacks = reinterpret_cast<char*>(lib::malloc(numCPUS * STACKSIZE));
-	if (stacks == nullptr)
-		return -ENOMEM;
-
-	/* Roundup to stack alignment */
-	stacks = reinterpret_cast<char*>(math::roundDown(reinterpret_cast<uintptr_t>(stacks), STACKALIGN));
-
-
 	/* Trampoline values */
 	uint64_t* id = reinterpret_cast<uint64_t*>(&__CPU_ID);
 	uint64_t* stack = reinterpret_cast<uint64_t*>(&__CPU_STACK);
@@ -46,12 +37,26 @@ int SMP::start() {
 	/* TODO: Ensure cpus.begin() is actual boot CPU */
 	size_t idx = 1;
 	for (auto cpu = (driver::cpus.begin() + 1); cpu != driver::cpus.end(); ++cpu) {
+		/* Allocate boot stack */
+		char* stacks = reinterpret_cast<char*>(mm::frameAlloc.allocPages(mm::FrameAllocator::sizeToOrder(STACKSIZE)));
+		if (stacks == nullptr)
+			return -ENOMEM;
+
+		/* Application processors use their stacks before enabling caches -> Drop
+		 * all (possibly dirty) cache lines of the stacks */
+		CPU::cleanInvalidateDataCache(stacks, STACKSIZE);
+
 		/* Prepare trampoline */
-		*stack = reinterpret_cast<uint64_t>(&stacks[idx * STACKSIZE - STACKALIGN]);
+		*stack = reinterpret_cast<uint64_t>(&stacks[STACKSIZE - STACKALIGN]);
 		*id = idx;
 
+		/* Trampoline is read with disabled caches -> Write back to memory */
+		CPU::cleanDataCache(stack, sizeof(*stack));
+		CPU::cleanDataCache(id, sizeof(*id));
+
 		/* Prepare start address for application processors */
 		util::mmioWrite(reinterpret_cast<uint64_t*>(cpu->getSpintable()), startAddr);
+		CPU::cleanDataCache(cpu->getSpintable(), sizeof(startAddr));
 		CPU::dataBarrier();
 
 		/* Wake up CPUs */
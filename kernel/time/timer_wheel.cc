@@ -0,0 +1,346 @@
+#include <cerrno.h>
+#include <kernel/cpu.h>
+#include <kernel/math.h>
+#include <kernel/utility.h>
+#include <kernel/lock/guard.h>
+#include <kernel/time/timer_wheel.h>
+#include <driver/cpu.h>
+#include <driver/drivers.h>
+
+using namespace time;
+
+TimerWheel::TimerWheel() {
+	for (size_t i = 0; i < MAX_NUM_CPUS; i++) {
+		auto& base = bases.get(i);
+		base.clk = 0;
+		base.expired = nullptr;
+		for (auto& wheel : base.wheels) {
+			for (size_t level = 0; level < LEVELS; level++) {
+				wheel.pending[level] = 0;
+				for (size_t slot = 0; slot < SLOTS; slot++)
+					wheel.slots[level][slot] = nullptr;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < MAX_FUNCTIONS; i++)
+		functions[i] = nullptr;
+}
+
+int TimerWheel::init() {
+	/* CPUs without own timer interrupt are ticked by the boot CPU */
+	auto tick = [this]() -> int {
+		run();
+		return 0;
+	};
+
+	return driver::ipi.registerHandler(driver::IPI::IPI_MSG::RESCHEDULE, lib::function<int()>(tick));
+}
+
+void TimerWheel::enqueue(Base& base, timer_head* timer) {
+	auto& wheel = base.wheels[timer->deferrable ? 1 : 0];
+
+	/* Overdue timers expire on next processed tick */
+	auto expires = timer->expires;
+	if (expires < base.clk)
+		expires = base.clk;
+
+	/* Timers beyond range of wheel are placed in last slot of top level (and cascaded again) */
+	auto delta = expires - base.clk;
+	if (delta >= MAX_DELTA) {
+		delta = MAX_DELTA - 1;
+		expires = base.clk + delta;
+	}
+
+	size_t level = delta == 0 ? 0 : util::fls(delta) / LEVEL_BITS;
+	size_t slot = (expires >> (level * LEVEL_BITS)) & (SLOTS - 1);
+
+	auto& head = wheel.slots[level][slot];
+	timer->next = head;
+	timer->pprev = &head;
+	if (head != nullptr)
+		head->pprev = &timer->next;
+	head = timer;
+
+	wheel.pending[level] |= static_cast<uint64_t>(1) << slot;
+}
+
+void TimerWheel::unlink(Base& base, timer_head* timer) {
+	auto pprev = timer->pprev;
+	*pprev = timer->next;
+	if (timer->next != nullptr)
+		timer->next->pprev = pprev;
+
+	timer->next = nullptr;
+	timer->pprev = nullptr;
+
+	/* Clear pending bit if timer was the last one of its slot */
+	if (*pprev != nullptr)
+		return;
+
+	for (auto& wheel : base.wheels) {
+		auto first = reinterpret_cast<uintptr_t>(&wheel.slots[0][0]);
+		auto last = reinterpret_cast<uintptr_t>(&wheel.slots[LEVELS - 1][SLOTS - 1]);
+		auto pos = reinterpret_cast<uintptr_t>(pprev);
+		if (pos < first || pos > last)
+			continue;
+
+		size_t index = (pos - first) / sizeof(timer_head*);
+		wheel.pending[index / SLOTS] &= ~(static_cast<uint64_t>(1) << (index % SLOTS));
+		return;
+	}
+}
+
+bool TimerWheel::isEmpty(const Base& base) const {
+	if (base.expired != nullptr)
+		return false;
+
+	for (auto& wheel : base.wheels) {
+		for (size_t level = 0; level < LEVELS; level++) {
+			if (wheel.pending[level] != 0)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+void TimerWheel::cascade(Base& base, Wheel& wheel, size_t level, size_t slot) {
+	auto timer = wheel.slots[level][slot];
+	wheel.slots[level][slot] = nullptr;
+	wheel.pending[level] &= ~(static_cast<uint64_t>(1) << slot);
+
+	while (timer != nullptr) {
+		auto next = timer->next;
+		enqueue(base, timer);
+		timer = next;
+	}
+}
+
+void TimerWheel::advance(Base& base, Wheel& wheel) {
+	auto clk = base.clk;
+
+	/* Cascade slot of each level whose lower levels wrapped around */
+	for (size_t level = 1; level < LEVELS; level++) {
+		auto shift = level * LEVEL_BITS;
+		if ((clk & ((static_cast<uint64_t>(1) << shift) - 1)) != 0)
+			break;
+
+		cascade(base, wheel, level, (clk >> shift) & (SLOTS - 1));
+	}
+
+	/* Move expiring timers to list of expired timers */
+	size_t slot = clk & (SLOTS - 1);
+	auto timer = wheel.slots[0][slot];
+	if (timer == nullptr)
+		return;
+
+	wheel.slots[0][slot] = nullptr;
+	wheel.pending[0] &= ~(static_cast<uint64_t>(1) << slot);
+
+	auto tail = &base.expired;
+	while (*tail != nullptr)
+		tail = &(*tail)->next;
+
+	*tail = timer;
+	timer->pprev = tail;
+}
+
+void TimerWheel::add(timer_head* timer, size_t ticks, size_t period) {
+	addOn(CPU::getProcessorID(), timer, ticks, period);
+}
+
+void TimerWheel::addOn(size_t cpuID, timer_head* timer, size_t ticks, size_t period) {
+	cancel(timer);
+
+	auto& base = bases.get(cpuID);
+	{
+		lock::irqsave_guard guard(base.lock);
+		auto now = driver::timer.getTicks();
+
+		/* Empty wheel skips elapsed ticks (e.g. of idle CPU) at once */
+		if (base.clk < now && isEmpty(base))
+			base.clk = now;
+
+		timer->expires = now + ticks;
+		timer->period = period;
+		timer->cpu = cpuID;
+		enqueue(base, timer);
+	}
+
+	/* Idle CPU recomputes its next event */
+	if (!timer->deferrable && cpuID != CPU::getProcessorID() && driver::timer.isTickStopped(cpuID))
+		driver::ipi.sendIPI(cpuID, driver::IPI::IPI_MSG::RESCHEDULE);
+}
+
+bool TimerWheel::cancel(timer_head* timer) {
+	while (true) {
+		auto cpuID = __atomic_load_n(&timer->cpu, __ATOMIC_RELAXED);
+		auto& base = bases.get(cpuID);
+
+		lock::irqsave_guard guard(base.lock);
+		if (timer->pprev == nullptr)
+			return false;
+
+		/* Timer was concurrently moved to other CPU */
+		if (timer->cpu != cpuID)
+			continue;
+
+		unlink(base, timer);
+		return true;
+	}
+}
+
+bool TimerWheel::isPending(const timer_head* timer) const {
+	return __atomic_load_n(&timer->pprev, __ATOMIC_RELAXED) != nullptr;
+}
+
+void TimerWheel::run() {
+	auto& base = bases.get();
+	auto now = driver::timer.getTicks();
+
+	/* Callbacks might unregister their function (freed after a grace period) */
+	lock::rcu_read_guard rcuGuard;
+
+	while (true) {
+		timer_head* timer;
+		{
+			lock::irqsave_guard guard(base.lock);
+			if (base.clk <= now && isEmpty(base))
+				base.clk = now + 1;
+
+			while (base.expired == nullptr && base.clk <= now) {
+				for (auto& wheel : base.wheels)
+					advance(base, wheel);
+				base.clk++;
+			}
+
+			timer = base.expired;
+			if (timer == nullptr)
+				return;
+
+			unlink(base, timer);
+
+			/* Periodic timer expires once, even if several of its periods elapsed */
+			if (timer->period != 0) {
+				timer->expires += timer->period;
+				if (timer->expires < base.clk)
+					timer->expires += math::roundUp(base.clk - timer->expires, timer->period);
+				enqueue(base, timer);
+			}
+		}
+
+		timer->func(timer);
+	}
+}
+
+uint64_t TimerWheel::nextExpiry() {
+	auto& base = bases.get();
+	lock::irqsave_guard guard(base.lock);
+
+	auto now = CPU::getSystemCounter();
+	if (base.expired != nullptr)
+		return now;
+
+	uint64_t earliest = ~static_cast<uint64_t>(0);
+	for (size_t level = 0; level < LEVELS; level++) {
+		auto pending = base.wheels[0].pending[level];
+		if (pending == 0)
+			continue;
+
+		/* First slot (starting with slot of next boundary of level) which is pending */
+		auto shift = level * LEVEL_BITS;
+		auto index = (base.clk + (static_cast<uint64_t>(1) << shift) - 1) >> shift;
+		auto rotate = index & (SLOTS - 1);
+		if (rotate != 0)
+			pending = (pending >> rotate) | (pending << (SLOTS - rotate));
+
+		uint64_t tick = (index + util::ffs(pending)) << shift;
+		if (tick < earliest)
+			earliest = tick;
+	}
+
+	if (earliest == ~static_cast<uint64_t>(0))
+		return 0;
+
+	/* Convert tick to system counter */
+	auto current = driver::timer.getTicks();
+	if (earliest <= current)
+		return now;
+
+	auto perTick = (driver::timer.interval() * CPU::getSystemCounterFrequency()) / 1000;
+	return now + (earliest - current) * perTick;
+}
+
+size_t TimerWheel::toTicks(uint64_t counter) const {
+	auto perTick = (driver::timer.interval() * CPU::getSystemCounterFrequency()) / 1000;
+	if (perTick == 0)
+		return 0;
+
+	return math::roundUp(counter, perTick) / perTick;
+}
+
+void TimerWheel::callFunction(timer_head* timer) {
+	static_cast<Function*>(timer->data)->function();
+}
+
+int TimerWheel::registerFunction(size_t ticks, lib::function<int(void)> callback) {
+	if (ticks == 0)
+		return -EINVAL;
+
+	auto entry = new Function();
+	if (entry == nullptr)
+		return -ENOMEM;
+
+	entry->function = lib::move(callback);
+	if (!entry->function.isValid()) {
+		delete entry;
+		return -ENOMEM;
+	}
+
+	lock::lock_guard guard(functionsLock);
+	for (size_t i = 0; i < MAX_FUNCTIONS; i++) {
+		if (functions[i] != nullptr)
+			continue;
+
+		functions[i] = entry;
+
+		/* Periodic housekeeping doesn't wake up idle CPUs */
+		for (size_t cpuID = 0; cpuID < driver::cpus.numCPUs(); cpuID++) {
+			auto& timer = entry->timers[cpuID];
+			timer.deferrable = true;
+			timer.func = callFunction;
+			timer.data = entry;
+			addOn(cpuID, &timer, ticks, ticks);
+		}
+
+		return static_cast<int>(i);
+	}
+
+	delete entry;
+	return -ENOMEM;
+}
+
+int TimerWheel::unregisterFunction(int id) {
+	if (id < 0 || static_cast<size_t>(id) >= MAX_FUNCTIONS)
+		return -EINVAL;
+
+	Function* entry;
+	{
+		lock::lock_guard guard(functionsLock);
+		entry = functions[id];
+		if (entry == nullptr)
+			return -EINVAL;
+
+		functions[id] = nullptr;
+		for (size_t cpuID = 0; cpuID < MAX_NUM_CPUS; cpuID++)
+			cancel(&entry->timers[cpuID]);
+	}
+
+	/* Concurrent expiries might still execute function */
+	auto release = [](lock::rcu_head* head) {
+		delete static_cast<Function*>(head);
+	};
+	lock::rcu.call(entry, release);
+	return 0;
+}
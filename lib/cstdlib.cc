@@ -2,7 +2,10 @@
 #include <cstdlib.h>
 #include <cstddef.h>
 #include <cstring.h>
+#include <atomic.h>
+#include <kernel/cpu.h>
 #include <kernel/math.h>
+#include <kernel/cpu_local.h>
 #include <kernel/lock/spinlock.h>
 
 /* DEFINITION -------------------------------------------------------------- */
@@ -19,73 +22,143 @@
 /* Length of free list */
 #define FREE_LISTS_LEN (MAX_ALLOC_SIZE_LOG2 - MIN_ALLOC_SIZE_LOG2 + 1)
 
-/* container_of macro */
-#define container_of(ptr, type, member)                  \
-	((type *) ((char *) (ptr) - offsetof(type, member)))
+/* Maximum size of buddies served by per-CPU caches (4 KByte) */
+#define CACHE_MAX_SIZE_LOG2 12
 
-/* STRUCT DEFINITION ------------------------------------------------------- */
+/* Number of size classes of per-CPU caches (16 Byte - 4 KByte) */
+#define CACHE_CLASSES (CACHE_MAX_SIZE_LOG2 - MIN_ALLOC_SIZE_LOG2 + 1)
+
+/* Maximum number of cached objects per size class and CPU */
+#define CACHE_LEN 32
+
+/* Number of objects moved between per-CPU cache and buddy allocator at once */
+#define CACHE_BATCH (CACHE_LEN / 2)
+
+/* Index of free list of pages (per-CPU caches carve their objects out of whole pages) */
+#define PAGE_INDEX (CACHE_CLASSES - 1)
+
+/* Number of blocks of MIN_ALLOC_SIZE */
+#define NUM_BLOCKS (MAX_ALLOC_SIZE / MIN_ALLOC_SIZE)
 
-/* Embedded struct for used memory region */
-struct buddy_node_used {
-	size_t size;
-	bool used;
-	char *mem[0];
-} __attribute__((packed));
+/* Number of pages (of 4 KByte) */
+#define NUM_PAGES (MAX_ALLOC_SIZE >> CACHE_MAX_SIZE_LOG2)
+
+/* Metadata of head of block: Index of free list + 1 (or 0 if not head of block) */
+#define META_INDEX_MASK 0x1f
+
+/* Metadata of head of block: Block is allocated */
+#define META_USED (1 << 5)
+
+/* STRUCT DEFINITION ------------------------------------------------------- */
 
 /* Embbeded struct for free memory region */
-struct buddy_node_free {
-	size_t size;
-	bool used;
-	struct buddy_node_free *prev;
-	struct buddy_node_free *next;
-	char *mem[0];
-} __attribute__((packed));
-
-/* List of free memory including metadata about list */
-struct buddy_free_list {
-	struct buddy_node_free *head;
-	size_t num_buddies;
+struct buddy_node {
+	struct buddy_node *prev;
+	struct buddy_node *next;
+};
+
+/* Embedded link between cached objects */
+struct cache_link {
+	struct cache_link *next;
+};
+
+/* Free list of a single size class */
+struct cache_class {
+	struct cache_link *head;
+	size_t count;
+};
+
+/* Per-CPU cache of small objects */
+struct alignas(64) cache_cpu {
+	struct cache_class classes[CACHE_CLASSES];
+	lib::atomic<struct cache_link *> remote;
+	lib::malloc_stats_t stats;
 };
 
 /* VARIABLES --------------------------------------------------------------- */
 
 /* Array of free list for MIN_ALLOC_SIZE - MAX_ALLOC_SIZE */
-static struct buddy_free_list free_lists[FREE_LISTS_LEN];
+static struct buddy_node *free_lists[FREE_LISTS_LEN];
+
+/* Bitmap of non-empty free lists */
+static uint32_t free_mask;
 
 /* Memory of allocator */
-static char __mem[MAX_ALLOC_SIZE];
-static size_t __size = MAX_ALLOC_SIZE;
+alignas(4096) static char __mem[MAX_ALLOC_SIZE];
+
+/* Metadata of blocks (indexed by offset / MIN_ALLOC_SIZE) */
+static uint8_t __meta[NUM_BLOCKS];
+
+/* CPU which caches objects of page (indexed by offset / 4 KByte, only valid for cached objects) */
+static uint8_t __owner[NUM_PAGES];
 
 /* Synchronization lock */
 static lock::spinlock allocLock;
 
+/* Per-CPU caches (in front of buddy allocator, constructed before any other global object may allocate) */
+static cpu_local<struct cache_cpu> caches __attribute__((init_priority(101)));
+
+static_assert(FREE_LISTS_LEN <= 32, "free_mask is too small");
+static_assert(FREE_LISTS_LEN < META_INDEX_MASK, "META_INDEX_MASK is too small");
+static_assert(MAX_NUM_CPUS <= 256, "Owner doesn't fit into metadata");
+
 /* HELPER ------------------------------------------------------------------ */
 
-/* Convert size to index in buddy_free_lists */
+/* Convert size to smallest index in free_lists, whose buddies can hold size bytes */
 static size_t __size_to_index(size_t size) {
-	return math::ld(size) - MIN_ALLOC_SIZE_LOG2;
+	if (size <= MIN_ALLOC_SIZE)
+		return 0;
+
+	return util::fls(size - 1) + 1 - MIN_ALLOC_SIZE_LOG2;
 }
 
-/* Find associated buddy */
-static void *__find_buddy(void *ptr) {
-	struct buddy_node_used *buddy = (struct buddy_node_used *) ptr;
-	uintptr_t offset = ((uintptr_t) ptr) - ((uintptr_t) __mem);
-	uintptr_t offset_buddy = offset ^ buddy->size;
+/* Convert pointer to block number */
+static size_t __to_block(void *ptr) {
+	return ((uintptr_t) ptr - (uintptr_t) __mem) >> MIN_ALLOC_SIZE_LOG2;
+}
+
+/* Convert block number to pointer */
+static void *__to_ptr(size_t block) {
+	return __mem + (block << MIN_ALLOC_SIZE_LOG2);
+}
+
+/* Check if ptr is the head of an allocated block */
+static bool __is_used(void *ptr) {
+	if ((uintptr_t) ptr < (uintptr_t) __mem || (uintptr_t) ptr >= (uintptr_t) __mem + MAX_ALLOC_SIZE)
+		return false;
+
+	if ((uintptr_t) ptr & (MIN_ALLOC_SIZE - 1))
+		return false;
 
-	return (void *) ((uintptr_t) __mem + offset_buddy);
+	return __meta[__to_block(ptr)] & META_USED;
+}
+
+/* Get index in free_lists of allocated block */
+static size_t __get_index(void *ptr) {
+	return (__meta[__to_block(ptr)] & META_INDEX_MASK) - 1;
+}
+
+/* Get owner of page of cached object */
+static size_t __get_owner(void *ptr) {
+	return __owner[((uintptr_t) ptr - (uintptr_t) __mem) >> CACHE_MAX_SIZE_LOG2];
+}
+
+/* Set owner of page */
+static void __set_owner(void *page, size_t owner) {
+	__owner[((uintptr_t) page - (uintptr_t) __mem) >> CACHE_MAX_SIZE_LOG2] = owner;
 }
 
 /* Remove buddy from free_lists */
-static void __remove_buddy(struct buddy_node_free *buddy) {
-	struct buddy_node_free *prev = buddy->prev;
-	struct buddy_node_free *next = buddy->next;
-	ssize_t idx = __size_to_index(buddy->size);
+static void __remove_buddy(size_t block, size_t idx) {
+	struct buddy_node *buddy = (struct buddy_node *) __to_ptr(block);
+	struct buddy_node *prev = buddy->prev;
+	struct buddy_node *next = buddy->next;
 
 	/* Update prev and head */
 	if (prev != nullptr) {
 		prev->next = next;
 	} else {
-		free_lists[idx].head = next;
+		free_lists[idx] = next;
 	}
 
 	/* Update next */
@@ -93,20 +166,18 @@ static void __remove_buddy(struct buddy_node_free *buddy) {
 		next->prev = prev;
 	}
 
-	/* Prepare buddy */
-	buddy->next = nullptr;
-	buddy->prev = nullptr;
-
-	/* Update num_buddies */
-	free_lists[idx].num_buddies--;
+	/* Update bitmap and metadata */
+	if (free_lists[idx] == nullptr)
+		free_mask &= ~(1U << idx);
+	__meta[block] = 0;
 }
 
 /* Insert buddy into free_lists */
-static void __insert_buddy(struct buddy_node_free *buddy) {
-	ssize_t idx = __size_to_index(buddy->size);
+static void __insert_buddy(size_t block, size_t idx) {
+	struct buddy_node *buddy = (struct buddy_node *) __to_ptr(block);
 
 	/* Update buddy */
-	struct buddy_node_free *head = free_lists[idx].head;
+	struct buddy_node *head = free_lists[idx];
 	buddy->next = head;
 	buddy->prev = nullptr;
 
@@ -115,210 +186,268 @@ static void __insert_buddy(struct buddy_node_free *buddy) {
 		head->prev = buddy;
 	}
 
-	/* Update head */
-	free_lists[idx].head = buddy;
-
-	/* Update num_buddies */
-	free_lists[idx].num_buddies++;
+	/* Update head, bitmap and metadata */
+	free_lists[idx] = buddy;
+	free_mask |= 1U << idx;
+	__meta[block] = idx + 1;
 }
 
-/* Remove buddy from free_lists and split it */
-static void __split_buddy(struct buddy_node_free *buddy) {
-	/* Remove buddy from free_list */
-	__remove_buddy(buddy);
-
-	/* Calculate left and right buddy */
-	size_t new_size = buddy->size / 2;
-	struct buddy_node_free *left = buddy;
-	struct buddy_node_free *right = (struct buddy_node_free *) (((uintptr_t) buddy) + new_size);
-
-	/* Prepare left buddy */
-	left->size = new_size;
-	left->used = false;
-	left->next = nullptr;
-	left->prev = nullptr;
-
-	/* Prepare right buddy */
-	right->size = new_size;
-	right->used = false;
-	right->next = nullptr;
-	right->prev = nullptr;
-
-	/* Return left/right */
-	__insert_buddy(right);
-	__insert_buddy(left);
+__attribute__((constructor))
+static void buddy_init() {
+	/* Prepare freelist */
+	memset(free_lists, 0, sizeof(free_lists));
+	free_mask = 0;
+
+	/* Insert root */
+	__insert_buddy(0, FREE_LISTS_LEN - 1);
 }
 
-/* Merge buddy (which isn't part of ready list) */
-static struct buddy_node_free *__merge_buddy(struct buddy_node_free *buddy) {
-	/* Can't merge more */
-	if (buddy->size == __size)
+static void *buddy_alloc(size_t idx) {
+	/* Find smallest fitting buddy */
+	uint32_t candidates = free_mask & ~((1U << idx) - 1);
+	if (candidates == 0)
 		return nullptr;
 
-	/* Find matching (free) buddy */
-	struct buddy_node_free *match = (struct buddy_node_free*) __find_buddy(buddy);
-	if (match->used == true)
-		return nullptr;
-	if (buddy->size != match->size)
-		return nullptr;
-	__remove_buddy(match);
+	size_t found = util::ffs(candidates);
+	size_t block = __to_block(free_lists[found]);
+	__remove_buddy(block, found);
+
+	/* Split and return right halves */
+	while (found > idx) {
+		found--;
+		__insert_buddy(block + (1UL << found), found);
+	}
+
+	__meta[block] = (idx + 1) | META_USED;
+	return __to_ptr(block);
+}
+
+static void buddy_free(void *ptr) {
+	size_t block = __to_block(ptr);
+	size_t idx = __get_index(ptr);
+	__meta[block] = 0;
 
 	/* Merge */
-	size_t new_size = buddy->size * 2;
-	struct buddy_node_free *ret = (uintptr_t) buddy < (uintptr_t) match ? buddy : match;
-	ret->size = new_size;
-	ret->prev = nullptr;
-	ret->next = nullptr;
-	return ret;
+	while (idx < FREE_LISTS_LEN - 1) {
+		size_t buddy = block ^ (1UL << idx);
+		if (__meta[buddy] != idx + 1)
+			break;
+
+		__remove_buddy(buddy, idx);
+		block = block < buddy ? block : buddy;
+		idx++;
+	}
+
+	/* Insert */
+	__insert_buddy(block, idx);
 }
 
-__attribute__((constructor))
-static void buddy_init() {
-	size_t idx = MAX_ALLOC_SIZE_LOG2 - MIN_ALLOC_SIZE_LOG2;
+/* Push object to free list of size class */
+static void __cache_push(struct cache_class &cls, void *ptr) {
+	struct cache_link *link = (struct cache_link *) ptr;
+	link->next = cls.head;
+	cls.head = link;
+	cls.count++;
+}
 
-	/* Prepare freelist */
-	memset(&free_lists, 0, sizeof(struct buddy_free_list) * FREE_LISTS_LEN);
-
-	/* Prepare root */
-	struct buddy_node_free *root = (struct buddy_node_free *) __mem;
-	root->size = __size;
-	root->used = false;
-	root->next = nullptr;
-	root->prev = nullptr;
-
-	/* Insert into free_lists */
-	free_lists[idx].head = root;
-	free_lists[idx].num_buddies = 1;
+/* Pop object from free list of size class (or nullptr if empty) */
+static void *__cache_pop(struct cache_class &cls) {
+	struct cache_link *link = cls.head;
+	if (link == nullptr)
+		return nullptr;
+
+	cls.head = link->next;
+	cls.count--;
+	return link;
+}
+
+/* Return CACHE_BATCH objects of size class to buddy allocator */
+static void __cache_flush(struct cache_cpu &cache, struct cache_class &cls) {
+	allocLock.lock();
+	for (size_t i = 0; i < CACHE_BATCH && cls.head != nullptr; i++)
+		buddy_free(__cache_pop(cls));
+	allocLock.unlock();
+
+	cache.stats.flushes++;
 }
 
-static void *buddy_malloc(size_t size) {
-	size_t actual_size = size + sizeof(struct buddy_node_used);
-	if (!math::isPowerOfTwo(actual_size))
-		actual_size = 1 << (util::fls(actual_size) + 1);
+/* Insert object into free list of its size class (and flush if full) */
+static void __cache_insert(struct cache_cpu &cache, void *ptr) {
+	struct cache_class &cls = cache.classes[__get_index(ptr)];
 
-	actual_size = actual_size < MIN_ALLOC_SIZE ? MIN_ALLOC_SIZE : actual_size;
-	size_t idx = __size_to_index(actual_size);
+	if (cls.count >= CACHE_LEN)
+		__cache_flush(cache, cls);
 
-	/* Find fitting buddy */
-	ssize_t found_index = -1;
-	size_t num_splits = 0;
-	for (size_t i = idx; i < FREE_LISTS_LEN; i++) {
-		if (free_lists[i].num_buddies > 0) {
-			found_index = i; break;
-		}
+	__cache_push(cls, ptr);
+}
 
-		num_splits++;
+/* Take over objects, which were freed by other CPUs */
+static void __cache_reclaim(struct cache_cpu &cache) {
+	struct cache_link *link = cache.remote.exchange(nullptr, lib::memory_order_acquire);
+	while (link != nullptr) {
+		struct cache_link *next = link->next;
+		__cache_insert(cache, link);
+		link = next;
 	}
+}
 
-	/* Check if suitable memory was found */
-	if (found_index == -1)
-		return nullptr;
+/* Allocate objects of size class idx (a page or CACHE_BATCH pages) from buddy allocator */
+static void __cache_refill(struct cache_cpu &cache, size_t cpuID, size_t idx) {
+	struct cache_class &cls = cache.classes[idx];
 
+	/* All objects of a page are owned by the same CPU (until the whole page is free again) */
+	size_t pages = (idx == PAGE_INDEX) ? CACHE_BATCH : 1;
+	size_t objects = 1UL << (PAGE_INDEX - idx);
 
-	/* Split */
-	for (size_t i = 0; i < num_splits; i++) {
-		__split_buddy(free_lists[found_index - i].head);
+	allocLock.lock();
+
+	/* Prefer free parts of pages in use (objects stay owned by the CPU of their page) */
+	uint32_t partial = ((1U << PAGE_INDEX) - 1) & ~((1U << idx) - 1);
+	while (cls.count < CACHE_BATCH && (free_mask & partial) != 0)
+		__cache_push(cls, buddy_alloc(idx));
+
+	for (size_t i = 0; i < pages && cls.count < CACHE_BATCH; i++) {
+		void *page = buddy_alloc(PAGE_INDEX);
+		if (page == nullptr)
+			break;
+
+		__set_owner(page, cpuID);
+
+		size_t block = __to_block(page);
+		for (size_t j = 0; j < objects; j++) {
+			__meta[block + (j << idx)] = (idx + 1) | META_USED;
+			__cache_push(cls, __to_ptr(block + (j << idx)));
+		}
 	}
+	allocLock.unlock();
 
-	/* Retrieve buddy */
-	struct buddy_node_free *buddy = free_lists[found_index - num_splits].head;
-	__remove_buddy(buddy);
+	cache.stats.refills++;
+}
 
-	struct buddy_node_used *ret = (struct buddy_node_used *) buddy;
-	ret->size = actual_size;
-	ret->used = true;
+/* Hand object back to the free list of its owner */
+static void __cache_remote_free(size_t owner, void *ptr) {
+	lib::atomic<struct cache_link *> &remote = caches.get(owner).remote;
+	struct cache_link *link = (struct cache_link *) ptr;
 
-	return ret->mem;
+	struct cache_link *head = remote.load(lib::memory_order_relaxed);
+	do {
+		link->next = head;
+	} while (!remote.compare_exchange_weak(head, link, lib::memory_order_release, lib::memory_order_relaxed));
 }
 
-static void buddy_free(void *ptr) {
-	if (ptr == nullptr)
+void *lib::malloc(size_t size) {
+	size_t idx = __size_to_index(size);
+	if (idx >= FREE_LISTS_LEN)
+		return nullptr;
+
+	bool enabled = CPU::areInterruptsEnabled();
+	CPU::disableInterrupts();
+
+	size_t cpuID = CPU::getProcessorID();
+	struct cache_cpu &cache = caches.get(cpuID);
+	void *ret = nullptr;
+
+	if (idx >= CACHE_CLASSES) {
+		/* Large allocations are served by buddy allocator */
+		cache.stats.large++;
+
+		allocLock.lock();
+		ret = buddy_alloc(idx);
+		allocLock.unlock();
+
+	} else {
+		struct cache_class &cls = cache.classes[idx];
+
+		ret = __cache_pop(cls);
+		if (ret != nullptr) {
+			cache.stats.hits++;
+
+		} else {
+			cache.stats.misses++;
+
+			/* Prefer objects freed by other CPUs over buddy allocator */
+			__cache_reclaim(cache);
+			if (cls.head == nullptr)
+				__cache_refill(cache, cpuID, idx);
+
+			ret = __cache_pop(cls);
+		}
+	}
+
+	if (enabled)
+		CPU::enableInterrupts();
+
+	return ret;
+}
+
+void lib::free(void *ptr) {
+	if (!__is_used(ptr))
 		return;
 
+	size_t idx = __get_index(ptr);
+	size_t owner = __get_owner(ptr);
 
-	/* Get buddy */
-	struct buddy_node_used *used_buddy = container_of(ptr, struct buddy_node_used, mem);
-	size_t size = used_buddy->size;
+	bool enabled = CPU::areInterruptsEnabled();
+	CPU::disableInterrupts();
 
-	/* Prepare free buddy */
-	struct buddy_node_free *free_buddy = (struct buddy_node_free *) used_buddy;
-	free_buddy->size = size;
-	free_buddy->used = false;
-	free_buddy->next = nullptr;
-	free_buddy->prev = nullptr;
+	size_t cpuID = CPU::getProcessorID();
+	struct cache_cpu &cache = caches.get(cpuID);
+	cache.stats.frees++;
 
-	/* Merge */
-	struct buddy_node_free *tmp = nullptr;
-	while((tmp = __merge_buddy(free_buddy)) != nullptr)
-		free_buddy = tmp;
+	if (idx >= CACHE_CLASSES) {
+		allocLock.lock();
+		buddy_free(ptr);
+		allocLock.unlock();
 
-	/* Insert */
-	__insert_buddy(free_buddy);
+	} else if (owner != cpuID) {
+		cache.stats.remoteFrees++;
+		__cache_remote_free(owner, ptr);
+
+	} else {
+		__cache_insert(cache, ptr);
+	}
+
+	if (enabled)
+		CPU::enableInterrupts();
 }
 
-static void *buddy_calloc(size_t nmemb, size_t size) {
+void *lib::calloc(size_t nmemb, size_t size) {
 	if (nmemb == 0 || size == 0) {
 		return nullptr;
 	}
 
-	void *ret = buddy_malloc(nmemb * size);
+	void *ret = lib::malloc(nmemb * size);
 	if (ret != nullptr)
 		memset(ret, 0, nmemb * size);
 
 	return ret;
 }
 
-static void *buddy_realloc(void *ptr, size_t size) {
-	if (ptr == nullptr) {
-		void *ret = buddy_malloc(size);
-		return ret;
-	}
+void *lib::realloc(void *ptr, size_t size) {
+	if (ptr == nullptr)
+		return lib::malloc(size);
 
 	if (size == 0) {
-		buddy_free(ptr);
+		lib::free(ptr);
 		return nullptr;
 	}
 
-	/* Check if ptr is valid */
-
-	struct buddy_node_used *tmp = container_of(ptr, struct buddy_node_used, mem);
-
+	if (!__is_used(ptr))
+		return nullptr;
 
 	/* Check if reallocation is necessary */
-	if (tmp->size >= size + sizeof(struct buddy_node_used))
+	size_t old_size = (size_t) MIN_ALLOC_SIZE << __get_index(ptr);
+	if (old_size >= size)
 		return ptr;
 
-	void *ret = buddy_malloc(size);
-	if (!ret) {
-		memcpy(ret, ptr, tmp->size - sizeof(struct buddy_node_used));
-		buddy_free(ptr);
+	void *ret = lib::malloc(size);
+	if (ret != nullptr) {
+		memcpy(ret, ptr, old_size);
+		lib::free(ptr);
 	}
 	return ret;
 }
 
-void *lib::malloc(size_t size) {
-	allocLock.lock();
-	void *ret = buddy_malloc(size);
-	allocLock.unlock();
-	return ret;
-}
-
-void lib::free(void *ptr) {
-	allocLock.lock();
-	buddy_free(ptr);
-	allocLock.unlock();
-}
-
-void *lib::calloc(size_t nmemb, size_t size) {
-	allocLock.lock();
-	void *ret = buddy_calloc(nmemb, size);
-	allocLock.unlock();
-	return ret;
-}
-
-void *lib::realloc(void *ptr, size_t size) {
-	allocLock.lock();
-	void *ret = buddy_realloc(ptr, size);
-	allocLock.unlock();
-	return ret;
+lib::malloc_stats_t lib::malloc_stats(size_t cpuID) {
+	return caches.get(cpuID).stats;
 }
@@ -4,9 +4,11 @@
 #include <driver/cpu.h>
 #include <driver/drivers.h>
 #include <kernel/cpu.h>
+#include <kernel/config.h>
 #include <kernel/math.h>
 #include <kernel/error.h>
 #include <kernel/linker.h>
+#include <kernel/percpu.h>
 #include <kernel/symbols.h>
 #include <kernel/thread/smp.h>
 #include <kernel/debug/panic.h>
@@ -17,10 +19,18 @@
 #include <kernel/irq/exception_handler.h>
 #include <kernel/thread/idle.h>
 #include <kernel/thread/context.h>
+#include <kernel/thread/scheduler.h>
 #include <kernel/mm/paging.h>
 #include <kernel/mm/translation_table.h>
 #include <kernel/mm/frame_allocator.h>
+#include <kernel/mm/asid_allocator.h>
+#include <kernel/mm/address_space.h>
+#include <kernel/mm/tlb_shootdown.h>
+#include <kernel/lock/rcu.h>
 #include <kernel/lock/softirq.h>
+#include <kernel/lock/benchmark.h>
+#include <kernel/lock/statistics.h>
+#include <kernel/time/timer_wheel.h>
 #include <hw/register/tcr.h>
 #include <hw/register/mair.h>
 #include <hw/register/sctlr.h>
@@ -36,15 +46,25 @@ namespace driver {
 
 namespace mm {
 	FrameAllocator frameAlloc;
+	ASIDAllocator asidAlloc;
+	TLBShootdown tlbShootdown;
 }
 
 namespace thread {
 	SMP smp;
 	IdleThreads idleThreads;
+	Scheduler scheduler;
 }
 
 namespace lock {
 	Softirq softirq;
+	RCU rcu;
+	Benchmark benchmark;
+	LockStatistics lockStatistics;
+}
+
+namespace time {
+	TimerWheel timerWheel;
 }
 
 namespace irq {
@@ -55,13 +75,10 @@ namespace irq {
 
 Symbols symbols;
 
-thread::Context mainThread;
+mm::AddressSpace mainAddressSpace;
 
 extern "C" int main();
 
-/* User stack for main application */
-static char userStack[STACK_SIZE] __attribute__((aligned(PAGESIZE),section("app.bss")));
-
 int kernelMain(void *fdt) {
 	/* Disable all interrupts */
 	CPU::disableInterrupts();
@@ -78,8 +95,9 @@ int kernelMain(void *fdt) {
 	if (!dtp.isValid())
 		return -1;
 
-	/* Initialize Translation Table Allocator */
-	mm::frameAlloc.init();
+	/* Initialize Frame Allocator with available memory */
+	if (isError(mm::frameAlloc.init(dtp)))
+		return -1;
 
 	/* Use default MAIR layout */
 	hw::reg::MAIR mair;
@@ -88,14 +106,28 @@ int kernelMain(void *fdt) {
 	/* Use default TCR layout */
 	hw::reg::TCR tcr;
 	tcr.useDefaultSetting();
+	if (CACHED_MEMORY)
+		tcr.useCacheableTableWalks();
+	tcr.setASIDSize(CPU::getASIDBits());
+
+	/* Prepare ASID allocator */
+	if (isError(mm::asidAlloc.init(CPU::getASIDBits())))
+		return -1;
 
 	/* Create kernel mapping */
 	if (isError(mm::Paging::createEarlyKernelMapping()))
 		return -1;
 
-	/* Enable MMU */
+	/* Discard stale cache lines and TLB entries */
+	CPU::invalidateDataCache();
+	CPU::invalidateInstrCache();
+	CPU::invalidateTLB();
+
+	/* Enable MMU and caches */
 	hw::reg::SCTLR sctrl;
 	sctrl.setMMUEnabled(true);
+	sctrl.setDataCachable(CACHED_MEMORY);
+	sctrl.setInstrCachable(CACHED_MEMORY);
 
 	/* Map all devices */
 	if (isError(dtp.createMapping()))
@@ -170,11 +202,41 @@ int kernelMain(void *fdt) {
 	}
 	cout << "PANIC: Setup finished" << lib::endl;
 
+	/* Check per-CPU areas */
+	if (isError(percpu::init()))
+		debug::panic::generate("Per-CPU: Areas exhausted");
+	cout << "Per-CPU: " << percpu::getUsed() << " of " << percpu::AREA_SIZE << " bytes used" << lib::endl;
+
+	/* Prepare lock statistics */
+	if (isError(lock::lockStatistics.init()))
+		debug::panic::generate("Lock Statistics: Unable to initialize");
+	cout << "Lock Statistics: Setup finished" << lib::endl;
+
+	/* Prepare TLB shootdown */
+	if (isError(mm::tlbShootdown.init()))
+		debug::panic::generate("TLB Shootdown: Unable to initialize");
+	cout << "TLB Shootdown: Setup finished" << lib::endl;
+
 	/* Prepare softirq */
 	if (isError(lock::softirq.init()))
 		debug::panic::generate("Softirq: Unable to initialize");
 	cout << "Softirq: Setup finished" << lib::endl;
 
+	/* Prepare timer wheel */
+	if (isError(time::timerWheel.init()))
+		debug::panic::generate("Timer Wheel: Unable to initialize");
+	cout << "Timer Wheel: Setup finished" << lib::endl;
+
+	/* Prepare RCU */
+	if (isError(lock::rcu.init()))
+		debug::panic::generate("RCU: Unable to initialize");
+	cout << "RCU: Setup finished" << lib::endl;
+
+	/* Prepare scheduler */
+	if (isError(thread::scheduler.init()))
+		debug::panic::generate("Scheduler: Unable to initialize");
+	cout << "Scheduler: Setup finished" << lib::endl;
+
 	/* Prepare synchronous exception handlers */
 	if (isError(irq::syncHandler.registerHandler(&irq::pagefaultHandler)))
 		debug::panic::generate("Synchronous Exceptions: Unable to register pagefault handler");
@@ -193,26 +255,44 @@ int kernelMain(void *fdt) {
 		debug::panic::generate("SMP: Unable to initialize");
 	cout << "SMP: Setup finished" << lib::endl;
 
+	/* Measure lock contention (together with application processors) */
+	if (LOCK_BENCHMARK)
+		lock::benchmark.run();
+
 	/* Unmap page 0x0 */
 	mm::Paging paging;
 	paging.unmap(nullptr);
-	CPU::invalidatePage(nullptr);
 
 	cout << "CPU " << CPU::getProcessorID() << ": Finished initialization" << lib::endl;
 
+	/* Prepare address space of main application (bss and user stack are populated on demand) */
+	if (isError(mainAddressSpace.init()))
+		debug::panic::generate("Memory: Unable to create address space for main thread");
+
+	auto bssApp = linker::getAppBSSSegment();
+	auto bssSize = math::roundUp(bssApp.second, PAGESIZE);
+	if (bssSize != 0 && isError(mainAddressSpace.addArea(bssApp.first, bssSize, mm::Paging::USER_MAPPING, mm::Paging::WRITABLE)))
+		debug::panic::generate("Memory: Unable to add bss of main thread");
+
+	void* userStack = reinterpret_cast<void*>(mm::Paging::USER_SPACE_END - STACK_SIZE);
+	if (isError(mainAddressSpace.addArea(userStack, STACK_SIZE, mm::Paging::USER_MAPPING, mm::Paging::WRITABLE)))
+		debug::panic::generate("Memory: Unable to add user stack of main thread");
+
 	/* Prepare Main Thread */
-	char* kernelStack = new char[STACK_SIZE];
+	void* kernelStack = mm::frameAlloc.allocPages(mm::FrameAllocator::sizeToOrder(STACK_SIZE));
 	if (kernelStack == nullptr)
 		debug::panic::generate("Thread: Unable to allocate kernel stack for main thread");
-	mainThread.init(0, kernelStack, userStack, false, (void*) main);
+	/* Main thread is released by the scheduler after calling exit */
+	auto mainThread = new thread::Context;
+	if (mainThread == nullptr)
+		debug::panic::generate("Thread: Unable to allocate main thread");
+	mainThread->init(0, kernelStack, userStack, false, (void*) main);
+	mainThread->setAddressSpace(&mainAddressSpace);
 	cout << "Thread: Setup of main thread finished" << lib::endl;
 
-	/* Preform initial context switch */
-	thread::Context tmpContext;
-	thread::Context::switching(&tmpContext, &mainThread);
-
-	debug::panic::generate("End of kernelMain must never be reached!");
-	return -1;
+	/* Start scheduling (main thread is placed on the boot CPU) */
+	thread::scheduler.ready(mainThread);
+	thread::scheduler.start();
 }
 
 int kernelMainApp() {
@@ -222,9 +302,6 @@ int kernelMainApp() {
 	/* Prepare exeption vector */
 	CPU::loadExeptionVector(irq::getExceptionVector());
 
-	/* Register CPU */
-	thread::smp.registerCPU();
-
 	/* Use default MAIR layout */
 	hw::reg::MAIR mair;
 	mair.useDefaultLayout();
@@ -232,13 +309,26 @@ int kernelMainApp() {
 	/* Use default TCR layout */
 	hw::reg::TCR tcr;
 	tcr.useDefaultSetting();
+	if (CACHED_MEMORY)
+		tcr.useCacheableTableWalks();
+	tcr.setASIDSize(CPU::getASIDBits());
 
 	/* Load kernel mapping */
 	mm::Paging::loadKernelMapping();
 
-	/* Enable MMU */
+	/* Discard stale instruction cache lines and TLB entries (the data cache
+	 * is shared with the boot CPU and was already invalidated by it) */
+	CPU::invalidateInstrCache();
+	CPU::invalidateTLB();
+
+	/* Enable MMU and caches */
 	hw::reg::SCTLR sctrl;
 	sctrl.setMMUEnabled(true);
+	sctrl.setDataCachable(CACHED_MEMORY);
+	sctrl.setInstrCachable(CACHED_MEMORY);
+
+	/* Register CPU (must happen after enabling caches to stay coherent with boot CPU) */
+	thread::smp.registerCPU();
 
 	/* Local output stream */
 	lib::ostream cout;
@@ -248,13 +338,16 @@ int kernelMainApp() {
 		debug::panic::generate("Thread: Unable to initialize idle thread");
 	cout << "Thread: Idle Thread Setup finished" << lib::endl;
 
+	/* Windup timer (only needed by per-CPU timers) */
+	if (isError(driver::timer.windup(driver::timer.interval())))
+		debug::panic::generate("Timer: Unable to windup");
+
 	cout << "CPU " << CPU::getProcessorID() << ": Finished initialization" << lib::endl;
 
-	/* Preform initial context switch */
-	thread::Context tmpContext;
-	auto& idleThread = thread::idleThreads.get();
-	thread::Context::switching(&tmpContext, &idleThread);
+	/* Measure lock contention (together with boot CPU) */
+	if (LOCK_BENCHMARK)
+		lock::benchmark.run();
 
-	debug::panic::generate("End of kernelMain must never be reached!");
-	return -1;
+	/* Start scheduling (idle thread runs until threads are placed on this CPU) */
+	thread::scheduler.start();
 }